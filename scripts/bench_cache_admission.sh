@@ -0,0 +1,97 @@
+#!/bin/bash
+# L2 admission benchmark: hot Zipfian checks while a report query scans every tuple
+#
+# Prerequisites:
+#   - postfga loaded (shared_preload_libraries) and OpenFGA reachable
+#   - scripts/bench.sql loaded and fga_bench.tuples written to OpenFGA (postfga_write.sql)
+#   - fga.cache_size small enough that the shared L2 holds only part of fga_bench.tuples
+#     (e.g. fga.cache_size = 4 for ~70K entries against ~250K tuples)
+#
+# Each round runs pgbench on a Zipfian key distribution (interactive traffic) and,
+# at the same time, a session that checks every tuple once per pass (the scan).
+# The round is repeated with fga.cache_admission off and on; the L2 hit rate of the
+# whole round shows how much of the hot set survives the scan.
+#
+# Usage:
+#   scripts/bench_cache_admission.sh [-d dbname] [-U user] [-T seconds] [-c clients] [-s zipf_skew]
+
+set -e
+
+DB="postgres"
+DB_USER="postgres"
+DURATION=60
+CLIENTS=8
+SKEW=1.1
+
+while getopts "d:U:T:c:s:" opt; do
+    case $opt in
+    d) DB="$OPTARG" ;;
+    U) DB_USER="$OPTARG" ;;
+    T) DURATION="$OPTARG" ;;
+    c) CLIENTS="$OPTARG" ;;
+    s) SKEW="$OPTARG" ;;
+    *) exit 1 ;;
+    esac
+done
+
+PSQL="psql -U $DB_USER -d $DB -XAtq"
+NPROC=$(nproc 2>/dev/null || echo 4)
+JOBS=$((CLIENTS < NPROC ? CLIENTS : NPROC))
+WORKDIR=$(mktemp -d)
+trap 'rm -rf "$WORKDIR"; $PSQL -c "ALTER SYSTEM RESET fga.cache_admission" -c "SELECT pg_reload_conf()" >/dev/null' EXIT
+
+MAX_ID=$($PSQL -c "SELECT max(id) FROM fga_bench.tuples")
+if [ -z "$MAX_ID" ]; then
+    echo "fga_bench.tuples is empty; load scripts/bench.sql first" >&2
+    exit 1
+fi
+
+TTL_MS=$($PSQL -c "SELECT setting FROM pg_settings WHERE name = 'fga.cache_ttl_ms'")
+
+cat >"$WORKDIR/hot.sql" <<SQL
+\set id random_zipfian(1, $MAX_ID, $SKEW)
+SELECT fga_check(object_type, object_id, subject_type, subject_id, relation)
+FROM fga_bench.tuples WHERE id = :id;
+SQL
+
+stat_value() {
+    $PSQL -c "SELECT coalesce(sum(value), 0) FROM fga_stats() WHERE section = '$1' AND metric = '$2'"
+}
+
+scan_loop() {
+    while :; do
+        $PSQL -c "SELECT count(*) FILTER (WHERE fga_check(object_type, object_id, subject_type, subject_id, relation))
+                  FROM fga_bench.tuples" >/dev/null || break
+    done
+}
+
+printf "%10s %12s %12s %12s %12s %10s\n" "admission" "tps" "l2_hits" "l2_misses" "rejects" "hit_rate"
+
+for mode in off on; do
+    $PSQL -c "ALTER SYSTEM SET fga.cache_admission = $mode" -c "SELECT pg_reload_conf()" >/dev/null
+    sleep 1
+
+    # 이전 라운드의 엔트리가 모두 만료될 때까지 대기
+    sleep $((TTL_MS / 1000 + 1))
+
+    hits_before=$(stat_value cache.l2 hits)
+    misses_before=$(stat_value cache.l2 misses)
+    rejects_before=$(stat_value cache.l2 admission_rejects)
+
+    scan_loop &
+    scan_pid=$!
+
+    tps=$(pgbench -U "$DB_USER" -d "$DB" -n -M prepared -c "$CLIENTS" -j "$JOBS" -T "$DURATION" \
+        -f "$WORKDIR/hot.sql" 2>/dev/null | awk '/^tps/ { print $3; exit }')
+
+    kill "$scan_pid" 2>/dev/null || true
+    wait "$scan_pid" 2>/dev/null || true
+
+    hits=$(($(stat_value cache.l2 hits) - hits_before))
+    misses=$(($(stat_value cache.l2 misses) - misses_before))
+    rejects=$(($(stat_value cache.l2 admission_rejects) - rejects_before))
+    total=$((hits + misses))
+    rate=$(awk -v h="$hits" -v t="$total" 'BEGIN { printf "%.2f%%", t > 0 ? 100 * h / t : 0 }')
+
+    printf "%10s %12s %12d %12d %12d %10s\n" "$mode" "$tps" "$hits" "$misses" "$rejects" "$rate"
+done
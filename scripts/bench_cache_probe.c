@@ -0,0 +1,266 @@
+/*
+ * bench_cache_probe.c
+ *    L1 set-associative 캐시 탐색 마이크로벤치마크 (Zipfian key 분포)
+ *
+ * 같은 총 엔트리 수(32768)에서 다음을 비교한다.
+ *   - 2-way  : 기존 L1 (way 마다 전체 key 비교, flip-bit LRU)
+ *   - 16-way : way 마다 전체 key 비교 (tag 없음)
+ *   - 16-way : cache_probe.h tag 그룹 비교 (SSE2/NEON/scalar)
+ *
+ * Build & run (PostgreSQL 불필요):
+ *   cc -O2 -march=native -Isrc -o /tmp/bench_cache_probe scripts/bench_cache_probe.c -lm
+ *   /tmp/bench_cache_probe [keys] [lookups]
+ */
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cache_probe.h"
+
+#define TOTAL_ENTRIES 32768
+
+typedef struct Key
+{
+    uint64_t low;
+    uint64_t high;
+} Key;
+
+typedef struct Entry
+{
+    Key key;
+    bool valid;
+    bool allowed;
+} Entry;
+
+typedef struct Cache
+{
+    int ways;
+    int sets;
+    bool use_tags;
+    uint8_t* tags;  /* [sets * 16] */
+    uint16_t* mru;  /* [sets] */
+    Entry* entries; /* [sets * ways] */
+} Cache;
+
+static uint64_t splitmix64(uint64_t* state)
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static double now_sec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Zipf(s) CDF 를 미리 만들고 이분 탐색으로 샘플링 */
+static double* zipf_cdf(int n, double s)
+{
+    double* cdf = malloc(sizeof(double) * n);
+    double sum = 0;
+    double run = 0;
+
+    for (int i = 0; i < n; i++)
+        sum += 1.0 / pow(i + 1, s);
+
+    for (int i = 0; i < n; i++)
+    {
+        run += 1.0 / pow(i + 1, s) / sum;
+        cdf[i] = run;
+    }
+    return cdf;
+}
+
+static int zipf_sample(const double* cdf, int n, uint64_t* rng)
+{
+    double u = (splitmix64(rng) >> 11) * (1.0 / 9007199254740992.0);
+    int lo = 0, hi = n - 1;
+
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+
+        if (cdf[mid] < u)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static void cache_init(Cache* c, int ways, bool use_tags)
+{
+    c->ways = ways;
+    c->sets = TOTAL_ENTRIES / ways;
+    c->use_tags = use_tags;
+    c->tags = calloc((size_t)c->sets * FGA_PROBE_GROUP_SIZE, 1);
+    c->mru = calloc(c->sets, sizeof(uint16_t));
+    c->entries = calloc((size_t)c->sets * ways, sizeof(Entry));
+}
+
+static void cache_free(Cache* c)
+{
+    free(c->tags);
+    free(c->mru);
+    free(c->entries);
+}
+
+static void plru_access(Cache* c, int set, int way)
+{
+    if (c->ways == 2)
+    {
+        c->mru[set] = (uint16_t)(way ^ 1); /* flip-bit: 다음 victim */
+        return;
+    }
+    c->mru[set] |= (uint16_t)(1u << way);
+    if (c->mru[set] == (uint16_t)((1u << c->ways) - 1))
+        c->mru[set] = (uint16_t)(1u << way);
+}
+
+static int plru_victim(Cache* c, int set)
+{
+    if (c->ways == 2)
+        return c->mru[set];
+    return fga_probe_first((FgaProbeMask)~c->mru[set]);
+}
+
+static bool cache_lookup(Cache* c, const Key* key)
+{
+    int set = (int)(key->low & (uint64_t)(c->sets - 1));
+    Entry* row = &c->entries[(size_t)set * c->ways];
+
+    if (c->use_tags)
+    {
+        FgaProbeMask m = fga_probe_match(&c->tags[(size_t)set * FGA_PROBE_GROUP_SIZE], fga_probe_tag(key->high));
+
+        for (; m != 0; m = fga_probe_next(m))
+        {
+            int i = fga_probe_first(m);
+
+            if (row[i].key.low == key->low && row[i].key.high == key->high)
+            {
+                plru_access(c, set, i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    for (int i = 0; i < c->ways; i++)
+    {
+        if (row[i].valid && row[i].key.low == key->low && row[i].key.high == key->high)
+        {
+            plru_access(c, set, i);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void cache_store(Cache* c, const Key* key)
+{
+    int set = (int)(key->low & (uint64_t)(c->sets - 1));
+    Entry* row = &c->entries[(size_t)set * c->ways];
+    int target = -1;
+
+    if (c->use_tags)
+    {
+        FgaProbeMask empty = fga_probe_match_empty(&c->tags[(size_t)set * FGA_PROBE_GROUP_SIZE]);
+
+        target = empty != 0 ? fga_probe_first(empty) : plru_victim(c, set);
+        c->tags[(size_t)set * FGA_PROBE_GROUP_SIZE + target] = fga_probe_tag(key->high);
+    }
+    else
+    {
+        for (int i = 0; i < c->ways && target < 0; i++)
+        {
+            if (!row[i].valid)
+                target = i;
+        }
+        if (target < 0)
+            target = plru_victim(c, set);
+    }
+
+    row[target].key = *key;
+    row[target].valid = true;
+    plru_access(c, set, target);
+}
+
+static void run(const char* name, int ways, bool use_tags, const Key* keys, const int* trace, int lookups)
+{
+    Cache c;
+    int hits = 0;
+    double start;
+    double elapsed;
+
+    cache_init(&c, ways, use_tags);
+
+    start = now_sec();
+    for (int i = 0; i < lookups; i++)
+    {
+        const Key* key = &keys[trace[i]];
+
+        if (cache_lookup(&c, key))
+            hits++;
+        else
+            cache_store(&c, key);
+    }
+    elapsed = now_sec() - start;
+
+    printf("  %-22s hit=%6.2f%%  %6.1f ns/op\n", name, 100.0 * hits / lookups, elapsed * 1e9 / lookups);
+    cache_free(&c);
+}
+
+int main(int argc, char** argv)
+{
+    int nkeys = argc > 1 ? atoi(argv[1]) : 1000000;
+    int lookups = argc > 2 ? atoi(argv[2]) : 20000000;
+    const double skews[] = {0.6, 0.8, 0.99, 1.2};
+    uint64_t rng = 42;
+    Key* keys = malloc(sizeof(Key) * nkeys);
+    int* trace = malloc(sizeof(int) * lookups);
+
+#if defined(FGA_PROBE_USE_SSE2)
+    const char* isa = "sse2";
+#elif defined(FGA_PROBE_USE_NEON)
+    const char* isa = "neon";
+#else
+    const char* isa = "scalar";
+#endif
+
+    for (int i = 0; i < nkeys; i++)
+    {
+        keys[i].low = splitmix64(&rng);
+        keys[i].high = splitmix64(&rng);
+    }
+
+    printf("entries=%d keys=%d lookups=%d probe=%s\n", TOTAL_ENTRIES, nkeys, lookups, isa);
+
+    for (size_t s = 0; s < sizeof(skews) / sizeof(skews[0]); s++)
+    {
+        double* cdf = zipf_cdf(nkeys, skews[s]);
+
+        for (int i = 0; i < lookups; i++)
+            trace[i] = zipf_sample(cdf, nkeys, &rng);
+        free(cdf);
+
+        printf("zipf s=%.2f\n", skews[s]);
+        run("2-way   key compare", 2, false, keys, trace, lookups);
+        run("16-way  key compare", 16, false, keys, trace, lookups);
+        run("16-way  tag probe", 16, true, keys, trace, lookups);
+    }
+
+    free(keys);
+    free(trace);
+    return 0;
+}
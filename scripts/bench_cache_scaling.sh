@@ -0,0 +1,75 @@
+#!/bin/bash
+# L2 cache scaling benchmark: fga_check() throughput from 1 to 64 backends
+#
+# Prerequisites:
+#   - postfga loaded (shared_preload_libraries) and OpenFGA reachable
+#   - scripts/bench.sql loaded and fga_bench.tuples written to OpenFGA (postfga_write.sql)
+#
+# Per-backend L1 holds 32K entries, so checks drawn from the whole tuple set
+# (~250K keys) mostly miss L1 and hit the shared L2. That makes this a
+# measurement of shared L2 contention rather than of the backend-local cache.
+#
+# Usage:
+#   scripts/bench_cache_scaling.sh [-d dbname] [-U user] [-T seconds] [-c "1 2 4 ..."]
+
+set -e
+
+DB="postgres"
+DB_USER="postgres"
+DURATION=30
+CLIENTS="1 2 4 8 16 32 64"
+
+while getopts "d:U:T:c:" opt; do
+    case $opt in
+    d) DB="$OPTARG" ;;
+    U) DB_USER="$OPTARG" ;;
+    T) DURATION="$OPTARG" ;;
+    c) CLIENTS="$OPTARG" ;;
+    *) exit 1 ;;
+    esac
+done
+
+PSQL="psql -U $DB_USER -d $DB -XAtq"
+NPROC=$(nproc 2>/dev/null || echo 4)
+WORKDIR=$(mktemp -d)
+trap 'rm -rf "$WORKDIR"' EXIT
+
+MAX_ID=$($PSQL -c "SELECT max(id) FROM fga_bench.tuples")
+if [ -z "$MAX_ID" ]; then
+    echo "fga_bench.tuples is empty; load scripts/bench.sql first" >&2
+    exit 1
+fi
+
+cat >"$WORKDIR/check.sql" <<EOF
+\set id random(1, $MAX_ID)
+SELECT fga_check(object_type, object_id, subject_type, subject_id, relation)
+FROM fga_bench.tuples WHERE id = :id;
+EOF
+
+stat_value() {
+    $PSQL -c "SELECT coalesce(sum(value), 0) FROM fga_stats() WHERE section = '$1' AND metric = '$2'"
+}
+
+# 1) 캐시 워밍업: 모든 튜플을 한 번씩 조회해서 L2 를 채운다
+echo "warming up L2 with $MAX_ID keys..."
+$PSQL -c "SELECT count(*) FILTER (WHERE fga_check(object_type, object_id, subject_type, subject_id, relation))
+          FROM fga_bench.tuples" >/dev/null
+
+printf "%8s %12s %12s %12s %10s\n" "clients" "tps" "l2_hits" "l2_misses" "hit_rate"
+
+for c in $CLIENTS; do
+    jobs=$((c < NPROC ? c : NPROC))
+
+    hits_before=$(stat_value cache.l2 hits)
+    misses_before=$(stat_value cache.l2 misses)
+
+    tps=$(pgbench -U "$DB_USER" -d "$DB" -n -M prepared -c "$c" -j "$jobs" -T "$DURATION" \
+        -f "$WORKDIR/check.sql" 2>/dev/null | awk '/^tps/ { print $3; exit }')
+
+    hits=$(($(stat_value cache.l2 hits) - hits_before))
+    misses=$(($(stat_value cache.l2 misses) - misses_before))
+    total=$((hits + misses))
+    rate=$(awk -v h="$hits" -v t="$total" 'BEGIN { printf "%.2f%%", t > 0 ? 100 * h / t : 0 }')
+
+    printf "%8d %12s %12d %12d %10s\n" "$c" "$tps" "$hits" "$misses" "$rate"
+done
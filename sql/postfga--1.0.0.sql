@@ -21,6 +21,15 @@ CREATE FOREIGN DATA WRAPPER fga_fdw
   VALIDATOR fga_fdw_validator;
 
 -- Core functions for permission checking and tuple management
+-- Planner support for fga_check: cost from live cache hit ratios and check latency,
+-- selectivity from the allow ratio observed per relation (falls back to COST / default until sampled)
+CREATE OR REPLACE FUNCTION fga_check_support(internal)
+RETURNS internal
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT;
+
+-- fga_check options: {"consistency": "minimize_latency"|"higher", "cache": "on"|"refresh"|"off", "timeout_ms": n,
+--                     "context": {...}, "contextual_tuples": [{"object": "t:id", "relation": "r", "user": "t:id"}, ...]}
 CREATE OR REPLACE FUNCTION fga_check(
     object_type text,
     object_id text,
@@ -31,7 +40,22 @@ CREATE OR REPLACE FUNCTION fga_check(
 )
 RETURNS boolean
 AS 'MODULE_PATHNAME'
-LANGUAGE C PARALLEL SAFE VOLATILE COST 10000;
+LANGUAGE C PARALLEL SAFE VOLATILE COST 10000
+SUPPORT fga_check_support;
+
+-- Object ids (without the "object_type:" prefix) the subject reaches through relation, in sorted order.
+-- Use it as a set to join against instead of calling fga_check per row:
+--   SELECT d.* FROM documents d WHERE d.id IN (SELECT fga_list_objects('doc', 'viewer', 'user', $1));
+-- Results are cached in shared memory (fga.list_cache_size, fga.list_cache_ttl_ms).
+CREATE OR REPLACE FUNCTION fga_list_objects(
+    object_type text,
+    relation text,
+    subject_type text,
+    subject_id text
+)
+RETURNS SETOF text
+AS 'MODULE_PATHNAME'
+LANGUAGE C STRICT PARALLEL SAFE VOLATILE COST 10000 ROWS 1000;
 
 CREATE OR REPLACE FUNCTION fga_write_tuple(
     object_type text,
@@ -80,6 +104,101 @@ RETURNS TABLE (
 AS 'MODULE_PATHNAME'
 LANGUAGE C VOLATILE;
 
+CREATE OR REPLACE FUNCTION fga_latency()
+RETURNS TABLE (
+    request_type text,
+    stage text,
+    count bigint,
+    mean_us double precision,
+    p50_us bigint,
+    p95_us bigint,
+    p99_us bigint,
+    p999_us bigint,
+    max_us bigint
+)
+AS 'MODULE_PATHNAME'
+LANGUAGE C VOLATILE;
+
+-- Per-backend local (L1) cache: sessions that have run a permission check
+CREATE OR REPLACE FUNCTION fga_backend_stats()
+RETURNS TABLE (
+    pid integer,
+    l1_entries bigint,
+    l1_ways integer,
+    l1_bytes bigint,
+    l1_hits bigint,
+    l1_misses bigint,
+    l1_evictions bigint,
+    l1_hit_ratio double precision
+)
+AS 'MODULE_PATHNAME'
+LANGUAGE C VOLATILE;
+
+CREATE OR REPLACE FUNCTION fga_trace_recent()
+RETURNS TABLE (
+    request_id bigint,
+    request_type text,
+    pid integer,
+    status integer,
+    enqueue_us bigint,
+    drain_us bigint,
+    rpc_start_us bigint,
+    rpc_end_us bigint,
+    complete_us bigint,
+    wake_us bigint,
+    total_us bigint
+)
+AS 'MODULE_PATHNAME'
+LANGUAGE C VOLATILE;
+
+-- Shared cache persistence ($PGDATA/postfga_cache.dump, BGW 시작 시에만 적재)
+CREATE OR REPLACE FUNCTION fga_cache_dump()
+RETURNS bigint
+AS 'MODULE_PATHNAME'
+LANGUAGE C VOLATILE;
+
+-- 캐시 무효화: object > subject > global (global 은 모든 store)
+CREATE OR REPLACE FUNCTION fga_cache_invalidate(
+    store text DEFAULT NULL,
+    object_type text DEFAULT NULL,
+    object_id text DEFAULT NULL,
+    subject_type text DEFAULT NULL,
+    subject_id text DEFAULT NULL
+)
+RETURNS text
+AS 'MODULE_PATHNAME'
+LANGUAGE C VOLATILE;
+
+-- L2 엔트리 표본 (임의의 위치부터 max_entries 개, NULL 이면 전체)
+CREATE OR REPLACE FUNCTION fga_cache_entries(max_entries integer DEFAULT 100)
+RETURNS TABLE (
+    "group" bigint,
+    slot integer,
+    key text,
+    allowed bigint,
+    known bigint,
+    expires_in_ms bigint,
+    usage smallint,
+    status text,
+    refresh_pending boolean
+)
+AS 'MODULE_PATHNAME'
+LANGUAGE C VOLATILE;
+
+-- L2 점유율, 남은 TTL 분포, relation 별 hit ratio
+CREATE OR REPLACE FUNCTION fga_cache_summary()
+RETURNS TABLE (
+    section text,
+    metric text,
+    value double precision
+)
+AS 'MODULE_PATHNAME'
+LANGUAGE C VOLATILE;
+
+REVOKE ALL ON FUNCTION fga_cache_dump() FROM PUBLIC;
+REVOKE ALL ON FUNCTION fga_cache_invalidate(text, text, text, text, text) FROM PUBLIC;
+REVOKE ALL ON FUNCTION fga_cache_entries(integer) FROM PUBLIC;
+
 
 -- -- Grant usage to public (can be restricted later)
 -- GRANT USAGE ON FOREIGN DATA WRAPPER fga_fdw TO PUBLIC;
@@ -0,0 +1,530 @@
+/*-------------------------------------------------------------------------
+ *
+ * batch_check.c
+ *    Batched evaluation of fga_check quals for PostFGA extension.
+ *
+ * This module implements:
+ *   - set_rel_pathlist_hook that wraps base relation scans filtered by fga_check
+ *   - FgaBatchCheck CustomScan: reads blocks of rows, resolves their checks together
+ *
+ * 계획 단계에서 하위 scan 의 qual 중 최상위 fga_check(...) 호출을 떼어 custom_exprs 로 옮긴다.
+ * 실행할 때는 블록의 행마다 인자를 평가해 fga_check_batch 에 넘기고, 통과한 행만 내보낸다.
+ * qual 이 여러 개면 앞의 check 를 통과한 행만 다음 check 로 넘긴다 (AND 단락 평가와 같은 횟수).
+ * 떼어 온 check 는 나머지 qual 보다 나중에 평가되므로, RLS 정책 등 보안 수준이 더 낮은 check 를
+ * leakproof 가 아닌 사용자 qual 뒤로 미루게 되면 감싸지 않는다.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <postgres.h>
+
+#include <access/transam.h>
+#include <commands/explain.h>
+#include <commands/explain_format.h>
+#include <commands/explain_state.h>
+#include <executor/executor.h>
+#include <nodes/extensible.h>
+#include <nodes/makefuncs.h>
+#include <optimizer/cost.h>
+#include <optimizer/optimizer.h>
+#include <optimizer/pathnode.h>
+#include <optimizer/paths.h>
+#include <optimizer/tlist.h>
+#include <utils/lsyscache.h>
+#include <utils/memutils.h>
+#include <utils/ruleutils.h>
+
+#include "batch_check.h"
+#include "config.h"
+#include "func_fga.h"
+
+#define BATCH_CHECK_NAME "FgaBatchCheck"
+
+/* fga_check(object_type, object_id, subject_type, subject_id, relation[, options]) */
+#define CHECK_NARGS 6
+
+typedef struct BatchCheckState
+{
+    CustomScanState css;
+    int nchecks;             /* 떼어 온 fga_check qual 수 */
+    ExprState** args;        /* [nchecks * CHECK_NARGS], options 가 없으면 NULL */
+    int block_size;          /* 한 번에 읽는 행 수 */
+    TupleTableSlot** rows;   /* [block_size] */
+    bool* passed;            /* [block_size] */
+    int count;               /* rows 에 채운 행 수 */
+    int next;                /* 다음에 내보낼 rows 위치 */
+    bool exhausted;          /* 하위 scan 이 끝남 */
+    MemoryContext block_cxt; /* 블록마다 비우는 인자/결과 메모리 */
+} BatchCheckState;
+
+static set_rel_pathlist_hook_type prev_set_rel_pathlist_hook = NULL;
+
+/* 마지막으로 확인한 fga_check 의 OID (확장을 다시 만들면 바뀌므로 다르면 다시 확인) */
+static Oid check_funcid = InvalidOid;
+
+static Plan* plan_batch_check(PlannerInfo* root,
+                              RelOptInfo* rel,
+                              CustomPath* best_path,
+                              List* tlist,
+                              List* clauses,
+                              List* custom_plans);
+static Node* create_batch_check_state(CustomScan* cscan);
+static void begin_batch_check(CustomScanState* node, EState* estate, int eflags);
+static TupleTableSlot* exec_batch_check(CustomScanState* node);
+static void end_batch_check(CustomScanState* node);
+static void rescan_batch_check(CustomScanState* node);
+static void explain_batch_check(CustomScanState* node, List* ancestors, ExplainState* es);
+
+static const CustomPathMethods batch_check_path_methods = {
+    .CustomName = BATCH_CHECK_NAME,
+    .PlanCustomPath = plan_batch_check,
+};
+
+static const CustomScanMethods batch_check_scan_methods = {
+    .CustomName = BATCH_CHECK_NAME,
+    .CreateCustomScanState = create_batch_check_state,
+};
+
+static const CustomExecMethods batch_check_exec_methods = {
+    .CustomName = BATCH_CHECK_NAME,
+    .BeginCustomScan = begin_batch_check,
+    .ExecCustomScan = exec_batch_check,
+    .EndCustomScan = end_batch_check,
+    .ReScanCustomScan = rescan_batch_check,
+    .ExplainCustomScan = explain_batch_check,
+};
+
+/* -------------------------------------------------------------------------
+ * Planning
+ * -------------------------------------------------------------------------
+ */
+static bool is_fga_check(Oid funcid)
+{
+    FmgrInfo flinfo;
+    char* name;
+
+    if (funcid == check_funcid)
+        return true;
+    if (funcid < FirstNormalObjectId)
+        return false;
+
+    /* 이름이 같을 때만 fmgr 로 이 라이브러리의 fga_check 인지 확인한다 */
+    name = get_func_name(funcid);
+    if (name == NULL || strcmp(name, "fga_check") != 0)
+        return false;
+
+    fmgr_info(funcid, &flinfo);
+    if (flinfo.fn_addr != fga_check)
+        return false;
+
+    check_funcid = funcid;
+    return true;
+}
+
+/* qual 최상위의 fga_check(...) 호출 */
+static bool is_check_clause(Node* clause)
+{
+    FuncExpr* func;
+
+    if (!IsA(clause, FuncExpr))
+        return false;
+
+    func = (FuncExpr*)clause;
+    return list_length(func->args) >= CHECK_NARGS - 1 && list_length(func->args) <= CHECK_NARGS &&
+           is_fga_check(func->funcid);
+}
+
+/* 행마다 qual 을 평가하는 단순 scan 만 감싼다 */
+static bool is_wrappable(const Path* path)
+{
+    switch (path->pathtype)
+    {
+    case T_SeqScan:
+    case T_SampleScan:
+    case T_IndexScan:
+    case T_IndexOnlyScan:
+    case T_BitmapHeapScan:
+    case T_TidScan:
+    case T_TidRangeScan:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/*
+ * subpath 를 감싼 경로. 행마다 내던 check 비용을 블록 크기로 나누고,
+ * 첫 행은 블록 하나를 읽고 확인한 뒤에 나오므로 그만큼 startup 에 더한다.
+ */
+static Path* create_batch_check_path(
+    RelOptInfo* rel, Path* subpath, const QualCost* check_cost, Selectivity selectivity, int block_size)
+{
+    CustomPath* cpath = makeNode(CustomPath);
+    double input_rows = clamp_row_est(subpath->rows / Max(selectivity, 1e-6));
+    double first_block = Min(1.0, block_size / input_rows);
+    Cost run_cost = subpath->total_cost - subpath->startup_cost;
+    Cost saved = input_rows * check_cost->per_tuple * (1.0 - 1.0 / block_size);
+
+    cpath->path.pathtype = T_CustomScan;
+    cpath->path.parent = rel;
+    cpath->path.pathtarget = subpath->pathtarget;
+    cpath->path.param_info = subpath->param_info;
+    cpath->path.parallel_aware = false;
+    cpath->path.parallel_safe = false;
+    cpath->path.parallel_workers = 0;
+    cpath->path.rows = subpath->rows;
+#if PG_VERSION_NUM >= 180000
+    cpath->path.disabled_nodes = subpath->disabled_nodes;
+#else
+#error "Add compatibility code for this PostgreSQL version"
+#endif
+    cpath->path.startup_cost = subpath->startup_cost + run_cost * first_block + check_cost->per_tuple;
+    cpath->path.total_cost = Max(subpath->total_cost - saved, cpath->path.startup_cost);
+    cpath->path.pathkeys = subpath->pathkeys;
+
+    cpath->flags = 0;
+    cpath->custom_paths = list_make1(subpath);
+    cpath->methods = &batch_check_path_methods;
+
+    return &cpath->path;
+}
+
+/*
+ * check 들을 나머지 qual 뒤로 미뤄도 되는지.
+ * 어떤 check 보다 security_level 이 높은 qual 이 leakproof 가 아니면, 그 check (예: RLS 정책) 를
+ * 통과하지 않은 행의 값이 그 qual 에 보이게 되므로 false.
+ */
+static bool checks_can_run_last(List* checks, List* restrictinfo)
+{
+    ListCell* lc;
+
+    foreach (lc, restrictinfo)
+    {
+        RestrictInfo* rinfo = lfirst_node(RestrictInfo, lc);
+        ListCell* c;
+
+        /* security_level > 0 인 qual 은 make_restrictinfo 가 leakproof 를 계산해 둔다 */
+        if (list_member_ptr(checks, rinfo) || rinfo->leakproof)
+            continue;
+
+        foreach (c, checks)
+        {
+            if (rinfo->security_level > lfirst_node(RestrictInfo, c)->security_level)
+                return false;
+        }
+    }
+    return true;
+}
+
+static void batch_check_pathlist(PlannerInfo* root, RelOptInfo* rel, Index rti, RangeTblEntry* rte)
+{
+    int block_size = fga_get_config()->check_batch_size;
+    List* checks = NIL;
+    List* kept = NIL;
+    List* wrapped = NIL;
+    ListCell* lc;
+    QualCost check_cost;
+    Selectivity selectivity;
+
+    if (prev_set_rel_pathlist_hook)
+        prev_set_rel_pathlist_hook(root, rel, rti, rte);
+
+    if (block_size <= 1 || rte->rtekind != RTE_RELATION || IS_DUMMY_REL(rel))
+        return;
+
+    foreach (lc, rel->baserestrictinfo)
+    {
+        RestrictInfo* rinfo = lfirst_node(RestrictInfo, lc);
+
+        if (is_check_clause((Node*)rinfo->clause))
+            checks = lappend(checks, rinfo);
+    }
+    if (checks == NIL || !checks_can_run_last(checks, rel->baserestrictinfo))
+        return;
+
+    cost_qual_eval(&check_cost, checks, root);
+    selectivity = clauselist_selectivity(root, checks, rti, JOIN_INNER, NULL);
+
+    foreach (lc, rel->pathlist)
+    {
+        Path* path = (Path*)lfirst(lc);
+
+        if (is_wrappable(path))
+            wrapped = lappend(wrapped, create_batch_check_path(rel, path, &check_cost, selectivity, block_size));
+        else
+            kept = lappend(kept, path);
+    }
+
+    /* add_path 가 밀려난 경로를 pfree 하므로, 감싼 원래 경로는 목록에서 빼 두고 새 경로만 넣는다 */
+    rel->pathlist = kept;
+    foreach (lc, wrapped)
+        add_path(rel, (Path*)lfirst(lc));
+}
+
+static Plan* plan_batch_check(PlannerInfo* root,
+                              RelOptInfo* rel,
+                              CustomPath* best_path,
+                              List* tlist,
+                              List* clauses,
+                              List* custom_plans)
+{
+    CustomScan* cscan = makeNode(CustomScan);
+    Plan* child = (Plan*)linitial(custom_plans);
+    List* checks = NIL;
+    List* rest = NIL;
+    ListCell* lc;
+
+    /* 하위 scan 이 행마다 부르지 않도록 fga_check qual 을 떼어 온다 (나머지 qual 은 하위 scan 이 먼저 거른다) */
+    foreach (lc, child->qual)
+    {
+        Node* qual = (Node*)lfirst(lc);
+
+        if (is_check_clause(qual))
+            checks = lappend(checks, qual);
+        else
+            rest = lappend(rest, qual);
+    }
+    child->qual = rest;
+
+    /* 떼어 온 qual 이 읽는 열을 하위 scan 의 출력에 더한다 */
+    child->targetlist = add_to_flat_tlist(child->targetlist, pull_var_clause((Node*)checks, PVC_INCLUDE_PLACEHOLDERS));
+
+    cscan->scan.plan.targetlist = tlist;
+    cscan->scan.plan.qual = NIL;
+    cscan->scan.scanrelid = 0;
+    cscan->flags = best_path->flags;
+    cscan->custom_plans = custom_plans;
+    cscan->custom_exprs = checks;
+    cscan->custom_scan_tlist = copyObject(child->targetlist);
+    cscan->methods = &batch_check_scan_methods;
+
+    return &cscan->scan.plan;
+}
+
+/* -------------------------------------------------------------------------
+ * Execution
+ * -------------------------------------------------------------------------
+ */
+static Node* create_batch_check_state(CustomScan* cscan)
+{
+    BatchCheckState* state = (BatchCheckState*)newNode(sizeof(BatchCheckState), T_CustomScanState);
+
+    state->css.methods = &batch_check_exec_methods;
+    return (Node*)state;
+}
+
+static void begin_batch_check(CustomScanState* node, EState* estate, int eflags)
+{
+    BatchCheckState* state = (BatchCheckState*)node;
+    CustomScan* cscan = (CustomScan*)node->ss.ps.plan;
+    TupleDesc desc = node->ss.ss_ScanTupleSlot->tts_tupleDescriptor;
+    ListCell* lc;
+    int i = 0;
+
+    node->custom_ps = list_make1(ExecInitNode((Plan*)linitial(cscan->custom_plans), estate, eflags));
+
+    state->nchecks = list_length(cscan->custom_exprs);
+    state->args = (ExprState**)palloc0(sizeof(ExprState*) * state->nchecks * CHECK_NARGS);
+    foreach (lc, cscan->custom_exprs)
+    {
+        FuncExpr* func = lfirst_node(FuncExpr, lc);
+        ListCell* arg;
+        int n = 0;
+
+        foreach (arg, func->args)
+            state->args[i * CHECK_NARGS + n++] = ExecInitExpr((Expr*)lfirst(arg), &node->ss.ps);
+        i++;
+    }
+
+    /* 계획 이후 fga.check_batch_size 를 0 으로 바꿨으면 행마다 확인한다 */
+    state->block_size = Max(1, fga_get_config()->check_batch_size);
+    state->rows = (TupleTableSlot**)palloc(sizeof(TupleTableSlot*) * state->block_size);
+    for (i = 0; i < state->block_size; i++)
+        state->rows[i] = ExecAllocTableSlot(&estate->es_tupleTable, desc, &TTSOpsVirtual);
+    state->passed = (bool*)palloc(sizeof(bool) * state->block_size);
+
+    state->count = 0;
+    state->next = 0;
+    state->exhausted = false;
+    state->block_cxt = AllocSetContextCreate(CurrentMemoryContext, "PostFGA batch check", ALLOCSET_DEFAULT_SIZES);
+}
+
+static text* eval_text(ExprState* expr, ExprContext* econtext)
+{
+    bool isnull;
+    Datum value = ExecEvalExpr(expr, econtext, &isnull);
+
+    return isnull ? NULL : DatumGetTextPP(value);
+}
+
+/* check 하나의 인자를 현재 행 (econtext->ecxt_scantuple) 으로 평가. NULL 검사는 fga_check_batch 가 한다 */
+static void eval_args(ExprState** exprs, ExprContext* econtext, FgaTupleArgs* args)
+{
+    args->object_type = eval_text(exprs[0], econtext);
+    args->object_id = eval_text(exprs[1], econtext);
+    args->subject_type = eval_text(exprs[2], econtext);
+    args->subject_id = eval_text(exprs[3], econtext);
+    args->relation = eval_text(exprs[4], econtext);
+    args->options = NULL;
+
+    if (exprs[5] != NULL)
+    {
+        bool isnull;
+        Datum value = ExecEvalExpr(exprs[5], econtext, &isnull);
+
+        if (!isnull)
+            args->options = DatumGetJsonbP(value);
+    }
+}
+
+/* 하위 scan 에서 한 블록을 읽고, check 마다 아직 통과 중인 행을 모아 한 번에 확인한다 */
+static void fill_block(BatchCheckState* state)
+{
+    PlanState* child = (PlanState*)linitial(state->css.custom_ps);
+    ExprContext* econtext = state->css.ss.ps.ps_ExprContext;
+    MemoryContext old;
+    FgaTupleArgs* args;
+    bool* results;
+    int* rows;
+    int n = 0;
+
+    while (n < state->block_size)
+    {
+        TupleTableSlot* slot = ExecProcNode(child);
+
+        if (TupIsNull(slot))
+        {
+            state->exhausted = true;
+            break;
+        }
+        ExecCopySlot(state->rows[n], slot);
+        state->passed[n++] = true;
+    }
+    state->count = n;
+    state->next = 0;
+
+    if (n == 0 || state->nchecks == 0)
+        return;
+
+    /* 인자 평가는 per-tuple 메모리에도 남으므로 블록마다 함께 비운다 */
+    ResetExprContext(econtext);
+    MemoryContextReset(state->block_cxt);
+    old = MemoryContextSwitchTo(state->block_cxt);
+
+    args = (FgaTupleArgs*)palloc(sizeof(FgaTupleArgs) * n);
+    results = (bool*)palloc(sizeof(bool) * n);
+    rows = (int*)palloc(sizeof(int) * n);
+
+    for (int c = 0; c < state->nchecks; c++)
+    {
+        int m = 0;
+
+        for (int i = 0; i < n; i++)
+        {
+            if (!state->passed[i])
+                continue;
+
+            econtext->ecxt_scantuple = state->rows[i];
+            eval_args(&state->args[c * CHECK_NARGS], econtext, &args[m]);
+            rows[m++] = i;
+        }
+        if (m == 0)
+            break;
+
+        fga_check_batch(args, m, results);
+        for (int j = 0; j < m; j++)
+            state->passed[rows[j]] = results[j];
+    }
+
+    MemoryContextSwitchTo(old);
+}
+
+static TupleTableSlot* exec_batch_check(CustomScanState* node)
+{
+    BatchCheckState* state = (BatchCheckState*)node;
+    ExprContext* econtext = node->ss.ps.ps_ExprContext;
+
+    for (;;)
+    {
+        TupleTableSlot* row;
+
+        if (state->next >= state->count)
+        {
+            if (state->exhausted)
+                return NULL;
+
+            fill_block(state);
+            continue;
+        }
+
+        row = state->rows[state->next];
+        if (!state->passed[state->next++])
+        {
+            InstrCountFiltered1(node, 1);
+            continue;
+        }
+
+        if (node->ss.ps.ps_ProjInfo == NULL)
+            return row;
+
+        ResetExprContext(econtext);
+        econtext->ecxt_scantuple = row;
+        return ExecProject(node->ss.ps.ps_ProjInfo);
+    }
+}
+
+static void end_batch_check(CustomScanState* node)
+{
+    BatchCheckState* state = (BatchCheckState*)node;
+
+    ExecEndNode((PlanState*)linitial(node->custom_ps));
+    MemoryContextDelete(state->block_cxt);
+}
+
+static void rescan_batch_check(CustomScanState* node)
+{
+    BatchCheckState* state = (BatchCheckState*)node;
+    PlanState* child = (PlanState*)linitial(node->custom_ps);
+
+    state->count = 0;
+    state->next = 0;
+    state->exhausted = false;
+
+    /* 바뀐 parameter 가 있으면 하위 scan 은 다음 ExecProcNode 에서 다시 시작한다 */
+    if (node->ss.ps.chgParam != NULL)
+        UpdateChangedParamSet(child, node->ss.ps.chgParam);
+    if (child->chgParam == NULL)
+        ExecReScan(child);
+}
+
+static void explain_batch_check(CustomScanState* node, List* ancestors, ExplainState* es)
+{
+    BatchCheckState* state = (BatchCheckState*)node;
+    CustomScan* cscan = (CustomScan*)node->ss.ps.plan;
+
+    if (cscan->custom_exprs != NIL)
+    {
+        List* context = set_deparse_context_plan(es->deparse_cxt, node->ss.ps.plan, ancestors);
+        char* checks = deparse_expression((Node*)make_ands_explicit(cscan->custom_exprs), context, es->verbose, false);
+
+        ExplainPropertyText("Check Filter", checks, es);
+    }
+    ExplainPropertyInteger("Check Block Size", NULL, state->block_size, es);
+}
+
+/* -------------------------------------------------------------------------
+ * Public API
+ * -------------------------------------------------------------------------
+ */
+void fga_batch_check_init(void)
+{
+    RegisterCustomScanMethods(&batch_check_scan_methods);
+
+    prev_set_rel_pathlist_hook = set_rel_pathlist_hook;
+    set_rel_pathlist_hook = batch_check_pathlist;
+}
+
+void fga_batch_check_fini(void)
+{
+    set_rel_pathlist_hook = prev_set_rel_pathlist_hook;
+}
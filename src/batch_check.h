@@ -0,0 +1,25 @@
+/*-------------------------------------------------------------------------
+ *
+ * batch_check.h
+ *    Batched evaluation of fga_check quals for PostFGA extension.
+ *
+ * WHERE fga_check('doc', id, 'user', $1, 'viewer') 처럼 테이블 하나의 행마다 부르는
+ * fga_check 는 행마다 채널 왕복 (캐시 miss 면 RPC) 을 기다린다.
+ * 이런 scan 을 CustomScan (FgaBatchCheck) 으로 감싸 fga.check_batch_size 행씩 읽고,
+ * 블록의 check 를 fga_check_batch 로 한 번에 보내 왕복을 블록당 한 번으로 줄인다.
+ *
+ * 다른 qual 은 하위 scan 이 먼저 거르고, 행 순서 (pathkeys) 는 그대로 유지한다.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef FGA_BATCH_CHECK_H
+#define FGA_BATCH_CHECK_H
+
+#include <postgres.h>
+
+/* planner hook 과 CustomScan 등록 (_PG_init) */
+void fga_batch_check_init(void);
+void fga_batch_check_fini(void);
+
+#endif /* FGA_BATCH_CHECK_H */
@@ -0,0 +1,164 @@
+extern "C"
+{
+#include <postgres.h>
+
+#include <miscadmin.h>
+#include <storage/latch.h>
+
+#include "change_feed.h"
+#include "generation.h"
+#include "stats.h"
+}
+
+#include <utility>
+
+#include "change_feed.hpp"
+
+namespace fga::bgw
+{
+    ChangeFeed::ChangeFeed(std::shared_ptr<fga::client::Client> client, const fga::ChangeFeedOptions& options)
+        : client_(std::move(client)),
+          options_(options),
+          inbox_(std::make_shared<Inbox>()),
+          next_poll_(Clock::now())
+    {
+        if (!enabled())
+            return;
+
+        char token[FGA_CHANGE_TOKEN_LEN];
+        if (fga_change_feed_load_token(options_.store_id.c_str(), token, sizeof(token)))
+        {
+            token_ = token;
+        }
+        else
+        {
+            /*
+             * 이어서 읽을 위치가 없음: 꺼져 있던 동안의 변경을 알 수 없으므로
+             * store 전체를 무효화하고 지금부터 읽는다 (token 을 받을 때까지 이 시각을 계속 쓴다).
+             */
+            start_time_ = std::chrono::system_clock::now();
+            fga_generation_bump_global();
+        }
+    }
+
+    bool ChangeFeed::enabled() const noexcept
+    {
+        return options_.poll_interval.count() > 0 && !options_.store_id.empty();
+    }
+
+    long ChangeFeed::timeout_ms() const noexcept
+    {
+        if (!enabled() || inflight_)
+            return -1;
+
+        const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(next_poll_ - Clock::now());
+        return std::max<long>(0, remaining.count());
+    }
+
+    bool ChangeFeed::collect()
+    {
+        if (!inflight_)
+            return true;
+
+        std::optional<fga::client::ReadChangesResult> result;
+        {
+            std::lock_guard<std::mutex> guard(inbox_->mu);
+            result.swap(inbox_->result);
+        }
+
+        if (!result)
+            return false;
+
+        inflight_ = false;
+        apply(*result);
+        return true;
+    }
+
+    void ChangeFeed::poll()
+    {
+        if (!enabled() || !collect())
+            return;
+
+        if (Clock::now() >= next_poll_)
+            start();
+    }
+
+    void ChangeFeed::start()
+    {
+        fga::client::ReadChangesQuery query{
+            .store_id = options_.store_id,
+            .continuation_token = token_,
+            .start_time = start_time_,
+            .page_size = options_.page_size,
+        };
+
+        inflight_ = true;
+        client_->read_changes(query, [inbox = inbox_](fga::client::ReadChangesResult&& result) {
+            {
+                std::lock_guard<std::mutex> guard(inbox->mu);
+                inbox->result = std::move(result);
+            }
+            SetLatch(MyLatch);
+        });
+    }
+
+    void ChangeFeed::apply(fga::client::ReadChangesResult& result)
+    {
+        if (!result.ok)
+        {
+            fga_stats_change_feed_poll(0, true);
+
+            if (result.invalid_token)
+            {
+                reset(result.error_message);
+            }
+            else if (!failing_)
+            {
+                ereport(LOG, errmsg("postfga: ReadChanges failed: %s", result.error_message.c_str()));
+            }
+
+            failing_ = true;
+            next_poll_ = Clock::now() + options_.poll_interval;
+            return;
+        }
+
+        if (failing_)
+        {
+            ereport(LOG, errmsg("postfga: ReadChanges recovered"));
+            failing_ = false;
+        }
+
+        for (const auto& change : result.changes)
+        {
+            fga_change_feed_apply(options_.store_id.c_str(), change.object.c_str(), change.user.c_str());
+        }
+        fga_stats_change_feed_poll(result.changes.size(), false);
+
+        if (!result.continuation_token.empty() && result.continuation_token != token_)
+        {
+            token_ = std::move(result.continuation_token);
+
+            if (token_.size() < FGA_CHANGE_TOKEN_LEN)
+                fga_change_feed_save_token(options_.store_id.c_str(), token_.c_str());
+        }
+
+        // 페이지가 가득 찼으면 밀린 변경이 더 있음: 바로 다음 페이지
+        if (static_cast<int>(result.changes.size()) >= options_.page_size)
+            next_poll_ = Clock::now();
+        else
+            next_poll_ = Clock::now() + options_.poll_interval;
+    }
+
+    void ChangeFeed::reset(const std::string& reason)
+    {
+        ereport(LOG,
+                errmsg("postfga: ReadChanges token rejected, invalidating store cache"),
+                errdetail("%s", reason.c_str()));
+
+        token_.clear();
+        fga_change_feed_save_token(options_.store_id.c_str(), "");
+        start_time_ = std::chrono::system_clock::now();
+        fga_generation_bump_global();
+        fga_stats_change_feed_reset();
+    }
+} // namespace fga::bgw
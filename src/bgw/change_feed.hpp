@@ -0,0 +1,64 @@
+// change_feed.hpp
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include "client/client.hpp"
+#include "config/config.hpp"
+
+namespace fga::bgw
+{
+    /**
+     * ReadChanges 를 주기적으로 호출해 Postgres 밖에서 일어난 tuple 변경을
+     * 캐시 generation 에 반영한다.
+     *
+     * 한 번에 RPC 하나만 띄운다. 응답은 gRPC 스레드에서 inbox 에 넣고 latch 만 깨우며,
+     * 실제 무효화와 token 저장은 BGW 메인 루프의 poll() 에서 한다.
+     * 한 페이지가 가득 차면 밀린 변경이 더 있다고 보고 곧바로 다음 페이지를 읽는다.
+     */
+    class ChangeFeed
+    {
+      public:
+        ChangeFeed(std::shared_ptr<fga::client::Client> client, const fga::ChangeFeedOptions& options);
+
+        bool enabled() const noexcept;
+
+        /* 다음 poll 까지 남은 시간 (ms). 비활성/RPC 진행 중이면 -1 */
+        long timeout_ms() const noexcept;
+
+        /* BGW 메인 루프에서 호출: 완료된 응답 반영 + 때가 되면 다음 RPC 시작 */
+        void poll();
+
+        /* 완료된 응답만 반영하고 새 RPC 는 시작하지 않는다. 진행 중인 RPC 가 없으면 true */
+        bool collect();
+
+      private:
+        using Clock = std::chrono::steady_clock;
+
+        /* gRPC 스레드와 공유: Processor 가 먼저 사라져도 안전하도록 shared_ptr 로 잡는다 */
+        struct Inbox
+        {
+            std::mutex mu;
+            std::optional<fga::client::ReadChangesResult> result;
+        };
+
+        void start();
+        void apply(fga::client::ReadChangesResult& result);
+        void reset(const std::string& reason);
+
+        std::shared_ptr<fga::client::Client> client_;
+        fga::ChangeFeedOptions options_;
+        std::shared_ptr<Inbox> inbox_;
+
+        std::string token_;
+        std::chrono::system_clock::time_point start_time_; /* token_ 이 빈 동안 읽기 시작할 시각 */
+        bool inflight_ = false;
+        bool failing_ = false; /* 연속 실패 중에는 로그를 한 번만 남긴다 */
+        Clock::time_point next_poll_;
+    };
+
+} // namespace fga::bgw
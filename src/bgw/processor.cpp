@@ -3,15 +3,24 @@ extern "C"
 #include <postgres.h>
 
 #include <miscadmin.h>
+#include <pgstat.h>
+#include <storage/latch.h>
 #include <storage/lwlock.h>
 #include <storage/proc.h>
 #include <storage/procarray.h>
 
+#include "cache.h"
+#include "list_cache.h"
+#include "relation.h"
 #include "state.h"
+#include "stats.h"
 }
 
+#include <algorithm>
 #include <cstring>
+#include <string_view>
 #include <utility>
+#include <vector>
 
 #include "channel.h"
 #include "payload.h"
@@ -22,12 +31,47 @@ namespace fga::bgw
 {
     static constexpr uint16_t MAX_BATCH = 50;
 
+    /* 백엔드와 같은 fga.cache_ttl_policy 로 TTL 을 정한다 */
+    static const FgaCacheTtl* cacheTtls(const FgaTuple& tuple, const FgaCacheStoreHint& hint, FgaCacheTtl* single)
+    {
+        return fga_cache_ttls(hint.grouped != 0,
+                              tuple.object_type,
+                              std::strlen(tuple.object_type),
+                              tuple.relation,
+                              std::strlen(tuple.relation),
+                              single);
+    }
+
+    void SlotCompletion::done() noexcept
+    {
+        slot_->timing.rpc_end_us = fga_clock_us();
+        owner_->enqueueCompleted(this);
+    }
+
     Processor::Processor(const fga::Config& config)
           : client_(fga::client::make_client(config)),
-          inflight_(1000)
+          inflight_(1000),
+          change_feed_(client_, config.changes),
+          completions_(std::make_unique<SlotCompletion[]>(fga_channel_slot_count()))
     {
     }
 
+    SlotCompletion& Processor::completionFor(FgaChannelSlot* slot) noexcept
+    {
+        SlotCompletion& completion = completions_[fga_channel_slot_index(slot)];
+        completion.owner_ = this;
+        completion.slot_ = slot;
+        completion.next_ = nullptr;
+
+        /* arena 블록은 슬롯을 반환할 때까지 유지되므로 RPC 가 끝날 때까지 유효 */
+        const FgaRequest& request = slot->payload.request;
+        if (request.arena_len > 0)
+            completion.bind(&slot->payload, std::string_view(fga_channel_arena_data(&request), request.arena_len));
+        else
+            completion.bind(&slot->payload);
+        return completion;
+    }
+
     void Processor::execute()
     {
         static constexpr uint32 MAX_BATCH = 50;
@@ -40,12 +84,21 @@ namespace fga::bgw
             FgaChannelSlot* slot = slots[0];
             if (beginProcessing(*slot))
             {
-                client_->process(slot->payload, [this, slot]() { enqueueCompleted(slot); });
+                if (slot->payload.request.type == FGA_REQUEST_CHECK_RELATIONS)
+                    checkRelations(slot);
+                else if (slot->payload.request.type == FGA_REQUEST_LIST)
+                    listObjects(slot);
+                else
+                {
+                    slot->timing.rpc_start_us = fga_clock_us();
+                    ++outstanding_;
+                    client_->process(completionFor(slot));
+                }
             }
         }
         else if (count > 1)
         {
-            fga::client::ProcessItem items[MAX_BATCH];
+            fga::client::Completion* items[MAX_BATCH];
             uint32 batch_count = 0;
 
             for (uint32 i = 0; i < count; ++i)
@@ -55,24 +108,153 @@ namespace fga::bgw
                 if (!beginProcessing(*slot))
                     continue;
 
-                // client_->process(slot->request, slot->response, [this, slot]()
-                // {
-                //     completeProcessing(slot);
-                // });
+                /* 자체 BatchCheck 로 보내므로 다른 요청과 묶지 않는다 */
+                if (slot->payload.request.type == FGA_REQUEST_CHECK_RELATIONS)
+                {
+                    checkRelations(slot);
+                    continue;
+                }
 
-                items[batch_count].payload = &slot->payload;
-                items[batch_count].callback = [this, slot]() { enqueueCompleted(slot); };
-                ++batch_count;
+                /* 스트리밍 RPC 라서 결과를 슬롯 밖 (list cache) 으로 받는다 */
+                if (slot->payload.request.type == FGA_REQUEST_LIST)
+                {
+                    listObjects(slot);
+                    continue;
+                }
+
+                slots[batch_count] = slot;
+                items[batch_count++] = &completionFor(slot);
             }
 
             if (batch_count > 0)
             {
-                std::span<fga::client::ProcessItem> span(items, batch_count);
+                const uint64 now = fga_clock_us();
+                for (uint32 i = 0; i < batch_count; ++i)
+                    slots[i]->timing.rpc_start_us = now;
+                outstanding_ += batch_count;
+
+                std::span<fga::client::Completion*> span(items, batch_count);
                 client_->process_batch(span);
             }
         }
 
         drainCompleted();
+
+        change_feed_.poll();
+
+        publishStats();
+    }
+
+    /* 비트 mask 를 레지스트리에서 relation 이름으로 바꿔 client 에 넘긴다 */
+    void Processor::checkRelations(FgaChannelSlot* slot)
+    {
+        const FgaCheckRelationsRequest& req = slot->payload.request.body.checkRelations;
+        const char* names[RELATION_BITS_PER_TYPE];
+        std::vector<fga::client::RelationName> relations;
+
+        fga_relation_names(req.tuple.object_type, req.relations, names);
+
+        relations.reserve(FGA_CHECK_RELATIONS_MAX);
+        for (int bit = 0; bit < RELATION_BITS_PER_TYPE; ++bit)
+        {
+            if (names[bit] != nullptr)
+                relations.push_back({static_cast<uint8_t>(bit), names[bit]});
+        }
+
+        /* 물은 relation 은 백엔드가 tuple 에도 넣어 보내므로 레지스트리와 상관없이 포함 */
+        if (names[req.relation_bit] == nullptr)
+            relations.push_back({req.relation_bit, req.tuple.relation});
+
+        slot->timing.rpc_start_us = fga_clock_us();
+        ++outstanding_;
+        client_->check_relations(completionFor(slot), std::move(relations));
+    }
+
+    void Processor::listObjects(FgaChannelSlot* slot)
+    {
+        SlotCompletion& completion = completionFor(slot);
+
+        completion.objects_.clear();
+        slot->payload.request.body.listObjects.max_bytes = fga_list_cache_max_bytes();
+        slot->timing.rpc_start_us = fga_clock_us();
+        ++outstanding_;
+        client_->list_objects(completion, completion.objects_);
+    }
+
+    /*
+     * StreamedListObjects 결과를 정렬/중복 제거해 list cache 에 저장하고 그 위치를 응답에 채운다.
+     * 백엔드는 응답을 받은 뒤 (entry, serial) 로 읽는다.
+     */
+    void Processor::storeObjects(FgaChannelSlot& slot)
+    {
+        std::vector<std::string> objects = std::move(completions_[fga_channel_slot_index(&slot)].objects_);
+        const FgaRequest& req = slot.payload.request;
+        FgaResponse& res = slot.payload.response;
+
+        if (res.status != FGA_RESPONSE_OK)
+            return;
+
+        std::sort(objects.begin(), objects.end());
+        objects.erase(std::unique(objects.begin(), objects.end()), objects.end());
+
+        std::vector<const char*> ids;
+        std::vector<uint32> lens;
+        ids.reserve(objects.size());
+        lens.reserve(objects.size());
+        for (const std::string& object : objects)
+        {
+            ids.push_back(object.data());
+            lens.push_back(static_cast<uint32>(object.size()));
+        }
+
+        FgaListObjectsResponse& out = res.body.listObjects;
+        switch (fga_list_cache_store(&req.body.listObjects.cache,
+                                     ids.data(),
+                                     lens.data(),
+                                     static_cast<uint32>(ids.size()),
+                                     &out.entry,
+                                     &out.serial))
+        {
+        case FGA_LIST_STORE_OK:
+            out.count = static_cast<uint32>(ids.size());
+            break;
+        case FGA_LIST_STORE_TOO_LARGE:
+            res.status = FGA_RESPONSE_CLIENT_ERROR;
+            snprintf(res.error_message,
+                     sizeof(res.error_message),
+                     "%zu objects do not fit in fga.list_cache_size",
+                     objects.size());
+            break;
+        case FGA_LIST_STORE_ID_TOO_LONG:
+            res.status = FGA_RESPONSE_CLIENT_ERROR;
+            snprintf(res.error_message, sizeof(res.error_message), "object id longer than %d bytes", FGA_LIST_ID_MAX_LEN);
+            break;
+        }
+    }
+
+    long Processor::waitTimeoutMs() const noexcept
+    {
+        return change_feed_.timeout_ms();
+    }
+
+    /*
+     * gRPC reactor 는 SlotCompletion 과 client 의 PooledChannel 을 참조하므로,
+     * processor 를 바꾸거나 버리기 전에 넘긴 요청이 모두 돌아와야 한다.
+     * RPC 마다 deadline 이 있으므로 끝이 있다. 그동안 새 요청은 큐에 남아 다음 processor 가 처리한다.
+     * 기다리는 백엔드가 없는 갱신 요청 (DETACHED) 도 여기서 처리되어 슬롯이 반환된다.
+     */
+    void Processor::drain()
+    {
+        drainCompleted();
+
+        while (outstanding_ > 0 || !change_feed_.collect())
+        {
+            (void)WaitLatch(MyLatch, WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH, 100L, PG_WAIT_EXTENSION);
+            ResetLatch(MyLatch);
+            CHECK_FOR_INTERRUPTS();
+
+            drainCompleted();
+        }
     }
 
     bool Processor::beginProcessing(FgaChannelSlot& slot) noexcept
@@ -98,32 +280,49 @@ namespace fga::bgw
     }
 
     // 완료된 슬롯을 BGW 메인 루프에 알림 (외부 Thread에서 호출되므로 절대 postgresql 함수 호출 금지)
-    void Processor::enqueueCompleted(FgaChannelSlot* slot) noexcept
+    void Processor::enqueueCompleted(SlotCompletion* completion) noexcept
     {
+        SlotCompletion* head = completed_head_.load(std::memory_order_relaxed);
+        do
         {
-            std::lock_guard<std::mutex> lock(completed_mu_);
-            completed_queue_.push_back(slot);
-        }
+            completion->next_ = head;
+        } while (!completed_head_.compare_exchange_weak(
+            head, completion, std::memory_order_release, std::memory_order_relaxed));
+
         SetLatch(MyLatch);
     }
 
     void Processor::drainCompleted() noexcept
     {
-        std::vector<FgaChannelSlot*> local;
+        SlotCompletion* head = completed_head_.exchange(nullptr, std::memory_order_acquire);
+        SlotCompletion* ordered = nullptr;
+
+        // 스택(LIFO)을 뒤집어 완료 순서대로 처리
+        while (head != nullptr)
         {
-            std::lock_guard<std::mutex> lock(completed_mu_);
-            if (completed_queue_.empty())
-            {
-                return;
-            }
+            SlotCompletion* next = head->next_;
+            head->next_ = ordered;
+            ordered = head;
+            head = next;
+        }
 
-            local.swap(completed_queue_);
-            completed_queue_.reserve(10);
+        while (ordered != nullptr)
+        {
+            SlotCompletion* next = ordered->next_;
+            handleResponse(*ordered->slot_);
+            ordered = next;
         }
+    }
+
+    void Processor::publishStats() noexcept
+    {
+        fga::client::ChannelStats stats[FGA_GRPC_CHANNELS_MAX];
+        std::size_t count = client_->channel_stats(stats);
 
-        for (auto* slot : local)
+        fga_stats_set_grpc_channel_count(count);
+        for (std::size_t i = 0; i < count; ++i)
         {
-            handleResponse(*slot);
+            fga_stats_set_grpc_channel(i, stats[i].inflight, stats[i].calls, stats[i].errors, stats[i].state);
         }
     }
 
@@ -131,23 +330,89 @@ namespace fga::bgw
     {
         auto state = (FgaChannelSlotState)pg_atomic_read_u32(&slot.state);
 
+        --outstanding_;
+
+        if (slot.payload.request.flags & FGA_REQUEST_FLAG_DETACHED)
+        {
+            completeDetached(slot);
+            return;
+        }
+
         if (state == FGA_CHANNEL_SLOT_CANCELED)
         {
             /* 백엔드가 이미 포기한 요청:
              * - Latch 깨울 필요 없음
              * - BGW가 대신 슬롯을 반환
              */
+            if (slot.payload.request.type == FGA_REQUEST_LIST)
+                completions_[fga_channel_slot_index(&slot)].objects_ = {};
             fga_channel_release_slot(&slot);
             return;
         }
 
         // 정상 완료된 요청 작업
         // slot->response = resp;
+        if (slot.payload.request.type == FGA_REQUEST_LIST)
+        {
+            try
+            {
+                storeObjects(slot);
+            }
+            catch (const std::exception& e)
+            {
+                slot.payload.response.status = FGA_RESPONSE_SERVER_ERROR;
+                strlcpy(slot.payload.response.error_message, e.what(), sizeof(slot.payload.response.error_message));
+            }
+        }
+        slot.timing.complete_us = fga_clock_us();
         pg_write_barrier();
         pg_atomic_write_u32(&slot.state, FGA_CHANNEL_SLOT_DONE);
         wakeBackend(slot);
     }
 
+    /*
+     * 기다리는 백엔드가 없는 요청 (stale-while-revalidate 갱신): 결과를 L2 에 저장하고 슬롯 반환.
+     * 실패하면 갱신 요청 표시를 지워 다음 hit 가 다시 요청하게 한다.
+     * 재설정/종료 시 Processor::drain 이 이 요청들까지 끝나기를 기다리므로 슬롯과 표시가 남지 않는다.
+     */
+    void Processor::completeDetached(FgaChannelSlot& slot)
+    {
+        const FgaRequest& req = slot.payload.request;
+        const FgaResponse& res = slot.payload.response;
+
+        FgaCacheTtl single;
+
+        if (req.type == FGA_REQUEST_CHECK && res.status == FGA_RESPONSE_OK)
+        {
+            const FgaCacheStoreHint& hint = req.body.checkTuple.cache;
+            const uint64 bit = UINT64CONST(1) << hint.relation_id;
+
+            fga_cache_store_shared(&hint,
+                                   cacheTtls(req.body.checkTuple.tuple, hint, &single),
+                                   res.body.checkTuple.allow ? bit : 0,
+                                   bit);
+        }
+        else if (req.type == FGA_REQUEST_CHECK_RELATIONS && res.status == FGA_RESPONSE_OK)
+        {
+            const FgaCacheStoreHint& hint = req.body.checkRelations.cache;
+
+            fga_cache_store_shared(&hint,
+                                   cacheTtls(req.body.checkRelations.tuple, hint, &single),
+                                   res.body.checkRelations.allowed,
+                                   res.body.checkRelations.known);
+        }
+        else if (req.type == FGA_REQUEST_CHECK)
+        {
+            fga_cache_release_refresh(&req.body.checkTuple.cache);
+        }
+        else if (req.type == FGA_REQUEST_CHECK_RELATIONS)
+        {
+            fga_cache_release_refresh(&req.body.checkRelations.cache);
+        }
+
+        fga_channel_release_slot(&slot);
+    }
+
     void Processor::handleException(FgaChannelSlot& slot, const char* msg) noexcept
     {
         ereport(WARNING, errmsg("postfga: exception in processing request: %s", msg ? msg : "unknown"));
@@ -1,8 +1,12 @@
 // processor.hpp
 #pragma once
 
+#include <atomic>
 #include <memory>
+#include <string>
+#include <vector>
 
+#include "change_feed.hpp"
 #include "client/client.hpp"
 #include "config/config.hpp"
 #include "util/counter.hpp"
@@ -12,27 +16,66 @@ struct FgaChannelSlot;
 
 namespace fga::bgw
 {
+    class Processor;
+
+    /**
+     * 슬롯별 완료 hook. 슬롯 인덱스와 1:1 로 미리 할당되며,
+     * 완료 시 lock-free intrusive 스택(completed_head_)에 자신을 올린다.
+     */
+    class SlotCompletion final : public fga::client::Completion
+    {
+      public:
+        void done() noexcept override;
+
+      private:
+        friend class Processor;
+
+        Processor* owner_ = nullptr;
+        FgaChannelSlot* slot_ = nullptr;
+        SlotCompletion* next_ = nullptr;
+
+        /* FGA_REQUEST_LIST: gRPC 스레드가 채우고 done() 뒤 BGW 메인 스레드가 list cache 로 옮긴다 */
+        std::vector<std::string> objects_;
+    };
+
     class Processor
     {
       public:
         explicit Processor(const fga::Config& config);
         void execute();
 
+        /* 다음에 깨어나야 할 때까지 남은 시간 (ms, -1 = latch 만 기다림) */
+        long waitTimeoutMs() const noexcept;
+
+        /* client 에 넘긴 요청과 change feed RPC 가 모두 끝날 때까지 기다린다 (processor 를 버리기 전에) */
+        void drain();
+
       private:
+        friend class SlotCompletion;
+
         bool beginProcessing(FgaChannelSlot& slot) noexcept;
+        void checkRelations(FgaChannelSlot* slot);
+        void listObjects(FgaChannelSlot* slot);
+        void storeObjects(FgaChannelSlot& slot);
         void handleResponse(FgaChannelSlot& slot);
+        void completeDetached(FgaChannelSlot& slot);
         void handleException(FgaChannelSlot& slot, const char* msg) noexcept;
         void wakeBackend(FgaChannelSlot& slot);
 
-        void enqueueCompleted(FgaChannelSlot* slot) noexcept;
+        SlotCompletion& completionFor(FgaChannelSlot* slot) noexcept;
+        void enqueueCompleted(SlotCompletion* completion) noexcept;
         void drainCompleted() noexcept;
 
+        void publishStats() noexcept;
+
       private:
         std::shared_ptr<fga::client::Client> client_;
         fga::util::Counter inflight_;
+        ChangeFeed change_feed_;
 
-        std::mutex completed_mu_;
-        std::vector<FgaChannelSlot*> completed_queue_;
+        std::unique_ptr<SlotCompletion[]> completions_;
+        uint32_t outstanding_ = 0; /* client 에 넘겼고 handleResponse 를 아직 거치지 않은 슬롯 (메인 스레드 전용) */
+        std::atomic<SlotCompletion*> completed_head_{nullptr};
     };
 
 } // namespace fga::bgw
@@ -8,8 +8,13 @@ extern "C"
 #include <storage/ipc.h>
 #include <storage/latch.h>
 #include <utils/guc.h>
+
+#include "cache.h"
+#include "config.h"
 }
 
+#include <algorithm>
+#include <chrono>
 #include <optional>
 
 #include "config/config.hpp"
@@ -56,6 +61,22 @@ bgw_sighup_handler(SIGNAL_ARGS)
 
 namespace fga::bgw
 {
+    namespace
+    {
+        bool cache_persistence_enabled()
+        {
+            FgaConfig* config = fga_get_config();
+            return config->cache_enabled && config->cache_prewarm;
+        }
+
+        void dump_cache(const char* when, bool shutdown)
+        {
+            int64 count = fga_cache_dump_file(LOG, shutdown);
+            if (count >= 0)
+                ereport(DEBUG1, (errmsg("postfga: dumped %lld cache entries (%s)", (long long)count, when)));
+        }
+    } // anonymous namespace
+
     Worker::Worker(FgaState* state)
         : state_(state)
     {
@@ -91,6 +112,17 @@ namespace fga::bgw
 
     void Worker::process()
     {
+        /*
+         * 재시작 직후 OpenFGA 로 요청이 몰리지 않도록 이전 L2 내용을 적재.
+         * 덤프에 change feed 위치가 있으면 feed 를 그 token 으로 되감으므로 processor 를 만들기 전에 해야 한다.
+         */
+        if (cache_persistence_enabled())
+        {
+            int64 loaded = fga_cache_prewarm();
+            if (loaded > 0)
+                ereport(LOG, (errmsg("postfga: prewarmed %lld cache entries", (long long)loaded)));
+        }
+
         std::optional<Processor> processor;
         auto config = fga::load_config_from_guc();
         if(!config.endpoint.empty())
@@ -98,16 +130,36 @@ namespace fga::bgw
             processor.emplace(config);
         }
 
+        using Clock = std::chrono::steady_clock;
+        Clock::time_point next_dump = Clock::now() + std::chrono::seconds(fga_get_config()->cache_dump_interval_s);
+
         while (!shutdown_requested)
         {
-            // wait for work or signal
-            int rc = WaitLatch(MyLatch, WL_LATCH_SET | WL_EXIT_ON_PM_DEATH, -1, PG_WAIT_EXTENSION);
+            // wait for work or signal (change feed / 주기적 덤프 시각까지)
+            long timeout = processor ? processor->waitTimeoutMs() : -1;
+            const int dump_interval_s = fga_get_config()->cache_dump_interval_s;
+
+            if (cache_persistence_enabled() && dump_interval_s > 0)
+            {
+                const Clock::time_point now = Clock::now();
+                if (now >= next_dump)
+                {
+                    dump_cache("periodic", false);
+                    next_dump = now + std::chrono::seconds(dump_interval_s);
+                }
+
+                long until_dump = std::chrono::duration_cast<std::chrono::milliseconds>(next_dump - now).count();
+                timeout = timeout < 0 ? until_dump : std::min(timeout, until_dump);
+            }
+
+            int events = WL_LATCH_SET | WL_EXIT_ON_PM_DEATH | (timeout >= 0 ? WL_TIMEOUT : 0);
+            int rc = WaitLatch(MyLatch, events, timeout, PG_WAIT_EXTENSION);
 
             ResetLatch(MyLatch);
 
             CHECK_FOR_INTERRUPTS();
 
-            if (!(rc & WL_LATCH_SET))
+            if (!(rc & (WL_LATCH_SET | WL_TIMEOUT)))
                 continue;
 
             // handle config reload
@@ -119,16 +171,28 @@ namespace fga::bgw
                 auto new_config = fga::load_config_from_guc();
                 if (new_config != config)
                 {
+                    /* 진행 중인 RPC 가 이전 processor 의 completion/channel 을 참조하므로 먼저 끝낸다 */
+                    if (processor)
+                        processor->drain();
+
                     if (!new_config.endpoint.empty())
                         processor.emplace(new_config);
                     else
-                        processor.reset();                
+                        processor.reset();
+
+                    config = std::move(new_config);
                 }
             }
 
             if (processor)
                 processor->execute();
         }
+
+        if (processor)
+            processor->drain();
+
+        if (cache_persistence_enabled())
+            dump_cache("shutdown", true);
     }
 } // namespace fga::bgw
 
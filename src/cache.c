@@ -1,9 +1,10 @@
 #include <postgres.h>
 
 #include <access/xact.h>
+#include <miscadmin.h>
+#include <storage/fd.h>
 #include <storage/lwlock.h>
 #include <storage/shmem.h>
-#include <utils/hsearch.h>
 #include <utils/memutils.h>
 #include <varatt.h>
 #include <xxhash.h>
@@ -12,9 +13,46 @@
 #include "cache_key.h"
 #include "cache_l1.h"
 #include "cache_l2.h"
+#include "change_feed.h"
+#include "list_cache.h"
 #include "postfga.h"
+#include "relation.h"
 #include "stats.h"
 
+/*
+ * 덤프 파일 ($PGDATA 기준)
+ *   header   : magic, version, entry count, flags, 덤프 시점의 change feed 위치 (store, token), relation count
+ *   record   : key.low, key.high, object/subject generation slot, expires_at_ms, allowed mask, known mask
+ *              (44 bytes, host byte order)
+ *   relation : 레코드 뒤에 relation 등록 표 (object_type, relation, bit) 를 등록 순서대로
+ */
+#define FGA_CACHE_DUMP_FILE "postfga_cache.dump"
+#define FGA_CACHE_DUMP_MAGIC 0x41474650 /* "PFGA" */
+#define FGA_CACHE_DUMP_VERSION 6
+#define FGA_CACHE_DUMP_RECORD_SIZE (4 * sizeof(uint64) + 2 * sizeof(uint16) + sizeof(TimestampTz))
+
+/* header.flags */
+#define FGA_CACHE_DUMP_SHUTDOWN 0x0001 /* BGW 종료 시 덤프: 그 뒤로 이 서버를 거친 쓰기가 없다 */
+
+typedef struct FgaCacheDumpHeader
+{
+    uint32 magic;
+    uint32 version;
+    uint64 count;
+    uint32 flags;
+    char store_id[OPENFGA_STORE_ID_LEN]; /* token 이 속한 store ("" = change feed 꺼짐) */
+    char token[FGA_CHANGE_TOKEN_LEN];    /* 덤프 시점까지 반영한 change feed token */
+    uint32 relation_count;               /* 레코드 뒤의 FgaCacheDumpRelation 수 */
+} FgaCacheDumpHeader;
+
+/* allowed/known 비트가 어느 relation 인지 (재시작하면 등록 순서가 달라질 수 있음) */
+typedef struct FgaCacheDumpRelation
+{
+    char object_type[OBJECT_TYPE_MAX_LEN];
+    char relation_name[RELATION_MAX_LEN];
+    uint32 bit_index;
+} FgaCacheDumpRelation;
+
 static inline TimestampTz get_now_ms(void)
 {
     // TimestampTz tx_ts = GetCurrentTransactionStartTimestamp();
@@ -26,81 +64,236 @@ static inline TimestampTz get_now_ms(void)
     return now / 1000; // convert microseconds → ms
 }
 
+/* comma-separated 목록(fga.cache_transitive_types)에 type 이 있는지. '*' 는 모든 type */
+static bool type_in_list(const char* list, const char* type, size_t type_len)
+{
+    const char* p = list;
+
+    if (list == NULL)
+        return false;
+
+    while (*p != '\0')
+    {
+        const char* start;
+        const char* end;
+
+        while (*p == ' ' || *p == ',')
+            p++;
+        start = p;
+        while (*p != '\0' && *p != ',')
+            p++;
+        end = p;
+        while (end > start && end[-1] == ' ')
+            end--;
+
+        if (end - start == 1 && *start == '*')
+            return true;
+        if ((size_t)(end - start) == type_len && strncmp(start, type, type_len) == 0)
+            return true;
+    }
+    return false;
+}
+
 Size fga_cache_shmem_base_size(void)
 {
-    Size capacity = l2_capacity_from_config();
+    Size group_count = l2_group_count_from_config();
 
     /* cache structure */
-    Size size = offsetof(FgaL2AclCache, entries);
+    Size size = offsetof(FgaL2AclCache, groups);
+
+    /* groups 배열 */
+    size = add_size(size, mul_size(sizeof(FgaL2Group), group_count));
 
-    /* entries 배열 */
-    size = add_size(size, mul_size(sizeof(FgaL2AclEntry), capacity));
+    /* admission 빈도 sketch */
+    size = MAXALIGN(size);
+    size = add_size(size, sketch_shmem_size(group_count * FGA_L2_GROUP_SIZE));
 
     return size;
 }
 
-Size fga_cache_shmem_hash_size(void)
+void fga_cache_shmem_init(FgaL2AclCache* cache)
 {
-    Size capacity = l2_capacity_from_config();
-    Size hash_size = l2_hash_size(capacity);
+    Size group_count = l2_group_count_from_config();
 
-    return hash_estimate_size(hash_size, sizeof(FgaL2AclSlot));
+    /* initialize cache struct */
+    MemSet(cache, 0, offsetof(FgaL2AclCache, groups));
+    cache->group_count = group_count;
+    cache->group_mask = group_count - 1;
+    cache->capacity = group_count * FGA_L2_GROUP_SIZE;
+    pg_atomic_init_u32(&cache->prewarmed, 0);
+    cache->epoch_ms = get_now_ms();
+
+    // groups 초기화
+    for (uint32 g = 0; g < cache->group_count; g++)
+    {
+        FgaL2Group* group = &cache->groups[g];
+
+        MemSet(group, 0, sizeof(*group));
+        pg_atomic_init_u32(&group->version, 0);
+        MemSet(group->tags, FGA_PROBE_TAG_EMPTY, sizeof(group->tags));
+        for (int i = 0; i < FGA_L2_GROUP_SIZE; i++)
+            pg_atomic_init_u32(&group->refresh[i], 0);
+    }
+
+    cache->sketch = (FgaFreqSketch*)((char*)cache + MAXALIGN(offsetof(FgaL2AclCache, groups) +
+                                                             sizeof(FgaL2Group) * group_count));
+    sketch_init(cache->sketch, cache->capacity);
 }
 
-void fga_cache_shmem_init(FgaL2AclCache* cache, LWLock* lock)
+/* L2 저장 + eviction/admission 통계 */
+static void store_shared(FgaL2AclCache* l2,
+                         const FgaAclCacheKey* key,
+                         const FgaGenerationSnapshot* snapshot,
+                         TimestampTz now_ms,
+                         TimestampTz expires_at,
+                         uint64 allowed,
+                         uint64 known)
 {
-    Size capacity = l2_capacity_from_config();
-    /* initialize cache struct */
-    MemSet(cache, 0, offsetof(FgaL2AclCache, entries));
-    cache->lock = lock;
-    cache->capacity = capacity;
-    cache->generation = 0;
-    pg_atomic_init_u32(&cache->nextVictim, 0);
+    FgaConfig* config = fga_get_config();
 
-    // entries 초기화
-    for (uint32 i = 0; i < cache->capacity; i++)
-        cache->entries[i].valid = false;
+    switch (l2_store(l2, key, snapshot, now_ms, expires_at, allowed, known, config->cache_admission))
+    {
+    case FGA_L2_STORE_EVICTED:
+        fga_stats_l2_eviction();
+        break;
+    case FGA_L2_STORE_REJECTED:
+        fga_stats_l2_admission_reject();
+        break;
+    default:
+        break;
+    }
+}
+
+/* stale-while-revalidate 구간: 가장 짧은 TTL 의 절반을 넘지 않게 */
+static inline TimestampTz refresh_window_ms(const FgaConfig* config)
+{
+    return Min(config->cache_refresh_window_ms, fga_cache_ttl_min_ms() / 2);
+}
+
+static inline int32 relation_ttl(const FgaCacheTtl* ttl, bool allowed)
+{
+    int32 ms = allowed ? ttl->allow_ms : ttl->deny_ms;
+
+    return ms == FGA_CACHE_TTL_DEFAULT ? fga_get_config()->cache_ttl_ms : ms;
+}
+
+/*
+ * 엔트리 만료 시각: key 의 relation 결과의 TTL.
+ * 그보다 TTL 이 짧은 다른 relation 은 known 에서 뺀다 (엔트리 수명이 가장 짧은 결과에 묶이지 않게).
+ * key 의 relation 결과를 캐시하지 않는 정책(TTL 0)이면 false
+ */
+static bool expires_for(const FgaAclCacheKey* key,
+                        const FgaCacheTtl* ttls,
+                        uint64 allowed,
+                        uint64* known,
+                        TimestampTz now_ms,
+                        TimestampTz* expires_out)
+{
+    uint64 bit = FGA_CACHE_RELATION_BIT(key);
+    int32 ttl = relation_ttl(&ttls[key->relation_id], (allowed & bit) != 0);
+    uint64 rest = *known & ~bit;
+
+    if (ttl <= 0 || (*known & bit) == 0)
+        return false;
+
+    while (rest != 0)
+    {
+        int other = pg_rightmost_one_pos64(rest);
+
+        if (relation_ttl(&ttls[other], ((allowed >> other) & 1) != 0) < ttl)
+            *known &= ~(UINT64CONST(1) << other);
+        rest &= rest - 1;
+    }
+
+    *expires_out = now_ms + ttl;
+    return true;
 }
 
-void fga_cache_shmem_each_startup(void)
+/* relation 별 hit ratio (fga_cache_summary). 레지스트리에 없는 relation 은 세지 않는다 */
+static inline void count_relation(const FgaAclCacheKey* key, bool hit)
 {
-    l1_startup();
-    l2_startup();
+    if (key->grouped)
+        fga_relation_count(key->relation_slot, hit);
 }
 
-bool fga_cache_lookup(const FgaAclCacheKey* key, bool* allowed_out)
+bool fga_cache_lookup(const FgaAclCacheKey* key,
+                      bool* allowed_out,
+                      FgaGenerationSnapshot* snapshot_out,
+                      bool* refresh_out)
 {
     FgaL2AclCache* l2;
     TimestampTz now_ms;
     TimestampTz expires_at;
+    TimestampTz window;
 
     FgaConfig* config = fga_get_config();
+
+    *refresh_out = false;
+
+    /*
+     * 조회 시점의 generation 을 먼저 잡아 둔다.
+     * miss 후 RPC 결과를 저장할 때 이 값을 그대로 쓰므로,
+     * RPC 도중 write 로 generation 이 올라가면 저장된 결과는 바로 무효가 된다.
+     */
+    fga_generation_snapshot(key->object_key, key->subject_key, snapshot_out);
+
     if (!config->cache_enabled)
         return false;
 
     l2 = l2_cache();
 
     now_ms = get_now_ms();
+    window = refresh_window_ms(config);
 
-    if (l1_lookup(key, l2->generation, now_ms, allowed_out))
+    /* L1 은 갱신 구간에 들어선 엔트리를 만료로 본다: 갱신 여부는 L2 에서 한 번만 판단 */
+    if (l1_lookup(key, snapshot_out, now_ms + window, allowed_out))
     {
         fga_stats_l1_hit();
+        count_relation(key, true);
         return true;
     }
     fga_stats_l1_miss();
 
-    if (l2_lookup(l2, key, now_ms, allowed_out, &expires_at))
+    /* admission 빈도는 L2 까지 온 조회만 센다 (L1 hit 마다 shared memory 를 건드리지 않게) */
+    if (config->cache_admission && l2 != NULL)
+        sketch_increment(l2->sketch, key);
+
+    if (l2_lookup(l2, key, snapshot_out, now_ms, window, allowed_out, &expires_at, refresh_out))
     {
-        // L1 캐시에 복사
-        l1_store(key, l2->generation, expires_at, *allowed_out);
+        // L1 캐시에 복사 (갱신 구간이면 L1 에서 곧바로 만료되므로 생략)
+        if (expires_at - now_ms > window)
+            l1_store(key,
+                     snapshot_out,
+                     now_ms,
+                     expires_at,
+                     *allowed_out ? FGA_CACHE_RELATION_BIT(key) : 0,
+                     FGA_CACHE_RELATION_BIT(key));
         fga_stats_l2_hit();
+        if (*refresh_out)
+            fga_stats_l2_refresh();
+        count_relation(key, true);
         return true;
     }
     fga_stats_l2_miss();
+    count_relation(key, false);
     return false;
 }
 
-void fga_cache_store(const FgaAclCacheKey* key, bool allowed)
+void fga_cache_store(const FgaAclCacheKey* key,
+                     bool allowed,
+                     const FgaCacheTtl* ttls,
+                     const FgaGenerationSnapshot* snapshot)
+{
+    uint64 bit = FGA_CACHE_RELATION_BIT(key);
+
+    fga_cache_store_relations(key, allowed ? bit : 0, bit, ttls, snapshot);
+}
+
+void fga_cache_store_relations(const FgaAclCacheKey* key,
+                               uint64 allowed,
+                               uint64 known,
+                               const FgaCacheTtl* ttls,
+                               const FgaGenerationSnapshot* snapshot)
 {
     FgaL2AclCache* l2;
     TimestampTz now_ms;
@@ -112,8 +305,484 @@ void fga_cache_store(const FgaAclCacheKey* key, bool allowed)
 
     l2 = l2_cache();
     now_ms = get_now_ms();
-    expires_at = now_ms + config->cache_ttl_ms;
-    
-    l1_store(key, l2->generation, expires_at, allowed);
-    l2_store(l2, key, now_ms, expires_at, allowed);
+    if (!expires_for(key, ttls, allowed, &known, now_ms, &expires_at))
+        return;
+
+    l1_store(key, snapshot, now_ms, expires_at, allowed, known);
+    store_shared(l2, key, snapshot, now_ms, expires_at, allowed, known);
+}
+
+void fga_cache_store_hint(FgaCacheStoreHint* hint, const FgaAclCacheKey* key, const FgaGenerationSnapshot* snapshot)
+{
+    hint->key_low = key->low;
+    hint->key_high = key->high;
+    hint->object_key = key->object_key;
+    hint->subject_key = key->subject_key;
+    hint->relation_id = key->relation_id;
+    hint->grouped = key->grouped;
+    hint->gen_global = snapshot->global;
+    hint->gen_object = snapshot->object;
+    hint->gen_subject = snapshot->subject;
+}
+
+static void key_from_hint(FgaAclCacheKey* key, const FgaCacheStoreHint* hint)
+{
+    MemSet(key, 0, sizeof(*key));
+    key->low = hint->key_low;
+    key->high = hint->key_high;
+    key->object_key = hint->object_key;
+    key->subject_key = hint->subject_key;
+    key->relation_id = hint->relation_id;
+    key->grouped = hint->grouped;
+    key->relation_slot = RELATION_SLOT_NONE;
+}
+
+void fga_cache_store_shared(const FgaCacheStoreHint* hint, const FgaCacheTtl* ttls, uint64 allowed, uint64 known)
+{
+    FgaAclCacheKey key;
+    FgaGenerationSnapshot snapshot;
+    TimestampTz now_ms;
+    TimestampTz expires_at;
+
+    FgaConfig* config = fga_get_config();
+    if (!config->cache_enabled)
+        return;
+
+    key_from_hint(&key, hint);
+    snapshot.global = hint->gen_global;
+    snapshot.object = hint->gen_object;
+    snapshot.subject = hint->gen_subject;
+
+    now_ms = get_now_ms();
+    if (expires_for(&key, ttls, allowed, &known, now_ms, &expires_at))
+        store_shared(l2_cache(), &key, &snapshot, now_ms, expires_at, allowed, known);
+}
+
+void fga_cache_release_refresh(const FgaCacheStoreHint* hint)
+{
+    FgaAclCacheKey key;
+
+    if (!fga_get_config()->cache_enabled)
+        return;
+
+    key_from_hint(&key, hint);
+    l2_release_refresh(l2_cache(), &key);
+}
+
+/*
+ * 전이적 변경 판정: subject 가 userset(group:eng#member) 이면 그 집합을 통해
+ * 권한을 얻는 모든 object 가, 다른 object 가 참조하는 type(group, folder 등)이면
+ * 그 type 을 거쳐 권한을 얻는 object 가 영향을 받는다. 어느 object 인지 알 수 없으므로 store 전체를 무효화.
+ * 모델을 읽지 않으므로 기본값 ('*') 은 모든 쓰기를 전이적으로 본다.
+ */
+static bool is_transitive_change(const char* object_type, size_t type_len, const char* subject, size_t subject_len)
+{
+    FgaConfig* config = fga_get_config();
+
+    return memchr(subject, '#', subject_len) != NULL ||
+           type_in_list(config->cache_transitive_types, object_type, type_len);
+}
+
+static void invalidate(uint64 object_key, bool transitive)
+{
+    /* 목록은 어느 object 가 더해지거나 빠지는지 모르므로 항상 */
+    fga_list_cache_bump();
+
+    if (transitive)
+        fga_generation_bump_global();
+    else
+        fga_generation_bump_object(object_key);
+}
+
+void fga_cache_invalidate_tuple(const FgaAclCacheKey* key, const text* object_type, const text* subject_id)
+{
+    invalidate(key->object_key,
+               is_transitive_change(VARDATA_ANY(object_type),
+                                    VARSIZE_ANY_EXHDR(object_type),
+                                    VARDATA_ANY(subject_id),
+                                    VARSIZE_ANY_EXHDR(subject_id)));
+}
+
+void fga_cache_invalidate_object(const char* store_id,
+                                 const char* object_type,
+                                 size_t type_len,
+                                 const char* object_id,
+                                 size_t id_len,
+                                 const char* subject,
+                                 size_t subject_len)
+{
+    invalidate(fga_cache_object_key(store_id, object_type, type_len, object_id, id_len),
+               is_transitive_change(object_type, type_len, subject, subject_len));
+}
+
+/*-------------------------------------------------------------------------
+ * Introspection
+ *-------------------------------------------------------------------------*/
+uint32 fga_cache_group_count(void)
+{
+    return l2_cache()->group_count;
+}
+
+int64 fga_cache_scan(uint32 start_group, int64 max_entries, FgaCacheEntryCallback callback, void* arg)
+{
+    FgaL2AclCache* l2 = l2_cache();
+    TimestampTz now_ms = get_now_ms();
+    int64 visited = 0;
+
+    for (uint32 n = 0; n < l2->group_count; n++)
+    {
+        uint32 g = (start_group + n) & l2->group_mask;
+        FgaL2Group* group = &l2->groups[g];
+
+        for (int i = 0; i < FGA_L2_GROUP_SIZE; i++)
+        {
+            FgaAclCacheKey k;
+            FgaL2AclValue v;
+            FgaGenerationSnapshot cur;
+            FgaCacheEntryInfo info;
+
+            if (max_entries >= 0 && visited >= max_entries)
+                return visited;
+
+            if (group->tags[i] == FGA_PROBE_TAG_EMPTY || !l2_read_entry(l2, group, i, &k, &v))
+                continue;
+
+            fga_generation_snapshot(v.gen_slot, v.subject_slot, &cur);
+
+            info.group = g;
+            info.slot = i;
+            info.key_low = k.low;
+            info.key_high = k.high;
+            info.allowed = v.allowed;
+            info.known = v.known;
+            info.expires_in_ms = v.expires_at_ms - now_ms;
+            info.usage = group->usage[i];
+            info.refresh_pending = v.refresh_pending;
+            if (v.expires_at_ms <= now_ms)
+                info.status = FGA_CACHE_ENTRY_EXPIRED;
+            else if (v.gen_stamp != l2_stamp(&cur))
+                info.status = FGA_CACHE_ENTRY_STALE;
+            else
+                info.status = FGA_CACHE_ENTRY_LIVE;
+
+            callback(&info, arg);
+            visited++;
+        }
+
+        CHECK_FOR_INTERRUPTS();
+    }
+
+    return visited;
+}
+
+/*-------------------------------------------------------------------------
+ * Dump / load (pg_prewarm 방식)
+ *
+ * 유효한(만료 전, generation 일치) L2 엔트리만 기록한다.
+ * 적재할 때는 현재 generation 으로 다시 찍으므로, 덤프 이후의 무효화를 따로 되살려야 한다.
+ *   - 덤프에 change feed 위치가 있으면 feed 를 그 위치로 되감아 덤프 이후의 변경을 다시 반영한다
+ *   - 없으면 BGW 종료 시 덤프만 적재한다 (주기적 덤프 뒤의 쓰기/삭제는 알 수 없음)
+ * 레코드는 object type 없이 relation 비트만 가지므로 relation 등록 표를 함께 저장하고,
+ * 적재할 때 같은 순서로 다시 등록해 비트 번호가 하나라도 다르면 덤프 전체를 버린다.
+ * 적재는 BGW 시작 시 processor 를 만들기 전 (쓰기와 change feed 반영 전) 에 shmem 수명 동안 한 번만 한다.
+ * 실행 중에 적재하면 그 사이 무효화된 결과가 살아나므로 SQL 로는 적재할 수 없다.
+ *-------------------------------------------------------------------------*/
+static void encode_record(char* buf, const FgaAclCacheKey* key, const FgaL2AclValue* value)
+{
+    memcpy(buf, &key->low, sizeof(uint64));
+    memcpy(buf + 8, &key->high, sizeof(uint64));
+    memcpy(buf + 16, &value->gen_slot, sizeof(uint16));
+    memcpy(buf + 18, &value->subject_slot, sizeof(uint16));
+    memcpy(buf + 20, &value->expires_at_ms, sizeof(TimestampTz));
+    memcpy(buf + 28, &value->allowed, sizeof(uint64));
+    memcpy(buf + 36, &value->known, sizeof(uint64));
+}
+
+/* L2 는 원래 key 를 보관하지 않으므로 key->object_key/subject_key 에는 generation 슬롯 번호가 들어간다 */
+static void
+decode_record(const char* buf, FgaAclCacheKey* key, TimestampTz* expires_at_ms, uint64* allowed, uint64* known)
+{
+    uint16 gen_slot;
+    uint16 subject_slot;
+
+    MemSet(key, 0, sizeof(*key));
+    memcpy(&key->low, buf, sizeof(uint64));
+    memcpy(&key->high, buf + 8, sizeof(uint64));
+    memcpy(&gen_slot, buf + 16, sizeof(uint16));
+    memcpy(&subject_slot, buf + 18, sizeof(uint16));
+    memcpy(expires_at_ms, buf + 20, sizeof(TimestampTz));
+    memcpy(allowed, buf + 28, sizeof(uint64));
+    memcpy(known, buf + 36, sizeof(uint64));
+
+    key->object_key = gen_slot;
+    key->subject_key = subject_slot;
+    key->relation_slot = RELATION_SLOT_NONE;
+}
+
+/* 덤프 시점까지 반영된 change feed 위치 (적재할 때 여기서부터 다시 읽는다) */
+static void dump_feed_position(FgaCacheDumpHeader* header)
+{
+    FgaConfig* config = fga_get_config();
+
+    if (config->changes_poll_interval_ms > 0 && config->store_id != NULL && config->store_id[0] != '\0' &&
+        fga_change_feed_load_token(config->store_id, header->token, sizeof(header->token)))
+        strlcpy(header->store_id, config->store_id, sizeof(header->store_id));
+}
+
+static bool dump_relations(FILE* file, FgaCacheDumpHeader* header)
+{
+    uint32 count = fga_relation_registered();
+
+    for (uint32 i = 0; i < count; i++)
+    {
+        const RelationBitMapEntry* entry = fga_relation_entry(i);
+        FgaCacheDumpRelation relation;
+
+        MemSet(&relation, 0, sizeof(relation));
+        strlcpy(relation.object_type, entry->object_type, sizeof(relation.object_type));
+        strlcpy(relation.relation_name, entry->relation_name, sizeof(relation.relation_name));
+        relation.bit_index = entry->bit_index;
+
+        if (fwrite(&relation, sizeof(relation), 1, file) != 1)
+            return false;
+    }
+
+    header->relation_count = count;
+    return true;
+}
+
+int64 fga_cache_dump_file(int elevel, bool shutdown)
+{
+    FgaL2AclCache* l2 = l2_cache();
+    FgaCacheDumpHeader header;
+    char tmp_path[MAXPGPATH];
+    char record[FGA_CACHE_DUMP_RECORD_SIZE];
+    TimestampTz now_ms = get_now_ms();
+    FILE* file;
+
+    MemSet(&header, 0, sizeof(header));
+    header.magic = FGA_CACHE_DUMP_MAGIC;
+    header.version = FGA_CACHE_DUMP_VERSION;
+    header.flags = shutdown ? FGA_CACHE_DUMP_SHUTDOWN : 0;
+    dump_feed_position(&header);
+
+    /* 백엔드와 BGW 가 동시에 덤프해도 서로의 임시 파일을 덮어쓰지 않도록 pid 를 붙인다 */
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", FGA_CACHE_DUMP_FILE, MyProcPid);
+
+    file = AllocateFile(tmp_path, PG_BINARY_W);
+    if (file == NULL)
+    {
+        ereport(elevel, (errcode_for_file_access(), errmsg("postfga: could not create \"%s\": %m", tmp_path)));
+        return -1;
+    }
+
+    /* count 는 마지막에 다시 쓴다 */
+    if (fwrite(&header, sizeof(header), 1, file) != 1)
+        goto write_error;
+
+    for (uint32 g = 0; g < l2->group_count; g++)
+    {
+        FgaL2Group* group = &l2->groups[g];
+
+        for (int i = 0; i < FGA_L2_GROUP_SIZE; i++)
+        {
+            FgaAclCacheKey k;
+            FgaL2AclValue v;
+
+            if (group->tags[i] == FGA_PROBE_TAG_EMPTY)
+                continue;
+
+            if (!l2_read_entry(l2, group, i, &k, &v) || l2_entry_stale(&v, now_ms))
+                continue;
+
+            encode_record(record, &k, &v);
+            if (fwrite(record, sizeof(record), 1, file) != 1)
+                goto write_error;
+
+            header.count++;
+        }
+
+        CHECK_FOR_INTERRUPTS();
+    }
+
+    /* 엔트리의 비트는 저장 전에 등록되므로 엔트리를 다 쓴 뒤의 표는 그 비트를 모두 포함한다 */
+    if (!dump_relations(file, &header))
+        goto write_error;
+
+    if (fseek(file, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, file) != 1)
+        goto write_error;
+
+    if (FreeFile(file) != 0)
+    {
+        file = NULL;
+        goto write_error;
+    }
+
+    if (durable_rename(tmp_path, FGA_CACHE_DUMP_FILE, elevel) != 0)
+    {
+        unlink(tmp_path);
+        return -1;
+    }
+
+    return (int64)header.count;
+
+write_error:
+    ereport(elevel, (errcode_for_file_access(), errmsg("postfga: could not write \"%s\": %m", tmp_path)));
+    if (file != NULL)
+        FreeFile(file);
+    unlink(tmp_path);
+    return -1;
+}
+
+/*
+ * 덤프 이후의 무효화를 놓치지 않을 때만 적재한다.
+ * change feed 위치가 있으면 feed 를 그 위치로 되감는다 (processor 가 만들어질 때 그 token 부터 읽음).
+ */
+static bool accept_dump(const FgaCacheDumpHeader* header)
+{
+    FgaConfig* config = fga_get_config();
+
+    if (header->token[0] != '\0' && config->changes_poll_interval_ms > 0 && config->store_id != NULL &&
+        strcmp(header->store_id, config->store_id) == 0)
+    {
+        fga_change_feed_save_token(header->store_id, header->token);
+        return true;
+    }
+
+    if (header->flags & FGA_CACHE_DUMP_SHUTDOWN)
+        return true;
+
+    ereport(LOG,
+            (errmsg("postfga: not loading cache dump \"%s\"", FGA_CACHE_DUMP_FILE),
+             errdetail("The dump was not written at shutdown and has no change feed position to replay from.")));
+    return false;
+}
+
+/*
+ * 덤프의 relation 을 등록 순서대로 다시 등록한다 (BGW 시작 직후라 보통 레지스트리는 비어 있음).
+ * 이미 다른 순서로 등록됐거나 fga.max_relations 가 줄어 비트 번호가 하나라도 다르면 false.
+ */
+static bool restore_relations(FILE* file, const FgaCacheDumpHeader* header)
+{
+    long offset = (long)(sizeof(*header) + header->count * FGA_CACHE_DUMP_RECORD_SIZE);
+    bool matched = true;
+
+    if (fseek(file, offset, SEEK_SET) != 0)
+        return false;
+
+    for (uint32 n = 0; n < header->relation_count; n++)
+    {
+        FgaCacheDumpRelation relation;
+        uint16 slot;
+        uint8 bit;
+
+        if (fread(&relation, sizeof(relation), 1, file) != 1)
+            return false;
+
+        relation.object_type[sizeof(relation.object_type) - 1] = '\0';
+        relation.relation_name[sizeof(relation.relation_name) - 1] = '\0';
+
+        bit = fga_relation_bit(relation.object_type,
+                               strlen(relation.object_type),
+                               relation.relation_name,
+                               strlen(relation.relation_name),
+                               &slot);
+        if (bit != relation.bit_index)
+        {
+            ereport(LOG,
+                    (errmsg("postfga: not loading cache dump \"%s\"", FGA_CACHE_DUMP_FILE),
+                     errdetail("Relation \"%s#%s\" was bit %u in the dump but is bit %d now.",
+                               relation.object_type,
+                               relation.relation_name,
+                               relation.bit_index,
+                               bit == RELATION_BIT_NOT_FOUND ? -1 : (int)bit)));
+            matched = false;
+            break;
+        }
+    }
+
+    if (fseek(file, (long)sizeof(*header), SEEK_SET) != 0)
+        return false;
+    return matched;
+}
+
+static int64 load_file(int elevel)
+{
+    FgaL2AclCache* l2 = l2_cache();
+    FgaCacheDumpHeader header;
+    char record[FGA_CACHE_DUMP_RECORD_SIZE];
+    TimestampTz now_ms = get_now_ms();
+    int64 loaded = 0;
+    FILE* file;
+
+    file = AllocateFile(FGA_CACHE_DUMP_FILE, PG_BINARY_R);
+    if (file == NULL)
+    {
+        if (errno == ENOENT)
+            return 0; /* 덤프한 적 없음 */
+
+        ereport(elevel,
+                (errcode_for_file_access(), errmsg("postfga: could not read \"%s\": %m", FGA_CACHE_DUMP_FILE)));
+        return -1;
+    }
+
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != FGA_CACHE_DUMP_MAGIC ||
+        header.version != FGA_CACHE_DUMP_VERSION)
+    {
+        FreeFile(file);
+        ereport(elevel,
+                (errcode(ERRCODE_DATA_CORRUPTED), errmsg("postfga: invalid cache dump file \"%s\"", FGA_CACHE_DUMP_FILE)));
+        return -1;
+    }
+
+    if (!restore_relations(file, &header) || !accept_dump(&header))
+    {
+        FreeFile(file);
+        return 0;
+    }
+
+    for (uint64 n = 0; n < header.count && fread(record, sizeof(record), 1, file) == 1; n++)
+    {
+        FgaAclCacheKey key;
+        FgaGenerationSnapshot snapshot;
+        TimestampTz expires_at_ms;
+        uint64 allowed;
+        uint64 known;
+
+        decode_record(record, &key, &expires_at_ms, &allowed, &known);
+
+        /* 남은 TTL 은 그대로 유지: 꺼져 있던 시간도 TTL 에 포함된다 */
+        if (expires_at_ms <= now_ms)
+            continue;
+
+        fga_generation_snapshot(key.object_key, key.subject_key, &snapshot);
+        /* 적재 시점에는 빈도 기록이 없으므로 admission 없이 채운다 */
+        l2_store(l2, &key, &snapshot, now_ms, expires_at_ms, allowed, known, false);
+        loaded++;
+
+        if ((n & 1023) == 0)
+            CHECK_FOR_INTERRUPTS();
+    }
+
+    FreeFile(file);
+    return loaded;
+}
+
+int64 fga_cache_prewarm(void)
+{
+    FgaL2AclCache* l2 = l2_cache();
+    uint32 expected = 0;
+    int64 loaded;
+
+    if (!pg_atomic_compare_exchange_u32(&l2->prewarmed, &expected, 1))
+        return 0;
+
+    /*
+     * 한 번 읽은 덤프는 지운다. 이번 실행이 종료 시 덤프를 남기지 못하고 끝나면
+     * (crash, 주기적 덤프 꺼짐) 다음 시작 때 이번 실행의 쓰기 이전 덤프를 다시 적재하게 된다.
+     */
+    loaded = load_file(LOG);
+    if (unlink(FGA_CACHE_DUMP_FILE) != 0 && errno != ENOENT)
+        ereport(LOG, (errcode_for_file_access(), errmsg("postfga: could not remove \"%s\": %m", FGA_CACHE_DUMP_FILE)));
+    return loaded;
 }
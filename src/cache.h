@@ -11,6 +11,9 @@ extern "C"
 #include <storage/lwlock.h>
 #include <utils/timestamp.h>
 
+#include "cache_ttl.h"
+#include "generation.h"
+#include "payload.h"
 #include "postfga.h"
 
 #ifdef __cplusplus
@@ -22,13 +25,29 @@ extern "C"
  * ------------------------------------------------------------------------- */
 typedef struct FgaAclCacheKey
 {
-    uint64_t low;         /* 8 bytes, offset 0 */
-    uint64_t high;        /* 8 bytes, offset 8 */
-    uint64_t object_key;  /* 8 bytes, offset 16 */
-    uint32_t relation_id; /* 4 bytes, offset 24 (uint16→uint32로 변경) */
-    uint32_t _pad;        /* 4 bytes, offset 28 */
+    uint64_t low;            /* 8 bytes, offset 0 */
+    uint64_t high;           /* 8 bytes, offset 8 */
+    uint64_t object_key;     /* 8 bytes, offset 16: store + object (모델 무관, generation 슬롯용) */
+    uint32_t subject_key;    /* 4 bytes, offset 24: store + subject 해시 하위 32비트 (generation 슬롯용) */
+    uint8_t relation_id;     /* 1 byte,  offset 28: 엔트리 안의 relation 비트 번호 */
+    uint8_t grouped;         /* 1 byte,  offset 29: relation 이 key 에서 빠졌음 (엔트리 하나에 relation 여럿) */
+    uint16_t relation_slot;  /* 2 bytes, offset 30: 레지스트리 위치 (relation 별 hit 통계), 없으면 RELATION_SLOT_NONE */
 } FgaAclCacheKey;
 
+/* key 의 relation 이 엔트리의 allowed/known mask 에서 차지하는 비트 */
+#define FGA_CACHE_RELATION_BIT(key) (UINT64CONST(1) << (key)->relation_id)
+
+/*
+ * 유효한 엔트리에 새로 알게 된 relation 결과를 합친다.
+ * 만료 시각은 호출자가 더 이른 쪽으로 맞춘다 (먼저 알던 결과가 TTL 보다 오래 살지 않게).
+ * 새 known 이 기존 known 을 모두 덮으면 (BatchCheck 로 다시 채운 경우) 호출자는 합치지 않고 바꾼다.
+ */
+static inline void fga_cache_merge_relations(uint64_t* allowed, uint64_t* known, uint64_t new_allowed, uint64_t new_known)
+{
+    *allowed = (*allowed & ~new_known) | (new_allowed & new_known);
+    *known |= new_known;
+}
+
 typedef struct FgaRelationCacheEntry
 {
     char name[RELATION_MAX_LEN];
@@ -38,6 +57,30 @@ typedef struct FgaRelationCacheEntry
 struct FgaL2AclCache;
 typedef struct FgaL2AclCache FgaL2AclCache;
 
+/* fga_cache_scan() 이 넘기는 L2 엔트리 하나 (fga_cache_entries / fga_cache_summary) */
+typedef enum FgaCacheEntryStatus
+{
+    FGA_CACHE_ENTRY_LIVE = 0,
+    FGA_CACHE_ENTRY_EXPIRED, /* TTL 지남 */
+    FGA_CACHE_ENTRY_STALE    /* TTL 전이지만 generation 이 올라감 (무효화됨) */
+} FgaCacheEntryStatus;
+
+typedef struct FgaCacheEntryInfo
+{
+    uint32_t group;
+    int slot;
+    uint64_t key_low;
+    uint64_t key_high;
+    uint64_t allowed;
+    uint64_t known;
+    int64_t expires_in_ms; /* 음수면 이미 만료 */
+    uint8_t usage;
+    bool refresh_pending;
+    FgaCacheEntryStatus status;
+} FgaCacheEntryInfo;
+
+typedef void (*FgaCacheEntryCallback)(const FgaCacheEntryInfo* entry, void* arg);
+
 /* -------------------------------------------------------------------------
  * Cache API
  * ------------------------------------------------------------------------- */
@@ -47,12 +90,8 @@ extern "C"
 #endif
 
     Size fga_cache_shmem_base_size(void);
-    Size fga_cache_shmem_hash_size(void);
-    void fga_cache_shmem_init(FgaL2AclCache* cache, LWLock* lock);
-    void fga_cache_shmem_each_startup(void);
+    void fga_cache_shmem_init(FgaL2AclCache* cache);
 
-    /* generation bump (invalidation) */
-    // void fga_l2_bump_generation(FgaL2AclCache* cache);
 
     void fga_cache_key(FgaAclCacheKey* key,
                        const char* store_id,
@@ -61,11 +100,80 @@ extern "C"
                        const text* object_id,
                        const text* subject_type,
                        const text* subject_id,
-                       const text* relation);
-
-    bool fga_cache_lookup(const FgaAclCacheKey* key, bool* allowed_out);
-
-    void fga_cache_store(const FgaAclCacheKey* key, bool allowed);
+                       const text* relation,
+                       uint64 context_hash);
+
+    uint64 fga_cache_object_key(
+        const char* store_id, const char* object_type, size_t type_len, const char* object_id, size_t id_len);
+    uint64 fga_cache_subject_key(
+        const char* store_id, const char* subject_type, size_t type_len, const char* subject_id, size_t id_len);
+
+    /*
+     * 조회 시점의 generation 을 snapshot_out 에 남긴다 (miss 포함).
+     * miss 후 RPC 결과를 저장할 때는 이 snapshot 을 그대로 넘겨야
+     * RPC 도중 발생한 무효화가 새 엔트리에 반영된다.
+     * hit 가 fga.cache_refresh_window_ms 안이면 *refresh_out = true: 호출자가 백그라운드 갱신을 요청한다.
+     */
+    bool fga_cache_lookup(const FgaAclCacheKey* key,
+                          bool* allowed_out,
+                          FgaGenerationSnapshot* snapshot_out,
+                          bool* refresh_out);
+
+    /*
+     * ttls 는 relation_id 로 인덱싱하는 TTL 표 (fga_cache_ttls).
+     * 엔트리는 key 의 relation TTL 로 만료되며, 그보다 TTL 이 짧은 다른 relation 결과는 저장하지 않는다.
+     */
+    void fga_cache_store(const FgaAclCacheKey* key,
+                         bool allowed,
+                         const FgaCacheTtl* ttls,
+                         const FgaGenerationSnapshot* snapshot);
+
+    /* 엔트리의 여러 relation 비트를 한 번에 저장 (known 비트만 결과로 쓴다) */
+    void fga_cache_store_relations(const FgaAclCacheKey* key,
+                                   uint64 allowed,
+                                   uint64 known,
+                                   const FgaCacheTtl* ttls,
+                                   const FgaGenerationSnapshot* snapshot);
+
+    /* 백그라운드 갱신: 백엔드가 hint 를 채워 보내고, BGW 가 결과를 L2 에만 저장한다 */
+    void fga_cache_store_hint(FgaCacheStoreHint* hint, const FgaAclCacheKey* key, const FgaGenerationSnapshot* snapshot);
+    void fga_cache_store_shared(const FgaCacheStoreHint* hint, const FgaCacheTtl* ttls, uint64 allowed, uint64 known);
+
+    /* 백그라운드 갱신이 실패했거나 보내지 못함: 갱신 요청 표시를 지워 다음 hit 가 다시 요청하게 한다 */
+    void fga_cache_release_refresh(const FgaCacheStoreHint* hint);
+
+    /*
+     * write/delete 성공 후 호출. 기록된 object 의 generation 을 올리고,
+     * 변경이 다른 object 로 전이될 수 있으면 store 전체(global)를 올린다.
+     */
+    void fga_cache_invalidate_tuple(const FgaAclCacheKey* key, const text* object_type, const text* subject_id);
+
+    /*
+     * L2 덤프/적재 ($PGDATA/postfga_cache.dump). 실패 시 elevel 로 보고하고 -1.
+     * shutdown 은 BGW 종료 시 덤프 (이후 쓰기가 없음) 를 표시한다.
+     * fga_cache_prewarm() 은 BGW 시작 시 processor 를 만들기 전에 shmem 수명 동안 한 번만 적재한다.
+     */
+    int64 fga_cache_dump_file(int elevel, bool shutdown);
+    int64 fga_cache_prewarm(void);
+
+    /*
+     * L2 엔트리를 start_group 부터 (끝에서 0 으로 돌아) 훑으며 callback 을 부른다.
+     * 빈 엔트리와 쓰는 중인 그룹의 엔트리는 건너뛴다. max_entries 개를 넘기면 멈춘다 (음수면 전체).
+     * 반환값은 callback 을 부른 횟수.
+     */
+    uint32 fga_cache_group_count(void);
+    int64 fga_cache_scan(uint32 start_group, int64 max_entries, FgaCacheEntryCallback callback, void* arg);
+
+    /*
+     * 외부에서 관측한 변경(ReadChanges)을 반영. subject 는 "type:id" 또는 "type:id#relation".
+     */
+    void fga_cache_invalidate_object(const char* store_id,
+                                     const char* object_type,
+                                     size_t type_len,
+                                     const char* object_id,
+                                     size_t id_len,
+                                     const char* subject,
+                                     size_t subject_len);
 
 
 #ifdef __cplusplus
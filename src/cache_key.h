@@ -7,42 +7,72 @@
 #include <xxhash.h>
 
 #include "cache.h"
+#include "relation.h"
 
 /*-------------------------------------------------------------------------
  * CacheKey helpers
+ *
+ * 필드는 [길이 1바이트][바이트] 로 이어 붙여 해시한다. 고정 버퍼에 모으지 않고 XXH3 streaming 으로
+ * 넣으므로 인자 길이와 상관없이 안전하다 (한 번에 해시한 것과 같은 값).
+ * 길이가 255 를 넘는 필드는 없다: SQL 인자는 *_MAX_LEN 으로 먼저 거른다.
  *-------------------------------------------------------------------------*/
-static inline char* append_cache_key_field_text(char* buffer, const text* str)
+typedef struct CacheKeyHasher
 {
-    size_t str_len = str != NULL ? VARSIZE_ANY_EXHDR(str) : 0;
-    Assert(str_len <= 125);
+    XXH3_state_t state;
+    bool wide; /* XXH3_128bits (전체 key) 인지 XXH3_64bits (generation 슬롯) 인지 */
+} CacheKeyHasher;
 
-    *buffer++ = (uint8_t)str_len;
+static inline void update_cache_key_raw(CacheKeyHasher* state, const void* data, size_t len)
+{
+    if (state->wide)
+        XXH3_128bits_update(&state->state, data, len);
+    else
+        XXH3_64bits_update(&state->state, data, len);
+}
+
+static inline void update_cache_key_bytes(CacheKeyHasher* state, const char* str, size_t str_len)
+{
+    uint8 len_byte = (uint8)str_len;
 
+    update_cache_key_raw(state, &len_byte, 1);
     if (str_len > 0)
-    {
-        memcpy(buffer, VARDATA_ANY(str), str_len);
-        buffer += str_len;
-    }
+        update_cache_key_raw(state, str, str_len);
+}
 
-    return buffer;
+static inline void update_cache_key_field(CacheKeyHasher* state, const char* str)
+{
+    update_cache_key_bytes(state, str, str != NULL ? strlen(str) : 0);
 }
 
-static inline char* append_cache_key_field(char* buffer, const char* str)
+static inline void update_cache_key_field_text(CacheKeyHasher* state, const text* str)
 {
-    size_t str_len = str != NULL ? strlen(str) : 0;
-    Assert(str_len <= 128);
+    if (str == NULL)
+        update_cache_key_bytes(state, NULL, 0);
+    else
+        update_cache_key_bytes(state, VARDATA_ANY(str), VARSIZE_ANY_EXHDR(str));
+}
 
-    *buffer++ = (uint8_t)str_len;
+/* (store, type, id) 를 이어 붙인 해시: object_key 와 subject_key 가 같은 모양이다 */
+static uint64 cache_pair_key(const char* store_id, const char* type, size_t type_len, const char* id, size_t id_len)
+{
+    CacheKeyHasher state;
 
-    if (str_len > 0)
-    {
-        memcpy(buffer, str, str_len);
-        buffer += str_len;
-    }
+    state.wide = false;
+    XXH3_64bits_reset(&state.state);
+    update_cache_key_field(&state, store_id);
+    update_cache_key_bytes(&state, type, type_len);
+    update_cache_key_bytes(&state, id, id_len);
 
-    return buffer;
+    return XXH3_64bits_digest(&state.state);
 }
 
+/*
+ * relation 이 레지스트리에 있으면 (store, model, object, subject) 만으로 key 를 만들고
+ * relation 은 비트 번호로 구분한다. 없으면 (레지스트리가 가득 참) relation 까지 해시해서
+ * 엔트리 하나에 relation 하나 (비트 0) 를 둔다.
+ * context_hash 는 check context / contextual tuples 의 해시 (없으면 0): 같은 context 의 결과끼리만 공유한다.
+ * object_key/subject_key 에는 넣지 않으므로 무효화는 context 와 상관없이 그대로 적용된다.
+ */
 void fga_cache_key(FgaAclCacheKey* key,
                    const char* store_id,
                    const char* model_id,
@@ -50,27 +80,76 @@ void fga_cache_key(FgaAclCacheKey* key,
                    const text* object_id,
                    const text* subject_type,
                    const text* subject_id,
-                   const text* relation)
+                   const text* relation,
+                   uint64 context_hash)
 {
+    CacheKeyHasher state;
     XXH128_hash_t h;
-    char buf[1024]; // 각 필드 길이 128 바이트 이하 가정으로 충분
-    char* p = buf;
-
-    p = append_cache_key_field(p, store_id);
-    p = append_cache_key_field(p, model_id);
-    p = append_cache_key_field_text(p, object_type);
-    p = append_cache_key_field_text(p, object_id);
-
-    // object_key 생성
-    key->object_key = XXH3_64bits(buf, p - buf);
+    uint16 slot;
+    uint8 bit = fga_relation_bit(VARDATA_ANY(object_type),
+                                 VARSIZE_ANY_EXHDR(object_type),
+                                 VARDATA_ANY(relation),
+                                 VARSIZE_ANY_EXHDR(relation),
+                                 &slot);
+
+    key->subject_key = (uint32)fga_cache_subject_key(store_id,
+                                                     VARDATA_ANY(subject_type),
+                                                     VARSIZE_ANY_EXHDR(subject_type),
+                                                     VARDATA_ANY(subject_id),
+                                                     VARSIZE_ANY_EXHDR(subject_id));
+    key->relation_slot = slot;
+
+    // object_key 생성: 모델이 바뀌어도 같은 object 는 같은 generation 슬롯을 쓴다
+    key->object_key = fga_cache_object_key(store_id,
+                                           VARDATA_ANY(object_type),
+                                           VARSIZE_ANY_EXHDR(object_type),
+                                           VARDATA_ANY(object_id),
+                                           VARSIZE_ANY_EXHDR(object_id));
+
+    state.wide = true;
+    XXH3_128bits_reset(&state.state);
+    update_cache_key_field(&state, store_id);
+    update_cache_key_field_text(&state, object_type);
+    update_cache_key_field_text(&state, object_id);
+    update_cache_key_field(&state, model_id);
+    update_cache_key_field_text(&state, subject_type);
+    update_cache_key_field_text(&state, subject_id);
+
+    if (bit != RELATION_BIT_NOT_FOUND)
+    {
+        key->relation_id = bit;
+        key->grouped = 1;
+    }
+    else
+    {
+        update_cache_key_field_text(&state, relation);
+        key->relation_id = 0;
+        key->grouped = 0;
+    }
 
-    p = append_cache_key_field_text(p, subject_type);
-    p = append_cache_key_field_text(p, subject_id);
-    p = append_cache_key_field_text(p, relation);
+    if (context_hash != 0)
+        update_cache_key_raw(&state, &context_hash, sizeof(context_hash));
 
-    h = XXH3_128bits(buf, p - buf);
+    h = XXH3_128bits_digest(&state.state);
     key->low = h.low64;
     key->high = h.high64;
 }
 
+/* fga_cache_key() 의 subject_key: store + subject (모델 무관) */
+uint64 fga_cache_subject_key(
+    const char* store_id, const char* subject_type, size_t type_len, const char* subject_id, size_t id_len)
+{
+    return cache_pair_key(store_id, subject_type, type_len, subject_id, id_len);
+}
+
+/*
+ * fga_cache_key() 의 object_key 와 같은 값 (ReadChanges 등 text 가 아닌 입력용).
+ * "type:id" 를 이미 나눈 상태로 받는다.
+ */
+uint64 fga_cache_object_key(
+    const char* store_id, const char* object_type, size_t type_len, const char* object_id, size_t id_len)
+{
+    return cache_pair_key(store_id, object_type, type_len, object_id, id_len);
+}
+
 #endif /* FGA_CACHE_KEY_H */
@@ -3,28 +3,31 @@
 
 /*
  * L1 Cache (per-backend)
- * - 2-way set-associative
- * - pseudo-LRU via flip-bit (victim index 0/1)
+ * - set-associative, Swiss-table 방식 tag 그룹 (cache_probe.h)
+ * - 한 set 의 tag 16개를 SIMD 한 번으로 비교하므로 way 수와 상관없이 같은 비용으로 탐색
+ * - bit-PLRU: 접근한 way 의 MRU 비트를 켜고, 모두 켜지면 현재 way 만 남기고 리셋
  *
- * 총 엔트리 수: L1_NUM_SETS * L1_NUM_WAYS
- *   현재: 4096 * 2 = 8192 entries
+ * 크기: fga.l1_cache_entries / fga.l1_cache_ways (way 는 최대 16, set 수는 2의 거듭제곱으로 내림)
+ *   기본: 2048 sets * 16 ways = 32768 entries
+ * 처음 조회/저장할 때 할당한다. check 를 하지 않는 백엔드와 BGW 는 메모리를 쓰지 않는다.
  */
 
 #include <postgres.h>
 
+#include <port/pg_bitutils.h>
 #include <utils/memutils.h>
 #include <utils/timestamp.h> /* TimestampTz, if needed for time source */
 
 #include "cache.h"
+#include "cache_probe.h"
+#include "config.h"
+#include "stats.h"
 
 /*-------------------------------------------------------------------------
  * 파라미터
  *-------------------------------------------------------------------------*/
 
-#define FGA_L1_NUM_SETS_BITS 14
-#define FGA_L1_NUM_SETS (1 << FGA_L1_NUM_SETS_BITS) /* 16384 sets */
-#define FGA_L1_NUM_WAYS 2                           /* 2-way */
-_Static_assert((FGA_L1_NUM_SETS & (FGA_L1_NUM_SETS - 1)) == 0, "L1_NUM_SETS must be power of two");
+#define FGA_L1_MAX_WAYS FGA_PROBE_GROUP_SIZE /* tag 그룹 하나 = set 하나 */
 
 /*-------------------------------------------------------------------------
  * 구조체 정의
@@ -32,112 +35,148 @@ _Static_assert((FGA_L1_NUM_SETS & (FGA_L1_NUM_SETS - 1)) == 0, "L1_NUM_SETS must
 
 typedef struct FgaL1Entry
 {
-    bool valid;
-    bool allowed;
-    uint16_t global_gen;
+    uint64_t allowed;          /* relation 비트별 결과 */
+    uint64_t known;            /* 결과를 아는 relation 비트 */
     uint64_t expires_at_ms;
     FgaAclCacheKey key;
+    FgaGenerationSnapshot gen; /* 저장 시점 generation (12바이트라 끝에 둔다) */
 } FgaL1Entry;
 
-typedef struct FgaL1Set
-{
-    FgaL1Entry ways[FGA_L1_NUM_WAYS];
-    uint8_t victim; /* 0 또는 1: 다음에 evict할 후보 way */
-} FgaL1Set;
-
+/*
+ * set s 의 tag 는 tags[s * 16 ..], 엔트리는 entries[s * ways ..].
+ * way 수가 16 보다 작으면 남는 tag 는 항상 비어 있다 (빈 way 탐색과 victim 선택에서 제외).
+ */
 typedef struct FgaL1Cache
 {
     MemoryContext ctx; /* 이 캐시 전용 메모리 컨텍스트 */
-    FgaL1Set sets[FGA_L1_NUM_SETS];
+    uint32_t set_mask;
+    uint32_t ways;
+    FgaProbeMask way_mask; /* 사용하는 way 비트 */
+    uint8_t* tags;         /* [sets * FGA_PROBE_GROUP_SIZE], 0 = 빈 way */
+    uint16_t* mru;         /* [sets], bit-PLRU: 최근 접근한 way 비트 */
+    FgaL1Entry* entries;   /* [sets * ways] */
 } FgaL1Cache;
 
 /* per-backend static */
 static FgaL1Cache* l1_cache = NULL;
+static bool l1_disabled = false; /* fga.l1_cache_entries = 0 */
 
 /*
- * key → set index
+ * key → set index (tag 는 key.high 에서 뽑으므로 서로 독립)
  */
 static inline uint32_t l1_hash_to_set(const FgaAclCacheKey* key)
 {
-    return (uint32_t)(key->low & (FGA_L1_NUM_SETS - 1));
+    return (uint32_t)(key->low & l1_cache->set_mask);
+}
+
+static inline uint8_t* l1_set_tags(uint32_t set)
+{
+    return &l1_cache->tags[(Size)set * FGA_PROBE_GROUP_SIZE];
+}
+
+static inline FgaL1Entry* l1_set_entries(uint32_t set)
+{
+    return &l1_cache->entries[(Size)set * l1_cache->ways];
 }
 
-/*
- * 키 비교
- *  - 필요하면 FgaAclCacheKey 내부에 hash 필드를 넣고
- *    그걸 먼저 비교한 뒤 나머지 필드를 비교하는 식으로 최적화 가능
- */
 static inline bool l1_key_equals(const FgaAclCacheKey* a, const FgaAclCacheKey* b)
 {
     return a->low == b->low && a->high == b->high;
 }
 
 /*-------------------------------------------------------------------------
- * Pseudo-LRU: flip-bit 방식 (2-way 전용)
+ * bit-PLRU
  *
- * - victim: 다음에 evict할 way 인덱스 (0 또는 1)
- * - 접근된 way는 hot → 반대편을 victim으로 설정
+ * - mru: 최근 접근된 way 비트
+ * - victim: MRU 비트가 꺼진 첫 번째 way
  *-------------------------------------------------------------------------*/
 
-static inline void l1_plru_access(FgaL1Set* set, int way)
+static inline void l1_plru_access(uint32_t set, int way)
 {
-    Assert(way == 0 || way == 1);
-    set->victim = (uint8_t)(way ^ 1);
+    uint16_t* mru = &l1_cache->mru[set];
+
+    *mru |= (uint16_t)(1u << way);
+    if (*mru == l1_cache->way_mask)
+        *mru = (uint16_t)(1u << way);
 }
 
-static inline int l1_plru_victim(FgaL1Set* set)
+static inline int l1_plru_victim(uint32_t set)
 {
-    return (int)set->victim;
+    return fga_probe_first((FgaProbeMask)(~l1_cache->mru[set] & l1_cache->way_mask));
 }
 
 /*-------------------------------------------------------------------------
- * L1 initialize
+ * L1 initialize (lazy)
+ *
+ * 크기는 처음 할당할 때의 GUC 값으로 정해지며, 세션 중에는 바뀌지 않는다.
  *-------------------------------------------------------------------------*/
-static void l1_startup(void)
+static bool l1_ensure(void)
 {
+    FgaConfig* config;
     MemoryContext ctx;
-    MemoryContext old;
+    uint32_t ways;
+    uint32_t sets;
+    Size bytes;
 
     if (l1_cache != NULL)
-        return;
+        return true;
+    if (l1_disabled)
+        return false;
+
+    config = fga_get_config();
+    if (config->l1_cache_entries <= 0)
+    {
+        l1_disabled = true;
+        return false;
+    }
+
+    ways = (uint32_t)Min(config->l1_cache_ways, config->l1_cache_entries);
+    sets = pg_prevpower2_32((uint32_t)config->l1_cache_entries / ways);
 
     ctx = AllocSetContextCreate(TopMemoryContext, "PostFGA L1 Cache", ALLOCSET_DEFAULT_SIZES);
-    old = MemoryContextSwitchTo(ctx);
 
-    l1_cache = (FgaL1Cache*)palloc0(sizeof(FgaL1Cache));
+    l1_cache = (FgaL1Cache*)MemoryContextAllocZero(ctx, sizeof(FgaL1Cache));
     l1_cache->ctx = ctx;
+    l1_cache->set_mask = sets - 1;
+    l1_cache->ways = ways;
+    l1_cache->way_mask = (FgaProbeMask)((1u << ways) - 1);
+
+    /* 0 으로 채우므로 tag 는 모두 FGA_PROBE_TAG_EMPTY, mru 는 0 */
+    l1_cache->tags = (uint8_t*)MemoryContextAllocZero(ctx, (Size)sets * FGA_PROBE_GROUP_SIZE);
+    l1_cache->mru = (uint16_t*)MemoryContextAllocZero(ctx, (Size)sets * sizeof(uint16_t));
+    l1_cache->entries = (FgaL1Entry*)MemoryContextAlloc(ctx, (Size)sets * ways * sizeof(FgaL1Entry));
 
-    /*
-     * palloc0 덕분에:
-     * - sets[].ways[].valid      = false
-     * - sets[].victim            = 0
-     * 모두 초기화되어 있음.
-     */
+    bytes = sizeof(FgaL1Cache) + (Size)sets * (FGA_PROBE_GROUP_SIZE + sizeof(uint16_t) + ways * sizeof(FgaL1Entry));
+    fga_stats_l1_allocated((uint64)sets * ways, ways, bytes);
 
-    MemoryContextSwitchTo(old);
+    elog(DEBUG1, "PostFGA: L1 cache allocated (%u sets * %u ways, %zu bytes)", sets, ways, bytes);
+    return true;
 }
 
 /*-------------------------------------------------------------------------
  * Lookup
  *
  * - key, cur_generation, now_ms가 주어졌을 때 hit 여부와 allowed 반환
+ * - 엔트리가 있어도 key 의 relation 비트를 모르면 miss (엔트리는 그대로 둔다)
  *-------------------------------------------------------------------------*/
 
-static bool l1_lookup(const FgaAclCacheKey* const key, uint16_t cur_generation, TimestampTz now_ms, bool* allowed_out)
+static bool
+l1_lookup(const FgaAclCacheKey* const key, const FgaGenerationSnapshot* cur, TimestampTz now_ms, bool* allowed_out)
 {
-    FgaL1Set* set;
+    uint32_t set;
+    uint8_t* tags;
+    FgaProbeMask match;
 
-    if (l1_cache == NULL)
+    if (!l1_ensure())
         return false;
 
-    set = &l1_cache->sets[l1_hash_to_set(key)];
+    set = l1_hash_to_set(key);
+    tags = l1_set_tags(set);
 
-    for (int i = 0; i < FGA_L1_NUM_WAYS; i++)
+    for (match = fga_probe_match(tags, fga_probe_tag(key->high)); match != 0; match = fga_probe_next(match))
     {
-        FgaL1Entry* e = &set->ways[i];
-
-        if (!e->valid)
-            continue;
+        int i = fga_probe_first(match);
+        FgaL1Entry* e = &l1_set_entries(set)[i];
 
         if (!l1_key_equals(&e->key, key))
             continue;
@@ -145,20 +184,23 @@ static bool l1_lookup(const FgaAclCacheKey* const key, uint16_t cur_generation,
         /* TTL 만료 */
         if (e->expires_at_ms <= now_ms)
         {
-            e->valid = false;
+            tags[i] = FGA_PROBE_TAG_EMPTY;
             return false;
         }
 
-        /* generation mismatch → lazy invalidation */
-        if (e->global_gen != cur_generation)
+        /* generation mismatch (store 전체 또는 object 단위) → lazy invalidation */
+        if (!fga_generation_equals(&e->gen, cur))
         {
-            e->valid = false;
+            tags[i] = FGA_PROBE_TAG_EMPTY;
             return false;
         }
 
+        if ((e->known & FGA_CACHE_RELATION_BIT(key)) == 0)
+            return false;
+
         /* hit */
         l1_plru_access(set, i);
-        *allowed_out = e->allowed;
+        *allowed_out = (e->allowed & FGA_CACHE_RELATION_BIT(key)) != 0;
 
         return true;
     }
@@ -169,54 +211,75 @@ static bool l1_lookup(const FgaAclCacheKey* const key, uint16_t cur_generation,
  * Store
  *
  * - key / generation / expires_at / allowed 값을 L1에 넣거나 갱신
+ * - known 비트의 결과만 바꾸고, 같은 generation 의 유효한 엔트리에는 합친다 (fga_cache_merge_relations)
  *-------------------------------------------------------------------------*/
 
-static void l1_store(const FgaAclCacheKey* key, uint16_t generation, TimestampTz expires_at_ms, bool allowed)
+static void l1_store(const FgaAclCacheKey* key,
+                     const FgaGenerationSnapshot* generation,
+                     TimestampTz now_ms,
+                     TimestampTz expires_at_ms,
+                     uint64_t allowed,
+                     uint64_t known)
 {
-    uint32_t set_idx;
-    FgaL1Set* set;
+    uint32_t set;
+    uint8_t* tags;
     FgaL1Entry* e;
-    int empty_slot = -1;
+    FgaProbeMask match;
+    FgaProbeMask empty;
+    uint8_t tag;
+    int target;
 
-    if (l1_cache == NULL)
+    if (!l1_ensure())
         return;
 
-    set_idx = l1_hash_to_set(key);
-    set = &l1_cache->sets[set_idx];
+    set = l1_hash_to_set(key);
+    tags = l1_set_tags(set);
+    tag = fga_probe_tag(key->high);
 
-
-    for (int i = 0; i < FGA_L1_NUM_WAYS; i++)
+    for (match = fga_probe_match(tags, tag); match != 0; match = fga_probe_next(match))
     {
-        e = &set->ways[i];
-
-        if (!e->valid)
-        {
-            if (empty_slot < 0)
-                empty_slot = i;
-            continue;
-        }
+        int i = fga_probe_first(match);
 
+        e = &l1_set_entries(set)[i];
         if (l1_key_equals(&e->key, key))
         {
             /* 1) 이미 존재하는 key → update */
-            e->allowed = allowed;
-            e->expires_at_ms = expires_at_ms;
-            e->global_gen = generation;
+            if (fga_generation_equals(&e->gen, generation) && (TimestampTz)e->expires_at_ms > now_ms &&
+                (known & e->known) != e->known)
+            {
+                fga_cache_merge_relations(&e->allowed, &e->known, allowed, known);
+                e->expires_at_ms = Min((TimestampTz)e->expires_at_ms, expires_at_ms);
+            }
+            else
+            {
+                e->allowed = allowed;
+                e->known = known;
+                e->expires_at_ms = expires_at_ms;
+                e->gen = *generation;
+            }
 
             l1_plru_access(set, i);
             return;
         }
     }
 
-    /* 빈 슬롯 사용 또는 victim 교체 */
-    int target = (empty_slot >= 0) ? empty_slot : l1_plru_victim(set);
-    e = &set->ways[target];
+    /* 빈 way 사용 또는 victim 교체 */
+    empty = fga_probe_match_empty(tags) & l1_cache->way_mask;
+    if (empty != 0)
+        target = fga_probe_first(empty);
+    else
+    {
+        target = l1_plru_victim(set);
+        fga_stats_l1_eviction();
+    }
+    e = &l1_set_entries(set)[target];
 
-    e->valid = true;
+    tags[target] = tag;
     e->key = *key;
     e->allowed = allowed;
+    e->known = known;
     e->expires_at_ms = expires_at_ms;
-    e->global_gen = generation;
+    e->gen = *generation;
     l1_plru_access(set, target);
 }
 
@@ -229,15 +292,8 @@ static void l1_invalidate_all(void)
     if (l1_cache == NULL)
         return;
 
-    for (int s = 0; s < FGA_L1_NUM_SETS; s++)
-    {
-        FgaL1Set* set = &l1_cache->sets[s];
-
-        for (int w = 0; w < FGA_L1_NUM_WAYS; w++)
-            set->ways[w].valid = false;
-
-        set->victim = 0;
-    }
+    MemSet(l1_cache->tags, FGA_PROBE_TAG_EMPTY, (Size)(l1_cache->set_mask + 1) * FGA_PROBE_GROUP_SIZE);
+    MemSet(l1_cache->mru, 0, (Size)(l1_cache->set_mask + 1) * sizeof(uint16_t));
 
     elog(DEBUG1, "L1 cache invalidated (all)");
 }
@@ -248,25 +304,24 @@ static void l1_invalidate_all(void)
  *    한 번에 쓸어버리고 싶을 때 사용
  *-------------------------------------------------------------------------*/
 
-static void l1_invalidate_by_generation(uint16_t old_generation)
+static void l1_invalidate_by_generation(uint32_t old_generation)
 {
     if (l1_cache == NULL)
         return;
 
-    for (int s = 0; s < FGA_L1_NUM_SETS; s++)
+    for (uint32_t s = 0; s <= l1_cache->set_mask; s++)
     {
-        FgaL1Set* set = &l1_cache->sets[s];
+        uint8_t* tags = l1_set_tags(s);
+        FgaL1Entry* entries = l1_set_entries(s);
 
-        for (int w = 0; w < FGA_L1_NUM_WAYS; w++)
+        for (uint32_t w = 0; w < l1_cache->ways; w++)
         {
-            FgaL1Entry* e = &set->ways[w];
-
-            if (e->valid && e->global_gen == old_generation)
-                e->valid = false;
+            if (tags[w] != FGA_PROBE_TAG_EMPTY && entries[w].gen.global == old_generation)
+                tags[w] = FGA_PROBE_TAG_EMPTY;
         }
     }
 
     elog(DEBUG1, "L1 cache invalidated by generation=%u", old_generation);
 }
 
-#endif /* FGA_CACHE_L1_H */
\ No newline at end of file
+#endif /* FGA_CACHE_L1_H */
@@ -3,242 +3,536 @@
 
 #include <postgres.h>
 
+#include <port/atomics.h>
+#include <port/pg_bitutils.h>
+
 #include "cache.h"
+#include "cache_probe.h"
+#include "cache_sketch.h"
 #include "config.h"
 #include "state.h"
 
+/*
+ * L2 Cache (shared)
+ * - 고정 크기 open-addressing 테이블, 락 없음
+ * - 엔트리 16개 = 그룹 하나. 그룹마다 1바이트 tag 16개 (cache_probe.h, Swiss-table 방식)
+ * - key.low 상위 비트로 시작 그룹을 정하고 FGA_L2_PROBE_GROUPS 개 그룹까지 탐색
+ *   tag 를 SIMD 로 비교해 후보만 전체 key 비교. 빈 tag 가 있는 그룹을 지나면 탐색 종료
+ * - 그룹마다 seqlock version: 짝수 = 안정, 홀수 = 쓰는 중
+ *   reader 는 version 을 전후로 읽어 같을 때만 복사본을 사용 (대기 없음)
+ *   writer 는 CAS 로 version 을 홀수로 만든 쪽만 쓰고, 실패하면 저장을 포기
+ * - 삭제는 없고 덮어쓰기만 하므로 한 번 채워진 tag 는 다시 0 이 되지 않는다
+ * - 같은 key 를 동시에 저장하면 드물게 중복이 생길 수 있으나,
+ *   reader/writer 모두 탐색 순서상 첫 번째 것만 보므로 나머지는 곧 밀려난다
+ * - admission (TinyLFU): 빈/만료 엔트리에는 항상 저장하고, 살아 있는 엔트리를 밀어낼 때는
+ *   새 key 의 추정 빈도가 victim 보다 높을 때만 교체 (한 번 훑고 지나가는 scan 이 hot set 을 밀어내지 않게)
+ *
+ * - 갱신 요청 표시 (stale-while-revalidate) 는 엔트리별 atomic 에 표시한 tick 을 CAS 로 남긴다.
+ *   seqlock 을 건드리지 않으므로 같은 그룹의 reader 가 헛 miss 를 보지 않는다.
+ *   결과 저장 시 지우고, 갱신이 실패하면 l2_release_refresh 로 지운다.
+ *   BGW 가 결과를 돌려주지 못한 표시는 갱신 구간의 절반이 지나면 다른 백엔드가 다시 가져간다
+ *
+ * 엔트리 배치 (엔트리 하나당 약 50바이트, relation 최대 64개)
+ * - 엔트리 본체 40바이트: 128비트 key fingerprint (key.low/high), relation 비트별 allowed/known,
+ *   만료 tick, generation stamp. 같은 (object, subject) 의 relation 들은 엔트리 하나를 같이 쓴다
+ * - 그룹 배열에 엔트리당 tag/usage 1바이트씩, object/subject generation 슬롯 번호 2바이트씩, 갱신 표시 4바이트
+ * - 만료는 cache->epoch_ms 기준 FGA_L2_TICK_MS 단위 32비트 (약 4.3년, 넘으면 모두 만료로 본다)
+ * - generation stamp = global + object + subject. 세 카운터 모두 증가만 하므로 합이 같으면 모두 그대로다
+ */
 #define FGA_L2_USAGE_MAX 5
-#define FGA_L2_HASH_NAME "postfga L2 index"
+#define FGA_L2_GROUP_SIZE FGA_PROBE_GROUP_SIZE
+#define FGA_L2_PROBE_GROUPS 2
+#define FGA_L2_TICK_MS 32
+
+StaticAssertDecl(DEFAULT_GEN_MAP_SIZE <= PG_UINT16_MAX + 1, "generation slot must fit in uint16");
 
+/* 엔트리를 읽어 풀어 놓은 값 */
 typedef struct FgaL2AclValue
 {
-    bool allowed;
-
-    uint16_t global_gen; /* generation mismatch 시 invalid */
-    uint16_t object_gen; /* generation mismatch 시 invalid */
-
-    TimestampTz expires_at_ms; /* TTL 기준 만료 시간 (epoch ms) */
-    uint8 usage_count;         /* clock-sweep usage count */
+    uint64 allowed; /* relation 비트별 결과 */
+    uint64 known;   /* 결과를 아는 relation 비트 */
+    bool refresh_pending;
+    uint16 gen_slot;           /* generation 슬롯 (object_key & (DEFAULT_GEN_MAP_SIZE - 1)) */
+    uint16 subject_slot;       /* subject generation 슬롯 (subject_key & (DEFAULT_GEN_MAP_SIZE - 1)) */
+    uint32 gen_stamp;          /* 저장 시점 generation (mismatch 시 invalid) */
+    TimestampTz expires_at_ms; /* TTL 기준 만료 시간 (epoch ms, tick 단위로 내림) */
 } FgaL2AclValue;
 
-/* ACL Cache Entry */
+/* ACL Cache Entry (40 bytes) */
 typedef struct FgaL2AclEntry
 {
-    FgaAclCacheKey key;
-    FgaL2AclValue value;
-    bool valid;
+    uint64 fp_low;  /* key.low */
+    uint64 fp_high; /* key.high */
+    uint64 allowed; /* relation 비트별 결과 */
+    uint64 known;   /* 결과를 아는 relation 비트 */
+    uint32 expires; /* cache->epoch_ms 기준 tick */
+    uint32 stamp;   /* generation stamp */
 } FgaL2AclEntry;
 
-typedef struct FgaL2AclSlot
+typedef struct FgaL2Group
 {
-    FgaAclCacheKey key;
-    uint32 slot_no; /* entries[slot_no] */
-} FgaL2AclSlot;
+    pg_atomic_uint32 version;              /* seqlock (그룹 단위) */
+    uint8 tags[FGA_L2_GROUP_SIZE];         /* 0 = 빈 엔트리, 그 외 fga_probe_tag(key.high) */
+    uint8 usage[FGA_L2_GROUP_SIZE];        /* clock usage count (relaxed 갱신) */
+    uint16 gen_slots[FGA_L2_GROUP_SIZE];     /* 엔트리의 object generation 슬롯 */
+    uint16 subject_slots[FGA_L2_GROUP_SIZE]; /* 엔트리의 subject generation 슬롯 */
+    pg_atomic_uint32 refresh[FGA_L2_GROUP_SIZE]; /* 갱신 요청을 표시한 tick, 0 = 없음 (seqlock 밖, CAS) */
+    FgaL2AclEntry entries[FGA_L2_GROUP_SIZE];
+} FgaL2Group;
 
 typedef struct FgaL2AclCache
 {
-    LWLock* lock;                /* 8 shared cache lock */
-    pg_atomic_uint32 nextVictim; /* 4 clock hand index 0..capacity-1 */
-    uint32 capacity;             /* 4 number of slots in entries[] */
-    uint16 generation;           /* 2 global generation for invalidation */
-    char _pad[6];                /* padding for 32-byte alignment */
-    FgaL2AclEntry entries[FLEXIBLE_ARRAY_MEMBER];
+    uint32 capacity;    /* number of entries (group_count * FGA_L2_GROUP_SIZE) */
+    uint32 group_count; /* number of groups[] (power of two) */
+    uint32 group_mask;  /* group_count - 1 */
+    pg_atomic_uint32 prewarmed; /* BGW 시작 시 덤프 파일 적재 여부 (shmem 수명 동안 한 번) */
+    TimestampTz epoch_ms;       /* 만료 tick 의 기준 시각 */
+    FgaFreqSketch* sketch;      /* admission 용 빈도 추정 (groups[] 뒤에 위치) */
+    FgaL2Group groups[FLEXIBLE_ARRAY_MEMBER];
 } FgaL2AclCache;
 
-static HTAB* l2_slot_table = NULL;
+typedef enum FgaL2StoreResult
+{
+    FGA_L2_STORE_SKIPPED = 0, /* writer 경합으로 저장 포기 */
+    FGA_L2_STORE_INSERTED,    /* 같은 key / 빈 엔트리 / 만료된 엔트리에 저장 */
+    FGA_L2_STORE_EVICTED,     /* 살아 있는 엔트리를 밀어내고 저장 */
+    FGA_L2_STORE_REJECTED     /* admission 에서 거절 (victim 이 더 자주 쓰임) */
+} FgaL2StoreResult;
 
 static inline FgaL2AclCache* l2_cache(void)
 {
     return fga_get_state()->cache;
 }
 
-static Size l2_capacity_from_config()
+/* cache_size(MB) 에 들어가는 그룹 수 (2의 거듭제곱으로 내림) */
+static Size l2_group_count_from_config()
 {
     FgaConfig* config = fga_get_config();
 
     /* MB → bytes */
     Size bytes = (Size)config->cache_size * 1024 * 1024;
-    Size per = sizeof(FgaL2AclEntry);
+    Size groups = bytes / sizeof(FgaL2Group);
+
+    if (groups < FGA_L2_PROBE_GROUPS)
+        return FGA_L2_PROBE_GROUPS;
 
-    return bytes / per;
+    groups = pg_prevpower2_64(groups);
+    return Min(groups, (Size)PG_UINT32_MAX / FGA_L2_GROUP_SIZE / 2 + 1);
 }
 
-static Size l2_hash_size(Size capacity)
+static inline uint32 l2_home_group(const FgaL2AclCache* cache, const FgaAclCacheKey* key)
 {
-    return capacity * 2; // load factor 0.5
+    /* L1 이 key.low 하위 비트를 쓰므로 L2 는 상위 비트 사용 */
+    return (uint32)(key->low >> 32) & cache->group_mask;
 }
 
-static inline void l2_update_entry(
-    FgaL2AclEntry* entry, const FgaAclCacheKey* key, TimestampTz expires_at, bool allowed, uint16_t generation)
+static inline bool l2_key_equals(const FgaL2AclEntry* entry, const FgaAclCacheKey* key)
 {
-    entry->key = *key;
-    entry->value.allowed = allowed;
-    entry->value.expires_at_ms = expires_at;
-    entry->value.global_gen = generation;
-    entry->value.usage_count = FGA_L2_USAGE_MAX; /* 새로 갱신된 항목은 최대치로 시작 */
-    entry->valid = true;
+    return entry->fp_low == key->low && entry->fp_high == key->high;
 }
 
-static inline bool l2_entry_expired(const FgaL2AclCache* cache, const FgaL2AclEntry* entry, TimestampTz now_ms)
+/* epoch 기준 tick (범위를 넘으면 끝값으로) */
+static inline uint32 l2_ticks(const FgaL2AclCache* cache, TimestampTz ms)
 {
-    if (!entry->valid)
-        return true;
+    int64 ticks = (ms - cache->epoch_ms) / FGA_L2_TICK_MS;
+
+    if (ticks < 0)
+        return 0;
+    return (uint32)Min(ticks, (int64)PG_UINT32_MAX);
+}
+
+static inline TimestampTz l2_ticks_to_ms(const FgaL2AclCache* cache, uint32 ticks)
+{
+    return cache->epoch_ms + (TimestampTz)ticks * FGA_L2_TICK_MS;
+}
+
+static inline uint32 l2_stamp(const FgaGenerationSnapshot* snapshot)
+{
+    return snapshot->global + snapshot->object + snapshot->subject;
+}
 
-    if (entry->value.expires_at_ms <= now_ms)
+static inline bool
+l2_value_expired(const FgaL2AclValue* value, const FgaGenerationSnapshot* cur, TimestampTz now_ms)
+{
+    if (value->expires_at_ms <= now_ms)
         return true;
 
-    if (entry->value.global_gen != cache->generation)
+    if (value->gen_stamp != l2_stamp(cur))
         return true;
 
     return false;
 }
 
-static inline uint32 l2_clock_sweep(FgaL2AclCache* const cache)
+/* victim 후보 판정용: 다른 object/subject 의 엔트리이므로 그 슬롯들의 현재 generation 과 비교 */
+static inline bool l2_entry_stale(const FgaL2AclValue* value, TimestampTz now_ms)
 {
-    // Atomically move hand ahead one slot
-    uint32 victim = pg_atomic_fetch_add_u32(&cache->nextVictim, 1);
+    FgaGenerationSnapshot cur;
 
-    // wrap around
-    return victim % cache->capacity;
+    fga_generation_snapshot(value->gen_slot, value->subject_slot, &cur);
+    return l2_value_expired(value, &cur, now_ms);
 }
 
-static uint32 l2_find_victim_slot(FgaL2AclCache* const cache, TimestampTz now_ms)
+/*
+ * 엔트리 하나를 일관성 있게 복사.
+ * 그룹이 쓰는 중이거나 복사 도중 바뀌었으면 false (호출자는 그 엔트리를 miss 로 취급).
+ * key_out->object_key/subject_key 에는 generation 슬롯 번호가 들어간다 (원래 key 는 보관하지 않음).
+ */
+static inline bool l2_read_entry(const FgaL2AclCache* cache,
+                                 FgaL2Group* group,
+                                 int index,
+                                 FgaAclCacheKey* key_out,
+                                 FgaL2AclValue* value_out)
 {
-    uint32 trycounter = cache->capacity;
+    uint32 before = pg_atomic_read_u32(&group->version);
+    FgaL2AclEntry entry;
 
-    for (;;)
-    {
-        uint32 idx = l2_clock_sweep(cache);
-        FgaL2AclEntry* entry = &cache->entries[idx];
+    if (before & 1)
+        return false;
 
-        if (l2_entry_expired(cache, entry, now_ms))
-            return idx;
+    pg_read_barrier();
+    entry = group->entries[index];
+    value_out->gen_slot = group->gen_slots[index];
+    value_out->subject_slot = group->subject_slots[index];
+    pg_read_barrier();
 
-        if (entry->value.usage_count > 0)
-        {
-            entry->value.usage_count--;
-            trycounter = cache->capacity;
-        }
-        else
-        {
-            return idx;
-        }
+    if (pg_atomic_read_u32(&group->version) != before)
+        return false;
 
-        if (--trycounter == 0)
-            return UINT32_MAX;
-    }
+    MemSet(key_out, 0, sizeof(*key_out));
+    key_out->low = entry.fp_low;
+    key_out->high = entry.fp_high;
+    key_out->object_key = value_out->gen_slot;
+    key_out->subject_key = value_out->subject_slot;
+    key_out->relation_slot = RELATION_SLOT_NONE;
+
+    value_out->allowed = entry.allowed;
+    value_out->known = entry.known;
+    value_out->refresh_pending = pg_atomic_read_u32(&group->refresh[index]) != 0;
+    value_out->gen_stamp = entry.stamp;
+    value_out->expires_at_ms = l2_ticks_to_ms(cache, entry.expires);
+    return true;
 }
 
-static void l2_startup(void)
+static inline void l2_touch(FgaL2Group* group, int index)
 {
-    HASHCTL ctl;
-    FgaL2AclCache* cache;
-    Size hash_elems;
+    uint8 usage = group->usage[index];
 
-    if (l2_slot_table != NULL)
-        return;
+    /* relaxed: 동시에 올려서 하나가 유실돼도 무방 */
+    if (usage < FGA_L2_USAGE_MAX)
+        group->usage[index] = usage + 1;
+}
 
-    cache = fga_get_state()->cache;
-    hash_elems = l2_hash_size(cache->capacity);
+/* seqlock 획득: 짝수 → 홀수. 경쟁에서 지면 false (캐시는 best-effort) */
+static inline bool l2_group_begin_write(FgaL2Group* group, uint32* version_out)
+{
+    uint32 version = pg_atomic_read_u32(&group->version);
 
-    MemSet(&ctl, 0, sizeof(ctl));
-    ctl.keysize = sizeof(FgaAclCacheKey);
-    ctl.entrysize = sizeof(FgaL2AclSlot);
+    if ((version & 1) || !pg_atomic_compare_exchange_u32(&group->version, &version, version + 1))
+        return false;
 
-    l2_slot_table = ShmemInitHash(
-        FGA_L2_HASH_NAME, hash_elems, hash_elems, &ctl, HASH_ELEM | HASH_BLOBS | HASH_FIXED_SIZE | HASH_SHARED_MEM);
+    *version_out = version;
+    return true;
 }
 
-static bool l2_lookup(
-    FgaL2AclCache* cache, const FgaAclCacheKey* key, TimestampTz now_ms, bool* allowed_out, TimestampTz* expires_at)
+static inline void l2_group_end_write(FgaL2Group* group, uint32 version)
 {
-    bool found;
-    FgaL2AclSlot* slot;
-    FgaL2AclEntry* entry;
+    pg_write_barrier();
+    pg_atomic_write_u32(&group->version, version + 2);
+}
 
-    if (cache == NULL)
+/*
+ * 만료가 가까운 엔트리에 갱신 요청 표시를 남긴다.
+ * 같은 엔트리에 여러 백엔드가 몰려도 CAS 에 성공한 하나만 true 를 받는다.
+ * 표시가 claim_ticks 보다 오래됐으면 (결과도 실패 통보도 오지 않음) 다시 가져간다.
+ * 그룹 version 은 올리지 않는다. 표시한 사이 엔트리가 다른 key 로 바뀌었으면 표시를 되돌린다.
+ */
+static bool l2_claim_refresh(FgaL2Group* group, int index, const FgaAclCacheKey* key, uint32 now_tick, uint32 claim_ticks)
+{
+    uint32 claimed = pg_atomic_read_u32(&group->refresh[index]);
+
+    if (claimed != 0 && now_tick - claimed < claim_ticks)
         return false;
 
-    LWLockAcquire(cache->lock, LW_SHARED);
+    if (!pg_atomic_compare_exchange_u32(&group->refresh[index], &claimed, Max(now_tick, 1)))
+        return false;
 
-    slot = (FgaL2AclSlot*)hash_search(l2_slot_table, key, HASH_FIND, &found);
-    if (!found)
+    /* CAS 가 full barrier: 덮어쓴 writer 가 refresh 를 0 으로 만들기 전에 쓴 key 가 보인다 */
+    if ((pg_atomic_read_u32(&group->version) & 1) || !l2_key_equals(&group->entries[index], key))
     {
-        LWLockRelease(cache->lock);
+        pg_atomic_write_u32(&group->refresh[index], 0);
         return false;
     }
 
-    entry = &cache->entries[slot->slot_no];
+    return true;
+}
+
+/*
+ * refresh_window_ms > 0 이면 만료까지 그 이하로 남은 hit 에 대해
+ * 갱신 요청 표시를 시도하고, 성공하면 *refresh_out = true (호출자가 갱신 요청을 보낸다).
+ */
+static bool l2_lookup(FgaL2AclCache* cache,
+                      const FgaAclCacheKey* key,
+                      const FgaGenerationSnapshot* cur,
+                      TimestampTz now_ms,
+                      TimestampTz refresh_window_ms,
+                      bool* allowed_out,
+                      TimestampTz* expires_at,
+                      bool* refresh_out)
+{
+    uint32 home;
+    uint8 tag;
 
-    if (l2_entry_expired(cache, entry, now_ms))
-    {
-        entry->value.usage_count = 0; /* victim 빨리 되게 */
-        LWLockRelease(cache->lock);
+    if (cache == NULL)
         return false;
-    }
 
-    if (entry->value.usage_count < FGA_L2_USAGE_MAX)
-        entry->value.usage_count++;
+    home = l2_home_group(cache, key);
+    tag = fga_probe_tag(key->high);
 
-    *allowed_out = entry->value.allowed;
-    *expires_at = entry->value.expires_at_ms;
+    for (uint32 g = 0; g < FGA_L2_PROBE_GROUPS; g++)
+    {
+        FgaL2Group* group = &cache->groups[(home + g) & cache->group_mask];
+        FgaProbeMask match;
 
-    LWLockRelease(cache->lock);
-    return true;
+        for (match = fga_probe_match(group->tags, tag); match != 0; match = fga_probe_next(match))
+        {
+            int i = fga_probe_first(match);
+            FgaAclCacheKey k;
+            FgaL2AclValue v;
+
+            if (!l2_read_entry(cache, group, i, &k, &v) || k.low != key->low || k.high != key->high)
+                continue;
+
+            if (l2_value_expired(&v, cur, now_ms))
+            {
+                group->usage[i] = 0; /* victim 빨리 되게 */
+                return false;
+            }
+
+            /* 엔트리는 있지만 이 relation 은 아직 모름 */
+            if ((v.known & FGA_CACHE_RELATION_BIT(key)) == 0)
+                return false;
+
+            l2_touch(group, i);
+
+            if (refresh_window_ms > 0 && v.expires_at_ms - now_ms <= refresh_window_ms)
+                *refresh_out = l2_claim_refresh(group,
+                                                i,
+                                                key,
+                                                l2_ticks(cache, now_ms),
+                                                Max(refresh_window_ms / 2 / FGA_L2_TICK_MS, 1));
+
+            *allowed_out = (v.allowed & FGA_CACHE_RELATION_BIT(key)) != 0;
+            *expires_at = v.expires_at_ms;
+            return true;
+        }
+
+        /* 빈 자리가 있는 그룹: 이후 그룹에는 없음 */
+        if (fga_probe_match_empty(group->tags) != 0)
+            return false;
+    }
+
+    return false;
 }
 
-static void
-l2_store(FgaL2AclCache* cache, const FgaAclCacheKey* key, TimestampTz now_ms, TimestampTz expires_at, bool allowed)
+/* 갱신 요청이 실패했거나 보내지 못했을 때 표시를 지워 다음 hit 가 다시 요청하게 한다 */
+static void l2_release_refresh(FgaL2AclCache* cache, const FgaAclCacheKey* key)
 {
-    bool found;
-    FgaL2AclSlot* idx;
-    FgaL2AclEntry* entry;
+    uint32 home;
+    uint8 tag;
 
     if (cache == NULL)
         return;
 
-    LWLockAcquire(cache->lock, LW_EXCLUSIVE);
+    home = l2_home_group(cache, key);
+    tag = fga_probe_tag(key->high);
 
-    /* 1. 기존 엔트리 업데이트 */
-    idx = hash_search(l2_slot_table, key, HASH_FIND, &found);
-    if (found)
+    for (uint32 g = 0; g < FGA_L2_PROBE_GROUPS; g++)
     {
-        entry = &cache->entries[idx->slot_no];
-        l2_update_entry(entry, key, expires_at, allowed, cache->generation);
-        LWLockRelease(cache->lock);
-        return;
+        FgaL2Group* group = &cache->groups[(home + g) & cache->group_mask];
+        FgaProbeMask match;
+
+        for (match = fga_probe_match(group->tags, tag); match != 0; match = fga_probe_next(match))
+        {
+            int i = fga_probe_first(match);
+
+            if (l2_key_equals(&group->entries[i], key))
+            {
+                pg_atomic_write_u32(&group->refresh[i], 0);
+                return;
+            }
+        }
+
+        if (fga_probe_match_empty(group->tags) != 0)
+            return;
     }
+}
 
-    /* 2. find victim */
-    uint32 victim_slot = l2_find_victim_slot(cache, now_ms);
-    if (victim_slot == UINT32_MAX)
+/*
+ * 탐색 구간 안에서 저장할 엔트리를 고른다.
+ * 우선순위: 같은 key > 빈 엔트리 > 만료된 엔트리 > usage_count 가 가장 낮은 엔트리.
+ * 지나가는 엔트리의 usage_count 는 하나씩 깎는다 (구간 단위 clock).
+ * *victim_key_out = 고른 엔트리에 지금 있는 key (빈 엔트리면 0). 락 없이 고르므로 저장 시 다시 확인한다.
+ * 살아 있는 엔트리를 고르면 *live_out = true.
+ */
+static FgaL2Group* l2_find_victim_slot(FgaL2AclCache* const cache,
+                                       const FgaAclCacheKey* key,
+                                       TimestampTz now_ms,
+                                       int* index_out,
+                                       bool* live_out,
+                                       FgaAclCacheKey* victim_key_out)
+{
+    uint32 home = l2_home_group(cache, key);
+    uint8 tag = fga_probe_tag(key->high);
+    FgaL2Group* victim = NULL;
+    uint32 victim_usage = UINT32_MAX;
+
+    *live_out = false;
+    MemSet(victim_key_out, 0, sizeof(*victim_key_out));
+
+    for (uint32 g = 0; g < FGA_L2_PROBE_GROUPS; g++)
     {
-        /* victim 못 찾으면 그냥 포기 (캐시 미사용) */
-        LWLockRelease(cache->lock);
-        return;
+        FgaL2Group* group = &cache->groups[(home + g) & cache->group_mask];
+        FgaProbeMask match;
+        FgaProbeMask empty;
+
+        for (match = fga_probe_match(group->tags, tag); match != 0; match = fga_probe_next(match))
+        {
+            int i = fga_probe_first(match);
+
+            /* 쓰는 중이어도 같은 key 자리면 그대로 사용 (seqlock 획득에서 걸러짐) */
+            if (l2_key_equals(&group->entries[i], key))
+            {
+                *index_out = i;
+                *live_out = false;
+                victim_key_out->low = key->low;
+                victim_key_out->high = key->high;
+                return group;
+            }
+        }
+
+        empty = fga_probe_match_empty(group->tags);
+        if (empty != 0)
+        {
+            *index_out = fga_probe_first(empty);
+            *live_out = false;
+            MemSet(victim_key_out, 0, sizeof(*victim_key_out));
+            return group;
+        }
+
+        for (int i = 0; i < FGA_L2_GROUP_SIZE; i++)
+        {
+            FgaAclCacheKey k;
+            FgaL2AclValue v;
+            uint32 usage;
+            bool stale;
+
+            if (!l2_read_entry(cache, group, i, &k, &v))
+                break; /* 다른 writer 가 이 그룹을 사용 중 */
+
+            stale = l2_entry_stale(&v, now_ms);
+            if (stale)
+                usage = 0;
+            else
+            {
+                usage = group->usage[i];
+                if (usage > 0)
+                    group->usage[i] = usage - 1;
+            }
+
+            /* 같은 usage 면 만료된 엔트리 우선 */
+            if (usage < victim_usage || (usage == victim_usage && stale && *live_out))
+            {
+                victim = group;
+                victim_usage = usage;
+                *index_out = i;
+                *live_out = !stale;
+                *victim_key_out = k;
+            }
+        }
     }
 
-    entry = &cache->entries[victim_slot];
-    if (entry->valid)
+    return victim;
+}
+
+/*
+ * allowed/known: 이번에 알게 된 relation 비트들의 결과.
+ * 같은 key 의 유효한 엔트리(같은 generation, 만료 전)가 있으면 비트를 합치고 만료는 이른 쪽을 쓴다.
+ * 새 known 이 기존 비트를 모두 덮으면 (BatchCheck 로 다시 채움) 새 만료 시각으로 바꾼다.
+ * admission 이 true 면 살아 있는 victim 을 밀어내기 전에 빈도를 비교한다.
+ * (prewarm 적재처럼 빈도 기록 없이 채우는 경우는 false)
+ */
+static FgaL2StoreResult l2_store(FgaL2AclCache* cache,
+                                 const FgaAclCacheKey* key,
+                                 const FgaGenerationSnapshot* generation,
+                                 TimestampTz now_ms,
+                                 TimestampTz expires_at,
+                                 uint64 allowed,
+                                 uint64 known,
+                                 bool admission)
+{
+    FgaL2Group* group;
+    FgaL2AclEntry* entry;
+    FgaAclCacheKey victim_key;
+    uint32 version;
+    uint32 stamp = l2_stamp(generation);
+    uint32 expires = l2_ticks(cache, expires_at);
+    int index;
+    bool live;
+
+    if (cache == NULL)
+        return FGA_L2_STORE_SKIPPED;
+
+    group = l2_find_victim_slot(cache, key, now_ms, &index, &live, &victim_key);
+    if (group == NULL)
+        return FGA_L2_STORE_SKIPPED; /* 구간 전체가 다른 writer 에게 잡혀 있음: 저장 포기 */
+
+    if (live && admission && sketch_estimate(cache->sketch, key) <= sketch_estimate(cache->sketch, &victim_key))
+        return FGA_L2_STORE_REJECTED;
+
+    if (!l2_group_begin_write(group, &version))
+        return FGA_L2_STORE_SKIPPED;
+
+    entry = &group->entries[index];
+
+    /* 고른 뒤 잠그기 전에 다른 writer 가 그 자리를 채웠거나 바꿨으면 남의 엔트리를 덮어쓰지 않는다 */
+    if (group->tags[index] != FGA_PROBE_TAG_EMPTY && !l2_key_equals(entry, &victim_key))
     {
-        hash_search(l2_slot_table, &entry->key, HASH_REMOVE, NULL);
+        l2_group_end_write(group, version);
+        return FGA_L2_STORE_SKIPPED;
     }
 
-    /* 3. 새 엔트리 생성 */
-    idx = hash_search(l2_slot_table, key, HASH_ENTER, &found);
-    if (idx == NULL)
+    if (group->tags[index] != FGA_PROBE_TAG_EMPTY && l2_key_equals(entry, key) && entry->stamp == stamp &&
+        entry->expires > l2_ticks(cache, now_ms) && (known & entry->known) != entry->known)
     {
-        LWLockRelease(cache->lock);
-        ereport(ERROR, (errcode(ERRCODE_OUT_OF_MEMORY), errmsg("postfga: could not allocate L2 cache index entry")));
+        fga_cache_merge_relations(&entry->allowed, &entry->known, allowed, known);
+        entry->expires = Min(entry->expires, expires);
+        group->usage[index] = FGA_L2_USAGE_MAX;
+        pg_atomic_write_u32(&group->refresh[index], 0);
+
+        l2_group_end_write(group, version);
+        return FGA_L2_STORE_INSERTED;
     }
-    Assert(!found);
 
-    /* hash_search already filled in the key */
-    idx->slot_no = victim_slot;
+    entry->fp_low = key->low;
+    entry->fp_high = key->high;
+    entry->allowed = allowed & known;
+    entry->known = known;
+    entry->expires = expires;
+    entry->stamp = stamp;
+    group->gen_slots[index] = (uint16)(key->object_key & (DEFAULT_GEN_MAP_SIZE - 1));
+    group->subject_slots[index] = (uint16)(key->subject_key & (DEFAULT_GEN_MAP_SIZE - 1));
+    group->usage[index] = FGA_L2_USAGE_MAX; /* 새로 갱신된 항목은 최대치로 시작 */
+
+    /* key 를 쓴 뒤에 갱신 표시를 지운다 (l2_claim_refresh 가 바뀐 key 를 보고 되돌릴 수 있게) */
+    pg_write_barrier();
+    pg_atomic_write_u32(&group->refresh[index], 0);
+
+    /* tag 는 version 이 홀수인 동안 바꾼다: 그 사이 tag 로 찾아온 reader 는 version 검사에서 걸러짐 */
+    group->tags[index] = fga_probe_tag(key->high);
 
-    l2_update_entry(entry, key, expires_at, allowed, cache->generation);
+    l2_group_end_write(group, version);
 
-    LWLockRelease(cache->lock);
+    return live ? FGA_L2_STORE_EVICTED : FGA_L2_STORE_INSERTED;
 }
 
 #endif /* FGA_CACHE_L2_ACL_H */
@@ -0,0 +1,102 @@
+#ifndef FGA_CACHE_PROBE_H
+#define FGA_CACHE_PROBE_H
+
+/*
+ * Swiss-table 방식 tag 그룹 탐색
+ *
+ * 엔트리 16개마다 1바이트 tag 16개를 붙여 두고, 조회 시 tag 를 한 번에 비교해
+ * 후보 엔트리의 비트마스크를 얻는다. 전체 key 비교는 후보에 대해서만 한다.
+ *   tag = 해시 상위 7비트 | 0x80  (0 은 빈 엔트리)
+ *
+ * PostgreSQL 헤더에 의존하지 않는다 (scripts/bench_cache_probe.c 에서 단독 컴파일).
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FGA_PROBE_USE_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define FGA_PROBE_USE_NEON 1
+#endif
+
+#define FGA_PROBE_GROUP_SIZE 16
+#define FGA_PROBE_TAG_EMPTY 0
+
+typedef uint16_t FgaProbeMask; /* bit i = tags[i] 일치 */
+
+static inline uint8_t fga_probe_tag(uint64_t hash)
+{
+    return (uint8_t)((hash >> 57) | 0x80);
+}
+
+/* tags[0..15] 중 tag 와 같은 위치의 비트마스크 */
+static inline FgaProbeMask fga_probe_match(const uint8_t* tags, uint8_t tag)
+{
+#if defined(FGA_PROBE_USE_SSE2)
+    __m128i group = _mm_loadu_si128((const __m128i*)tags);
+    __m128i eq = _mm_cmpeq_epi8(group, _mm_set1_epi8((char)tag));
+
+    return (FgaProbeMask)_mm_movemask_epi8(eq);
+#elif defined(FGA_PROBE_USE_NEON)
+    static const uint8_t bit_weights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    uint8x16_t eq = vceqq_u8(vld1q_u8(tags), vdupq_n_u8(tag));
+    uint8x16_t bits = vandq_u8(eq, vld1q_u8(bit_weights));
+
+    return (FgaProbeMask)(vaddv_u8(vget_low_u8(bits)) | (vaddv_u8(vget_high_u8(bits)) << 8));
+#else
+    /* scalar: 8바이트씩 SWAR 로 0 바이트 검출 */
+    FgaProbeMask mask = 0;
+
+    for (int half = 0; half < 2; half++)
+    {
+        uint64_t word;
+        uint64_t x;
+        uint64_t zero;
+
+        memcpy(&word, tags + half * 8, sizeof(word));
+        x = word ^ (0x0101010101010101ULL * tag);
+        zero = ~(((x & 0x7F7F7F7F7F7F7F7FULL) + 0x7F7F7F7F7F7F7F7FULL) | x | 0x7F7F7F7F7F7F7F7FULL);
+
+        for (int i = 0; i < 8; i++)
+        {
+            if (zero & (0x80ULL << (i * 8)))
+                mask |= (FgaProbeMask)(1u << (half * 8 + i));
+        }
+    }
+    return mask;
+#endif
+}
+
+/* 빈 엔트리 위치 */
+static inline FgaProbeMask fga_probe_match_empty(const uint8_t* tags)
+{
+    return fga_probe_match(tags, FGA_PROBE_TAG_EMPTY);
+}
+
+/* mask 의 가장 낮은 비트 위치 (mask != 0) */
+static inline int fga_probe_first(FgaProbeMask mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz((unsigned)mask);
+#else
+    int i = 0;
+
+    while ((mask & 1) == 0)
+    {
+        mask >>= 1;
+        i++;
+    }
+    return i;
+#endif
+}
+
+/* for (mask ...; mask != 0; mask = fga_probe_next(mask)) */
+static inline FgaProbeMask fga_probe_next(FgaProbeMask mask)
+{
+    return (FgaProbeMask)(mask & (mask - 1));
+}
+
+#endif /* FGA_CACHE_PROBE_H */
@@ -0,0 +1,136 @@
+#ifndef FGA_CACHE_SKETCH_H
+#define FGA_CACHE_SKETCH_H
+
+#include <postgres.h>
+
+#include <port/atomics.h>
+#include <port/pg_bitutils.h>
+
+#include "cache.h"
+
+/*
+ * L2 admission 용 접근 빈도 추정 (TinyLFU, Count-Min sketch)
+ * - 4개 row, row 마다 4비트 counter 를 L2 용량 이상(2의 거듭제곱)만큼
+ *   pg_atomic_uint32 하나에 counter 8개. 엔트리당 약 2바이트
+ * - counter 는 15 에서 포화. 증가는 CAS, 포화된 counter 는 읽기만 하므로 hot key 에서 경합이 없다
+ * - 증가 횟수가 sample_size(용량 x 10) 에 이르면 모든 counter 를 절반으로 (aging)
+ *   절반으로 줄이는 동안의 동시 증가는 유실될 수 있으나 추정치라 무방
+ */
+#define FGA_SKETCH_DEPTH 4
+#define FGA_SKETCH_COUNTERS_PER_WORD 8
+#define FGA_SKETCH_COUNTER_MAX 15
+#define FGA_SKETCH_SAMPLE_FACTOR 10
+
+typedef struct FgaFreqSketch
+{
+    uint32 row_words;           /* row 하나의 word 수 */
+    uint32 index_shift;         /* 64 - log2(row 당 counter 수) */
+    uint32 sample_size;         /* 이만큼 증가하면 절반으로 */
+    pg_atomic_uint32 additions; /* 마지막 aging 이후 증가 횟수 */
+    pg_atomic_uint32 words[FLEXIBLE_ARRAY_MEMBER]; /* [FGA_SKETCH_DEPTH * row_words] */
+} FgaFreqSketch;
+
+/* row 마다 다른 홀수 곱셈 상수 (Fibonacci hashing) */
+static const uint64 fga_sketch_seeds[FGA_SKETCH_DEPTH] = {
+    UINT64CONST(0x9E3779B97F4A7C15),
+    UINT64CONST(0xC2B2AE3D27D4EB4F),
+    UINT64CONST(0x165667B19E3779F9),
+    UINT64CONST(0xD6E8FEB86659FD93),
+};
+
+static inline uint32 sketch_row_words(uint32 capacity)
+{
+    uint64 counters = pg_nextpower2_64(Max(capacity, 64));
+
+    return (uint32)(counters / FGA_SKETCH_COUNTERS_PER_WORD);
+}
+
+static inline Size sketch_shmem_size(uint32 capacity)
+{
+    return add_size(offsetof(FgaFreqSketch, words),
+                    mul_size(sizeof(pg_atomic_uint32), mul_size(FGA_SKETCH_DEPTH, sketch_row_words(capacity))));
+}
+
+static void sketch_init(FgaFreqSketch* sketch, uint32 capacity)
+{
+    uint32 row_words = sketch_row_words(capacity);
+    uint64 counters = (uint64)row_words * FGA_SKETCH_COUNTERS_PER_WORD;
+
+    sketch->row_words = row_words;
+    sketch->index_shift = 64 - pg_leftmost_one_pos64(counters);
+    sketch->sample_size = (uint32)Min((uint64)capacity * FGA_SKETCH_SAMPLE_FACTOR, (uint64)PG_INT32_MAX);
+    pg_atomic_init_u32(&sketch->additions, 0);
+
+    for (uint32 i = 0; i < FGA_SKETCH_DEPTH * row_words; i++)
+        pg_atomic_init_u32(&sketch->words[i], 0);
+}
+
+/* row 의 counter 위치: word 와 word 안의 bit 위치 */
+static inline pg_atomic_uint32*
+sketch_counter(FgaFreqSketch* sketch, const FgaAclCacheKey* key, int row, int* shift_out)
+{
+    uint64 index = ((key->low ^ key->high) * fga_sketch_seeds[row]) >> sketch->index_shift;
+
+    *shift_out = (int)(index % FGA_SKETCH_COUNTERS_PER_WORD) * 4;
+    return &sketch->words[(Size)row * sketch->row_words + index / FGA_SKETCH_COUNTERS_PER_WORD];
+}
+
+static void sketch_halve(FgaFreqSketch* sketch)
+{
+    for (uint32 i = 0; i < FGA_SKETCH_DEPTH * sketch->row_words; i++)
+    {
+        uint32 word = pg_atomic_read_u32(&sketch->words[i]);
+
+        if (word != 0)
+            pg_atomic_write_u32(&sketch->words[i], (word >> 1) & 0x77777777);
+    }
+}
+
+/* key 접근 한 번 기록 */
+static void sketch_increment(FgaFreqSketch* sketch, const FgaAclCacheKey* key)
+{
+    bool added = false;
+
+    if (sketch == NULL)
+        return;
+
+    for (int row = 0; row < FGA_SKETCH_DEPTH; row++)
+    {
+        int shift;
+        pg_atomic_uint32* word = sketch_counter(sketch, key, row, &shift);
+        uint32 old = pg_atomic_read_u32(word);
+
+        while (((old >> shift) & FGA_SKETCH_COUNTER_MAX) < FGA_SKETCH_COUNTER_MAX)
+        {
+            if (pg_atomic_compare_exchange_u32(word, &old, old + (1u << shift)))
+            {
+                added = true;
+                break;
+            }
+        }
+    }
+
+    /* 정확히 sample_size 번째 증가를 한 프로세스 하나만 aging 수행 */
+    if (added && pg_atomic_fetch_add_u32(&sketch->additions, 1) + 1 == sketch->sample_size)
+    {
+        sketch_halve(sketch);
+        pg_atomic_write_u32(&sketch->additions, sketch->sample_size / 2);
+    }
+}
+
+/* 추정 빈도: row 들 중 최소값 */
+static inline uint32 sketch_estimate(FgaFreqSketch* sketch, const FgaAclCacheKey* key)
+{
+    uint32 freq = FGA_SKETCH_COUNTER_MAX;
+
+    for (int row = 0; row < FGA_SKETCH_DEPTH; row++)
+    {
+        int shift;
+        pg_atomic_uint32* word = sketch_counter(sketch, key, row, &shift);
+
+        freq = Min(freq, (pg_atomic_read_u32(word) >> shift) & FGA_SKETCH_COUNTER_MAX);
+    }
+    return freq;
+}
+
+#endif /* FGA_CACHE_SKETCH_H */
@@ -0,0 +1,329 @@
+/*-------------------------------------------------------------------------
+ *
+ * cache_ttl.c
+ *    Per-relation cache TTL policy for PostFGA extension.
+ *
+ * This module implements:
+ *   - fga.cache_ttl_policy parsing (GUC check/assign hooks)
+ *   - Rule resolution for one (object_type, relation)
+ *   - Backend-local TTL tables indexed by relation bit
+ *
+ * 규칙은 GUC 를 바꿀 때 한 번 파싱한다. type 별 표는 처음 저장할 때 만들고,
+ * 정책이 바뀌거나 type 에 relation 이 새로 등록되면 그 부분만 다시 채운다.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <postgres.h>
+
+#include <string.h>
+#include <utils/hsearch.h>
+#include <utils/memutils.h>
+
+#include "cache_ttl.h"
+#include "config.h"
+
+typedef struct TtlRule
+{
+    char object_type[OBJECT_TYPE_MAX_LEN]; /* "" = 모든 type */
+    char relation[RELATION_MAX_LEN];       /* "" = 모든 relation */
+    bool allow;
+    bool deny;
+    int32 ttl_ms;
+} TtlRule;
+
+typedef struct TtlPolicy
+{
+    int count;
+    int32 min_ms; /* 0 이 아닌 TTL 중 최소 (규칙이 없으면 PG_INT32_MAX) */
+    TtlRule rules[FLEXIBLE_ARRAY_MEMBER];
+} TtlPolicy;
+
+typedef struct TtlTypeEntry
+{
+    char object_type[OBJECT_TYPE_MAX_LEN];
+    uint32 version; /* policy_version 과 다르면 다시 채운다 */
+    uint64 mask;    /* ttls 를 채운 비트 */
+    FgaCacheTtl ttls[RELATION_BITS_PER_TYPE];
+} TtlTypeEntry;
+
+/* per-backend */
+static const TtlPolicy* policy = NULL;
+static uint32 policy_version = 1;
+static HTAB* type_tables = NULL;
+
+/* -------------------------------------------------------------------------
+ * Parsing
+ * -------------------------------------------------------------------------
+ */
+static bool copy_name(char* dst, size_t dst_size, const char* src, size_t len)
+{
+    if (len == 0 || len >= dst_size)
+        return false;
+
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+    return true;
+}
+
+/* "대상[:allow|:deny]=TTL" 하나. 실패하면 GUC_check_errdetail 을 남기고 false */
+static bool parse_rule(char* item, TtlRule* rule)
+{
+    char* eq = strchr(item, '=');
+    char* target = item;
+    char* outcome;
+    char* hash;
+    const char* hint = NULL;
+    int ttl_ms;
+
+    MemSet(rule, 0, sizeof(*rule));
+
+    if (eq == NULL)
+    {
+        GUC_check_errdetail("Rule \"%s\" has no \"=TTL\".", item);
+        return false;
+    }
+    *eq = '\0';
+
+    if (!parse_int(eq + 1, &ttl_ms, GUC_UNIT_MS, &hint) || ttl_ms < 0 || ttl_ms > FGA_CACHE_TTL_MAX_MS)
+    {
+        GUC_check_errdetail("Invalid TTL \"%s\" for \"%s\".", eq + 1, target);
+        if (hint != NULL)
+            GUC_check_errhint("%s", hint);
+        return false;
+    }
+    rule->ttl_ms = ttl_ms;
+
+    outcome = strchr(target, ':');
+    if (outcome == NULL)
+        rule->allow = rule->deny = true;
+    else
+    {
+        *outcome++ = '\0';
+        if (strcmp(outcome, "allow") == 0)
+            rule->allow = true;
+        else if (strcmp(outcome, "deny") == 0)
+            rule->deny = true;
+        else
+        {
+            GUC_check_errdetail("Unknown outcome \"%s\", expected \"allow\" or \"deny\".", outcome);
+            return false;
+        }
+    }
+
+    if (strcmp(target, "*") == 0)
+        return true;
+
+    hash = strchr(target, '#');
+    if (hash == NULL)
+    {
+        if (!copy_name(rule->relation, sizeof(rule->relation), target, strlen(target)))
+        {
+            GUC_check_errdetail("Invalid relation \"%s\".", target);
+            return false;
+        }
+        return true;
+    }
+
+    if (!copy_name(rule->object_type, sizeof(rule->object_type), target, hash - target) ||
+        (strcmp(hash + 1, "*") != 0 && !copy_name(rule->relation, sizeof(rule->relation), hash + 1, strlen(hash + 1))))
+    {
+        GUC_check_errdetail("Invalid target \"%s\", expected type#relation, relation, type#* or *.", target);
+        return false;
+    }
+    return true;
+}
+
+static char* trim(char* s)
+{
+    char* end;
+
+    while (*s == ' ' || *s == '\t')
+        s++;
+    end = s + strlen(s);
+    while (end > s && (end[-1] == ' ' || end[-1] == '\t'))
+        *--end = '\0';
+    return s;
+}
+
+bool fga_cache_ttl_policy_check(char** newval, void** extra, GucSource source)
+{
+    char* list;
+    char* item;
+    char* next;
+    int capacity = 1;
+    TtlPolicy* parsed;
+
+    for (const char* p = *newval; *p != '\0'; p++)
+    {
+        if (*p == ',')
+            capacity++;
+    }
+
+    parsed = (TtlPolicy*)guc_malloc(LOG, offsetof(TtlPolicy, rules) + sizeof(TtlRule) * capacity);
+    if (parsed == NULL)
+        return false;
+    parsed->count = 0;
+    parsed->min_ms = PG_INT32_MAX;
+
+    list = pstrdup(*newval);
+    for (item = list; item != NULL; item = next)
+    {
+        next = strchr(item, ',');
+        if (next != NULL)
+            *next++ = '\0';
+
+        item = trim(item);
+        if (*item == '\0')
+            continue;
+
+        if (!parse_rule(item, &parsed->rules[parsed->count]))
+        {
+            pfree(list);
+            guc_free(parsed);
+            return false;
+        }
+        if (parsed->rules[parsed->count].ttl_ms > 0)
+            parsed->min_ms = Min(parsed->min_ms, parsed->rules[parsed->count].ttl_ms);
+        parsed->count++;
+    }
+    pfree(list);
+
+    *extra = parsed;
+    return true;
+}
+
+void fga_cache_ttl_policy_assign(const char* newval, void* extra)
+{
+    policy = (const TtlPolicy*)extra;
+    policy_version++;
+}
+
+/* -------------------------------------------------------------------------
+ * Resolution
+ * -------------------------------------------------------------------------
+ */
+static bool name_matches(const char* pattern, const char* name, size_t len)
+{
+    return pattern[0] == '\0' || (strlen(pattern) == len && strncmp(pattern, name, len) == 0);
+}
+
+/* type#relation > relation > type#* > * */
+static int specificity(const TtlRule* rule)
+{
+    return (rule->relation[0] != '\0' ? 2 : 0) + (rule->object_type[0] != '\0' ? 1 : 0);
+}
+
+static FgaCacheTtl resolve(const char* object_type, size_t type_len, const char* relation, size_t relation_len)
+{
+    FgaCacheTtl ttl = {FGA_CACHE_TTL_DEFAULT, FGA_CACHE_TTL_DEFAULT};
+    int allow_best = -1;
+    int deny_best = -1;
+
+    if (policy == NULL)
+        return ttl;
+
+    for (int i = 0; i < policy->count; i++)
+    {
+        const TtlRule* rule = &policy->rules[i];
+        int score;
+
+        if (!name_matches(rule->object_type, object_type, type_len) ||
+            !name_matches(rule->relation, relation, relation_len))
+            continue;
+
+        score = specificity(rule);
+        if (rule->allow && score >= allow_best)
+        {
+            ttl.allow_ms = rule->ttl_ms;
+            allow_best = score;
+        }
+        if (rule->deny && score >= deny_best)
+        {
+            ttl.deny_ms = rule->ttl_ms;
+            deny_best = score;
+        }
+    }
+    return ttl;
+}
+
+/* -------------------------------------------------------------------------
+ * Public API
+ * -------------------------------------------------------------------------
+ */
+static TtlTypeEntry* type_table(const char* object_type, size_t type_len)
+{
+    char type_key[OBJECT_TYPE_MAX_LEN];
+    TtlTypeEntry* entry;
+    bool found;
+
+    if (type_tables == NULL)
+    {
+        HASHCTL ctl;
+
+        MemSet(&ctl, 0, sizeof(ctl));
+        ctl.keysize = OBJECT_TYPE_MAX_LEN;
+        ctl.entrysize = sizeof(TtlTypeEntry);
+        ctl.hcxt = TopMemoryContext;
+        type_tables = hash_create("PostFGA cache TTL", 16, &ctl, HASH_ELEM | HASH_STRINGS | HASH_CONTEXT);
+    }
+
+    MemSet(type_key, 0, sizeof(type_key));
+    memcpy(type_key, object_type, type_len);
+
+    entry = (TtlTypeEntry*)hash_search(type_tables, type_key, HASH_ENTER, &found);
+    if (!found || entry->version != policy_version)
+    {
+        entry->version = policy_version;
+        entry->mask = 0;
+        for (int bit = 0; bit < RELATION_BITS_PER_TYPE; bit++)
+            entry->ttls[bit].allow_ms = entry->ttls[bit].deny_ms = FGA_CACHE_TTL_DEFAULT;
+    }
+    return entry;
+}
+
+const FgaCacheTtl* fga_cache_ttls(bool grouped,
+                                  const char* object_type,
+                                  size_t type_len,
+                                  const char* relation,
+                                  size_t relation_len,
+                                  FgaCacheTtl* single)
+{
+    TtlTypeEntry* entry;
+    uint64 missing;
+
+    if (!grouped || type_len == 0 || type_len >= OBJECT_TYPE_MAX_LEN)
+    {
+        *single = resolve(object_type, type_len, relation, relation_len);
+        return single;
+    }
+
+    /* 규칙이 없으면 모든 비트가 기본값 */
+    entry = type_table(object_type, type_len);
+    if (policy == NULL || policy->count == 0)
+        return entry->ttls;
+
+    missing = fga_relation_type_mask(object_type, type_len) & ~entry->mask;
+    if (missing != 0)
+    {
+        const char* names[RELATION_BITS_PER_TYPE];
+
+        fga_relation_names(entry->object_type, missing, names);
+        for (int bit = 0; bit < RELATION_BITS_PER_TYPE; bit++)
+        {
+            if (names[bit] != NULL)
+                entry->ttls[bit] = resolve(object_type, type_len, names[bit], strlen(names[bit]));
+        }
+        entry->mask |= missing;
+    }
+    return entry->ttls;
+}
+
+int32 fga_cache_ttl_min_ms(void)
+{
+    int32 ttl = fga_get_config()->cache_ttl_ms;
+
+    if (policy != NULL)
+        ttl = Min(ttl, policy->min_ms);
+    return ttl;
+}
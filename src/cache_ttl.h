@@ -0,0 +1,66 @@
+/*-------------------------------------------------------------------------
+ *
+ * cache_ttl.h
+ *    Per-relation cache TTL policy for PostFGA extension.
+ *
+ * fga.cache_ttl_policy 의 규칙을 relation 비트 번호로 인덱싱하는 표로 풀어 둔다.
+ * 저장할 때 엔트리의 만료 시각은 배열 조회만으로 정해진다.
+ *
+ *   규칙   := 대상[:allow|:deny]=TTL    (결과를 생략하면 둘 다)
+ *   대상   := type#relation | relation | type#* | *
+ *   예)    'owner:allow=1h, document#viewer=30s, *:deny=2s'
+ *
+ * 더 구체적인 대상이 이긴다 (type#relation > relation > type#* > *), 같으면 뒤의 규칙.
+ * 규칙이 없으면 fga.cache_ttl_ms. TTL 0 은 그 결과를 캐시하지 않는다.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef FGA_CACHE_TTL_H
+#define FGA_CACHE_TTL_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <postgres.h>
+
+#include <utils/guc.h>
+
+#include "relation.h"
+
+/* relation 하나의 TTL (ms, FGA_CACHE_TTL_DEFAULT = fga.cache_ttl_ms) */
+#define FGA_CACHE_TTL_DEFAULT (-1)
+#define FGA_CACHE_TTL_MAX_MS (24 * 3600 * 1000)
+
+    typedef struct FgaCacheTtl
+    {
+        int32 allow_ms;
+        int32 deny_ms;
+    } FgaCacheTtl;
+
+    /* fga.cache_ttl_policy check/assign hook (guc.c) */
+    bool fga_cache_ttl_policy_check(char** newval, void** extra, GucSource source);
+    void fga_cache_ttl_policy_assign(const char* newval, void* extra);
+
+    /*
+     * 엔트리의 relation_id 로 인덱싱하는 TTL 표.
+     * grouped 면 object_type 에 등록된 relation 비트 전체의 표 (backend-local, 정책이 바뀌면 다시 만든다),
+     * 아니면 relation 하나의 TTL 을 single 에 채워 그 주소를 반환한다 (relation_id 0).
+     */
+    const FgaCacheTtl* fga_cache_ttls(bool grouped,
+                                      const char* object_type,
+                                      size_t type_len,
+                                      const char* relation,
+                                      size_t relation_len,
+                                      FgaCacheTtl* single);
+
+    /* 정책과 fga.cache_ttl_ms 중 가장 짧은 (0 이 아닌) TTL: 갱신 구간 상한용 */
+    int32 fga_cache_ttl_min_ms(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FGA_CACHE_TTL_H */
@@ -0,0 +1,148 @@
+/*-------------------------------------------------------------------------
+ *
+ * change_feed.c
+ *    OpenFGA ReadChanges 기반 캐시 무효화 (shared state / persistence).
+ *
+ * 파일 형식은 두 줄: store_id, continuation token.
+ * 파일 입출력 실패는 LOG 로만 남긴다. token 을 잃으면 BGW 가 현재 시각부터
+ * 다시 읽고 store 전체를 무효화하므로 오래된 결과가 남지 않는다.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <postgres.h>
+
+#include <storage/fd.h>
+#include <storage/lwlock.h>
+
+#include "cache.h"
+#include "change_feed.h"
+#include "state.h"
+
+static inline FgaChangeFeedState* change_feed_state(void)
+{
+    return fga_get_state()->change_feed;
+}
+
+static void chomp(char* line)
+{
+    size_t len = strlen(line);
+
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+        line[--len] = '\0';
+}
+
+static bool read_token_file(const char* store_id, char* token_out, size_t token_len)
+{
+    char file_store[OPENFGA_STORE_ID_LEN + 2];
+    char file_token[FGA_CHANGE_TOKEN_LEN + 2];
+    FILE* file;
+    bool found = false;
+
+    file = AllocateFile(FGA_CHANGE_FEED_FILE, PG_BINARY_R);
+    if (file == NULL)
+    {
+        if (errno != ENOENT)
+            ereport(LOG, (errcode_for_file_access(), errmsg("postfga: could not read \"%s\": %m", FGA_CHANGE_FEED_FILE)));
+        return false;
+    }
+
+    if (fgets(file_store, sizeof(file_store), file) != NULL && fgets(file_token, sizeof(file_token), file) != NULL)
+    {
+        chomp(file_store);
+        chomp(file_token);
+
+        /* 다른 store 의 token 은 의미 없음 */
+        if (strcmp(file_store, store_id) == 0 && file_token[0] != '\0')
+        {
+            strlcpy(token_out, file_token, token_len);
+            found = true;
+        }
+    }
+
+    FreeFile(file);
+    return found;
+}
+
+static void write_token_file(const char* store_id, const char* token)
+{
+    const char* tmp_path = FGA_CHANGE_FEED_FILE ".tmp";
+    FILE* file;
+
+    file = AllocateFile(tmp_path, PG_BINARY_W);
+    if (file == NULL)
+    {
+        ereport(LOG, (errcode_for_file_access(), errmsg("postfga: could not write \"%s\": %m", tmp_path)));
+        return;
+    }
+
+    if (fprintf(file, "%s\n%s\n", store_id, token) < 0 || FreeFile(file) != 0)
+    {
+        ereport(LOG, (errcode_for_file_access(), errmsg("postfga: could not write \"%s\": %m", tmp_path)));
+        unlink(tmp_path);
+        return;
+    }
+
+    /* 교체는 원자적으로: 도중에 죽어도 이전 token 이 남는다 */
+    (void)durable_rename(tmp_path, FGA_CHANGE_FEED_FILE, LOG);
+}
+
+/*-------------------------------------------------------------------------
+ * Shared memory
+ *-------------------------------------------------------------------------*/
+Size fga_change_feed_shmem_size(void)
+{
+    return sizeof(FgaChangeFeedState);
+}
+
+void fga_change_feed_shmem_init(FgaChangeFeedState* feed)
+{
+    feed->store_id[0] = '\0';
+    feed->token[0] = '\0';
+}
+
+/*-------------------------------------------------------------------------
+ * Public API
+ *-------------------------------------------------------------------------*/
+bool fga_change_feed_load_token(const char* store_id, char* token_out, size_t token_len)
+{
+    FgaChangeFeedState* feed = change_feed_state();
+    FgaState* state = fga_get_state();
+    bool found = false;
+
+    LWLockAcquire(state->lock, LW_SHARED);
+    if (strcmp(feed->store_id, store_id) == 0 && feed->token[0] != '\0')
+    {
+        strlcpy(token_out, feed->token, token_len);
+        found = true;
+    }
+    LWLockRelease(state->lock);
+
+    if (!found)
+        found = read_token_file(store_id, token_out, token_len);
+
+    return found;
+}
+
+void fga_change_feed_save_token(const char* store_id, const char* token)
+{
+    FgaChangeFeedState* feed = change_feed_state();
+    FgaState* state = fga_get_state();
+
+    LWLockAcquire(state->lock, LW_EXCLUSIVE);
+    strlcpy(feed->store_id, store_id, sizeof(feed->store_id));
+    strlcpy(feed->token, token, sizeof(feed->token));
+    LWLockRelease(state->lock);
+
+    write_token_file(store_id, token);
+}
+
+void fga_change_feed_apply(const char* store_id, const char* object, const char* user)
+{
+    const char* colon = strchr(object, ':');
+
+    if (colon == NULL)
+        return; /* "type:id" 형식이 아니면 무시 */
+
+    fga_cache_invalidate_object(
+        store_id, object, colon - object, colon + 1, strlen(colon + 1), user, strlen(user));
+}
@@ -0,0 +1,54 @@
+/*-------------------------------------------------------------------------
+ *
+ * change_feed.h
+ *    OpenFGA ReadChanges 기반 캐시 무효화 (shared state / persistence).
+ *
+ * BGW 가 ReadChanges 를 주기적으로 호출해 Postgres 밖에서 일어난 tuple 변경을
+ * 캐시 generation 에 반영한다 (bgw/change_feed.cpp).
+ * continuation token 은 shared memory 에 두어 BGW 재시작 시 이어서 읽고,
+ * 파일(FGA_CHANGE_FEED_FILE)에도 저장해 서버 재시작 후에도 이어서 읽는다.
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef FGA_CHANGE_FEED_H
+#define FGA_CHANGE_FEED_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <postgres.h>
+
+#include "postfga.h"
+
+/* $PGDATA 기준 상대 경로 */
+#define FGA_CHANGE_FEED_FILE "pg_stat/postfga_changes.token"
+#define FGA_CHANGE_TOKEN_LEN 512
+
+    typedef struct FgaChangeFeedState
+    {
+        char store_id[OPENFGA_STORE_ID_LEN]; /* token 이 속한 store ("" = 없음) */
+        char token[FGA_CHANGE_TOKEN_LEN];    /* 마지막으로 반영한 continuation token */
+    } FgaChangeFeedState;
+
+    Size fga_change_feed_shmem_size(void);
+    void fga_change_feed_shmem_init(FgaChangeFeedState* feed);
+
+    /*
+     * store 의 마지막 token 을 token_out 에 복사. shared memory 에 없으면 파일에서 읽는다.
+     * 이어서 읽을 token 이 없으면 false.
+     */
+    bool fga_change_feed_load_token(const char* store_id, char* token_out, size_t token_len);
+
+    /* token 을 shared memory 와 파일에 기록 (BGW 전용) */
+    void fga_change_feed_save_token(const char* store_id, const char* token);
+
+    /* ReadChanges 의 변경 하나를 캐시에 반영. object = "type:id", user = "type:id[#relation]" */
+    void fga_change_feed_apply(const char* store_id, const char* object, const char* user);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FGA_CHANGE_FEED_H */
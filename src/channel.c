@@ -12,7 +12,9 @@
 
 #include "channel.h"
 #include "channel_slot.h"
+#include "config.h"
 #include "state.h"
+#include "stats.h"
 
 /*-------------------------------------------------------------------------
  * Static helpers
@@ -52,21 +54,52 @@
 //     return slot;
 // }
 
-static FgaChannelSlotState wait_response(FgaChannel* channel, FgaChannelSlot* slot)
+/* 오류로 기다림을 그만둘 때 슬롯 하나를 정리 */
+static void abandon_slot(FgaChannelSlot* slot)
+{
+    FgaChannelSlotState cur = (FgaChannelSlotState)pg_atomic_read_u32(&slot->state);
+
+    if (cur == FGA_CHANNEL_SLOT_PENDING || cur == FGA_CHANNEL_SLOT_PROCESSING)
+    {
+        /* 아직 BGW가 처리 중일 가능성이 있으니, CANCEL 표시만 한다 */
+        pg_atomic_write_u32(&slot->state, FGA_CHANNEL_SLOT_CANCELED);
+    }
+    else if (cur == FGA_CHANNEL_SLOT_DONE)
+    {
+        /* 이미 처리 완료된 상태였으면 여기서 정리해도 됨 */
+        fga_channel_release_slot(slot);
+    }
+    slot->backend_pid = InvalidPid;
+    /* freelist로는 아직 돌리지 않는다. BGW에서 처리 */
+}
+
+/* 모든 슬롯이 DONE 또는 CANCELED 가 될 때까지 기다린다. 하나라도 CANCELED 면 false */
+static bool wait_responses(FgaChannel* channel, FgaChannelSlot** slots, int count)
 {
     int rc;
-    FgaChannelSlotState state;
+    bool canceled = false;
 
     Assert(channel != NULL);
-    Assert(slot != NULL);
-    Assert(slot->backend_pid == MyProcPid);
 
     PG_TRY();
     {
         for (;;)
         {
-            state = (FgaChannelSlotState)pg_atomic_read_u32(&slot->state);
-            if (state == FGA_CHANNEL_SLOT_DONE || state == FGA_CHANNEL_SLOT_CANCELED)
+            int finished = 0;
+
+            canceled = false;
+            for (int i = 0; i < count; i++)
+            {
+                FgaChannelSlotState state = (FgaChannelSlotState)pg_atomic_read_u32(&slots[i]->state);
+
+                Assert(slots[i]->backend_pid == MyProcPid);
+
+                if (state == FGA_CHANNEL_SLOT_DONE || state == FGA_CHANNEL_SLOT_CANCELED)
+                    finished++;
+                if (state == FGA_CHANNEL_SLOT_CANCELED)
+                    canceled = true;
+            }
+            if (finished == count)
                 break;
 
             rc = WaitLatch(MyLatch, WL_LATCH_SET | WL_EXIT_ON_PM_DEATH, -1, PG_WAIT_EXTENSION);
@@ -79,25 +112,55 @@ static FgaChannelSlotState wait_response(FgaChannel* channel, FgaChannelSlot* sl
     }
     PG_CATCH();
     {
-        FgaChannelSlotState cur = (FgaChannelSlotState)pg_atomic_read_u32(&slot->state);
-
-        if (cur == FGA_CHANNEL_SLOT_PENDING || cur == FGA_CHANNEL_SLOT_PROCESSING)
-        {
-            /* 아직 BGW가 처리 중일 가능성이 있으니, CANCEL 표시만 한다 */
-            pg_atomic_write_u32(&slot->state, FGA_CHANNEL_SLOT_CANCELED);
-        }
-        else if (cur == FGA_CHANNEL_SLOT_DONE)
-        {
-            /* 이미 처리 완료된 상태였으면 여기서 정리해도 됨 */
-            fga_channel_release_slot(slot);
-        }
-        slot->backend_pid = InvalidPid;
-        /* freelist로는 아직 돌리지 않는다. BGW에서 처리 */
+        for (int i = 0; i < count; i++)
+            abandon_slot(slots[i]);
         PG_RE_THROW();
     }
     PG_END_TRY();
 
-    return state;
+    return !canceled;
+}
+
+/* 완료된 슬롯의 단계별 지연 시간을 히스토그램에 기록 */
+static void record_latency(const FgaChannelSlot* slot)
+{
+    const FgaChannelSlotTiming* t = &slot->timing;
+    uint16 type = slot->payload.request.type;
+    uint64 rpc_us = fga_elapsed_us(t->rpc_start_us, t->rpc_end_us);
+
+    fga_stats_record_latency(type, FGA_LATENCY_QUEUE, fga_elapsed_us(t->enqueue_us, t->drain_us));
+    fga_stats_record_latency(type, FGA_LATENCY_DISPATCH, fga_elapsed_us(t->drain_us, t->rpc_start_us));
+    fga_stats_record_latency(type, FGA_LATENCY_RPC, rpc_us);
+    fga_stats_record_latency(type, FGA_LATENCY_WAKEUP, fga_elapsed_us(t->rpc_end_us, t->wake_us));
+    fga_stats_record_latency(type, FGA_LATENCY_TOTAL, fga_elapsed_us(t->enqueue_us, t->wake_us));
+
+    if (type == FGA_REQUEST_CHECK)
+        fga_stats_rpc_check(rpc_us, slot->payload.response.status != FGA_RESPONSE_OK);
+}
+
+/* fga.trace_sample_rate 에 따라 request_id 기준으로 1/N 샘플링 */
+static void record_trace(const FgaChannelSlot* slot)
+{
+    int rate = fga_get_config()->trace_sample_rate;
+    const FgaChannelSlotTiming* t = &slot->timing;
+    FgaTraceRecord record;
+
+    if (rate <= 0 || slot->payload.request.request_id % (uint64)rate != 0)
+        return;
+
+    record.request_id = slot->payload.request.request_id;
+    record.backend_pid = slot->backend_pid;
+    record.request_type = slot->payload.request.type;
+    record.status = slot->payload.response.status;
+    record.acquire_us = t->acquire_us;
+    record.enqueue_us = t->enqueue_us;
+    record.drain_us = t->drain_us;
+    record.rpc_start_us = t->rpc_start_us;
+    record.rpc_end_us = t->rpc_end_us;
+    record.complete_us = t->complete_us;
+    record.wake_us = t->wake_us;
+
+    fga_stats_trace(&record);
 }
 
 /*-------------------------------------------------------------------------
@@ -106,13 +169,7 @@ static FgaChannelSlotState wait_response(FgaChannel* channel, FgaChannelSlot* sl
  */
 FgaChannelSlot* fga_channel_acquire_slot(void)
 {
-    FgaChannel* const channel = fga_get_channel();
-    FgaChannelSlot* slot;
-    
-
-    LWLockAcquire(channel->pool_lock, LW_EXCLUSIVE);
-    slot = acquire_slot(channel->pool);
-    LWLockRelease(channel->pool_lock);
+    FgaChannelSlot* slot = fga_channel_try_acquire_slot();
 
     if (slot == NULL)
     {
@@ -122,11 +179,29 @@ FgaChannelSlot* fga_channel_acquire_slot(void)
                  errhint("Increase postfga.max_slots or check for slot leaks")));
     }
 
+    return slot;
+}
+
+FgaChannelSlot* fga_channel_try_acquire_slot(void)
+{
+    FgaChannel* const channel = fga_get_channel();
+    FgaChannelSlot* slot;
+
+    LWLockAcquire(channel->pool_lock, LW_EXCLUSIVE);
+    slot = acquire_slot(channel->pool);
+    LWLockRelease(channel->pool_lock);
+
+    if (slot == NULL)
+        return NULL;
+
     slot->backend_pid = MyProcPid;
 
     // Reset payload
+    MemSet(&slot->timing, 0, sizeof(slot->timing));
     MemSet(&slot->payload, 0, sizeof(slot->payload));
 
+    slot->timing.acquire_us = fga_clock_us();
+
     slot->payload.request.request_id = pg_atomic_add_fetch_u64(&channel->request_id, 1);
 
     return slot;
@@ -135,15 +210,58 @@ FgaChannelSlot* fga_channel_acquire_slot(void)
 void fga_channel_release_slot(FgaChannelSlot* slot)
 {
     FgaChannel* const channel = fga_get_channel();
+    FgaRequest* request = &slot->payload.request;
+
     LWLockAcquire(channel->pool_lock, LW_EXCLUSIVE);
+    if (request->arena_len > 0)
+    {
+        channel->arena->free[channel->arena->free_count++] = request->arena_block;
+        request->arena_len = 0;
+    }
     release_slot(channel->pool, slot);
     LWLockRelease(channel->pool_lock);
 }
 
+char* fga_channel_arena_alloc(FgaChannelSlot* slot, uint32 len)
+{
+    FgaChannel* const channel = fga_get_channel();
+    FgaChannelArena* arena = channel->arena;
+    FgaRequest* request = &slot->payload.request;
+
+    Assert(request->arena_len == 0);
+
+    if (len == 0 || len > FGA_CHANNEL_ARENA_BLOCK_SIZE)
+        return NULL;
+
+    LWLockAcquire(channel->pool_lock, LW_EXCLUSIVE);
+    if (arena->free_count == 0)
+    {
+        LWLockRelease(channel->pool_lock);
+        return NULL;
+    }
+    request->arena_block = arena->free[--arena->free_count];
+    request->arena_len = len;
+    LWLockRelease(channel->pool_lock);
+
+    return arena->blocks + (Size)request->arena_block * FGA_CHANNEL_ARENA_BLOCK_SIZE;
+}
+
+const char* fga_channel_arena_data(const FgaRequest* request)
+{
+    FgaChannelArena* arena = fga_get_channel()->arena;
+
+    if (request->arena_len == 0)
+        return NULL;
+
+    Assert(request->arena_block < arena->block_count);
+    return arena->blocks + (Size)request->arena_block * FGA_CHANNEL_ARENA_BLOCK_SIZE;
+}
+
 uint32 fga_channel_drain_slots(uint32 max_count, FgaChannelSlot** out_slots)
 {
     uint32 count;
     uint32 buf[FGA_CHANNEL_DRAIN_MAX];
+    uint64 now;
     FgaChannel* const channel = fga_get_channel();
 
     /* 요청이 너무 크면 상한으로 잘라버림 */
@@ -154,47 +272,91 @@ uint32 fga_channel_drain_slots(uint32 max_count, FgaChannelSlot** out_slots)
     count = queue_drain(channel->queue, max_count, buf);
     LWLockRelease(channel->queue_lock);
 
+    now = count > 0 ? fga_clock_us() : 0;
     for (uint32 i = 0; i < count; ++i)
     {
         out_slots[i] = &channel->pool->slots[buf[i]];
+        out_slots[i]->timing.drain_us = now;
     }
 
     return count;
 }
 
-void fga_channel_execute_slot(FgaChannelSlot* slot)
+uint32 fga_channel_slot_count(void)
+{
+    return fga_get_channel()->pool->size;
+}
+
+FgaChannelSlotIndex fga_channel_slot_index(const FgaChannelSlot* slot)
 {
     FgaChannel* const channel = fga_get_channel();
     FgaChannelSlotIndex index = (slot - channel->pool->slots);
-    FgaChannelSlotState slot_state;
-    
+
     Assert(index < channel->pool->size);
+    return index;
+}
 
+void fga_channel_execute_slot(FgaChannelSlot* slot)
+{
+    fga_channel_execute_slots(&slot, 1);
+}
+
+void fga_channel_execute_slots(FgaChannelSlot** slots, int count)
+{
+    FgaChannel* const channel = fga_get_channel();
+    int enqueued;
+    uint64 now;
+
+    Assert(count > 0);
+
+    /* 한 번에 큐에 넣고 BGW 를 한 번만 깨운다 (BGW 는 꺼낸 check 들을 BatchCheck 로 묶는다) */
     LWLockAcquire(channel->queue_lock, LW_EXCLUSIVE);
-    if (!queue_enqueue(channel->queue, index))
+    now = fga_clock_us();
+    for (enqueued = 0; enqueued < count; enqueued++)
     {
-        /* 롤백 처리 */
-        LWLockRelease(channel->queue_lock);
-        fga_channel_release_slot(slot);
-        ereport(ERROR, errmsg("postfga: failed to enqueue channel slot"));
+        slots[enqueued]->timing.enqueue_us = now;
+        if (!queue_enqueue(channel->queue, fga_channel_slot_index(slots[enqueued])))
+            break;
     }
     LWLockRelease(channel->queue_lock);
 
+    if (enqueued < count)
+    {
+        /* 롤백 처리: 이미 넣은 슬롯은 BGW 가, 못 넣은 슬롯은 여기서 반환 */
+        for (int i = 0; i < count; i++)
+        {
+            if (i < enqueued)
+                abandon_slot(slots[i]);
+            else
+                fga_channel_release_slot(slots[i]);
+        }
+        if (enqueued > 0)
+            fga_wake_bgw();
+        ereport(ERROR, errmsg("postfga: failed to enqueue channel slot"));
+    }
+
     /* BGW 깨우기 */
     fga_wake_bgw();
 
-    slot_state = wait_response(channel, slot);
-
-    if (slot_state == FGA_CHANNEL_SLOT_CANCELED)
+    if (!wait_responses(channel, slots, count))
     {
         /* 여기까지 왔으면 논리적으로는 이미 위에서 ERROR가 났을 확률이 높지만,
          * 방어 코드로 이렇게 한 번 더 정리해줄 수 있음.
          */
-        fga_channel_release_slot(slot);
+        for (int i = 0; i < count; i++)
+            fga_channel_release_slot(slots[i]);
         ereport(ERROR, errmsg("postfga: request was canceled"));
     }
 
     pg_read_barrier();
+
+    now = fga_clock_us();
+    for (int i = 0; i < count; i++)
+    {
+        slots[i]->timing.wake_us = now;
+        record_latency(slots[i]);
+        record_trace(slots[i]);
+    }
 }
 
 // void fga_channel_execute(const FgaRequest* request, FgaResponse* response)
@@ -230,6 +392,31 @@ void fga_channel_execute_slot(FgaChannelSlot* slot)
 //     fga_channel_release_slot(channel, slot);
 // }
 
+bool fga_channel_submit_slot(FgaChannelSlot* slot)
+{
+    FgaChannel* const channel = fga_get_channel();
+    FgaChannelSlotIndex index = (slot - channel->pool->slots);
+
+    Assert(index < channel->pool->size);
+
+    /* 깨울 백엔드 없음 */
+    slot->payload.request.flags |= FGA_REQUEST_FLAG_DETACHED;
+    slot->backend_pid = InvalidPid;
+
+    LWLockAcquire(channel->queue_lock, LW_EXCLUSIVE);
+    slot->timing.enqueue_us = fga_clock_us();
+    if (!queue_enqueue(channel->queue, index))
+    {
+        LWLockRelease(channel->queue_lock);
+        fga_channel_release_slot(slot);
+        return false;
+    }
+    LWLockRelease(channel->queue_lock);
+
+    fga_wake_bgw();
+    return true;
+}
+
 bool fga_channel_wake_backend(const FgaChannelSlot* slot)
 {
     PGPROC* proc = BackendPidGetProc(slot->backend_pid);
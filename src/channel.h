@@ -17,6 +17,9 @@ extern "C"
 
 #define FGA_CHANNEL_DRAIN_MAX 64
 
+/* arena 블록 하나의 크기 (요청 하나의 가변 길이 데이터 상한) */
+#define FGA_CHANNEL_ARENA_BLOCK_SIZE 8192
+
 #ifdef __cplusplus
 }
 #endif
@@ -32,16 +35,30 @@ typedef enum FgaChannelSlotState
     FGA_CHANNEL_SLOT_DONE
 } FgaChannelSlotState;
 
+/* 단계별 시각 (fga_clock_us, 0 = 미기록) */
+typedef struct FgaChannelSlotTiming
+{
+    uint64 acquire_us;   /* 백엔드: 슬롯 확보 */
+    uint64 enqueue_us;   /* 백엔드: queue_lock 획득 후 큐에 넣은 시각 */
+    uint64 drain_us;     /* BGW: 큐에서 꺼낸 시각 */
+    uint64 rpc_start_us; /* BGW: client 에 넘긴 시각 */
+    uint64 rpc_end_us;   /* gRPC 스레드: 응답 수신 시각 */
+    uint64 complete_us;  /* BGW: 완료 스택에서 꺼내 DONE 으로 바꾼 시각 */
+    uint64 wake_us;      /* 백엔드: latch 에서 깨어나 응답을 확인한 시각 */
+} FgaChannelSlotTiming;
+
 typedef struct FgaChannelSlot
 {
-    slist_node node;        /* 내부 연결 리스트 용도 */
-    pg_atomic_uint32 state; /* FgaChannelSlotState */
-    pid_t backend_pid;      /* 요청한 백엔드 PID */
-    FgaPayload payload;     /* 요청 내용 */
+    slist_node node;             /* 내부 연결 리스트 용도 */
+    pg_atomic_uint32 state;      /* FgaChannelSlotState */
+    pid_t backend_pid;           /* 요청한 백엔드 PID */
+    FgaChannelSlotTiming timing; /* 지연 시간 측정용 */
+    FgaPayload payload;          /* 요청 내용 */
 } FgaChannelSlot;
 
 typedef struct FgaChannelSlotPool
 {
+    uint32 size; /* number of slots[] */
     slist_head head;
     FgaChannelSlot slots[FLEXIBLE_ARRAY_MEMBER];
 } FgaChannelSlotPool;
@@ -54,6 +71,17 @@ typedef struct FgaChannelSlotQueue
     FgaChannelSlotIndex values[FLEXIBLE_ARRAY_MEMBER]; /* [capacity = mask + 1] */
 } FgaChannelSlotQueue;
 
+/*
+ * 슬롯에 고정 크기로 넣을 수 없는 요청 데이터 (check context JSON) 용 블록.
+ * 슬롯 하나가 블록 하나를 빌리고 슬롯을 반환할 때 같이 돌려준다. pool_lock 으로 보호.
+ */
+typedef struct FgaChannelArena
+{
+    uint32 block_count;
+    uint32 free_count;                  /* free[0..free_count) 가 빈 블록 번호 */
+    char* blocks;                       /* [block_count * FGA_CHANNEL_ARENA_BLOCK_SIZE] */
+    uint32 free[FLEXIBLE_ARRAY_MEMBER]; /* [block_count] */
+} FgaChannelArena;
 
 typedef struct FgaChannel
 {
@@ -62,6 +90,7 @@ typedef struct FgaChannel
     pg_atomic_uint64 request_id; /* Request identifier */
     FgaChannelSlotPool* pool;
     FgaChannelSlotQueue* queue;
+    FgaChannelArena* arena;
 } FgaChannel;
 
 #ifdef __cplusplus
@@ -70,12 +99,41 @@ extern "C"
 #endif
     uint32 fga_channel_drain_slots(uint32 max_count, FgaChannelSlot** out_slots);
 
+    uint32 fga_channel_slot_count(void);
+
+    FgaChannelSlotIndex fga_channel_slot_index(const FgaChannelSlot* slot);
+
     FgaChannelSlot* fga_channel_acquire_slot(void);
 
+    /* 빈 슬롯이 없으면 ERROR 대신 NULL (best-effort 요청용) */
+    FgaChannelSlot* fga_channel_try_acquire_slot(void);
+
     void fga_channel_release_slot(FgaChannelSlot* slot);
 
+    /*
+     * 슬롯에 arena 블록을 붙이고 len 바이트를 쓸 주소를 반환한다 (request.arena_len = len).
+     * len 이 FGA_CHANNEL_ARENA_BLOCK_SIZE 를 넘거나 빈 블록이 없으면 NULL.
+     * 블록은 fga_channel_release_slot 이 함께 반환한다.
+     */
+    char* fga_channel_arena_alloc(FgaChannelSlot* slot, uint32 len);
+
+    /* request 에 붙은 arena 데이터 (arena_len 바이트, 없으면 NULL) */
+    const char* fga_channel_arena_data(const FgaRequest* request);
+
     void fga_channel_execute_slot(FgaChannelSlot* slot);
 
+    /*
+     * 여러 슬롯을 한 번에 큐에 넣고 모두 끝날 때까지 기다린다.
+     * BGW 가 한 번에 꺼내므로 CHECK 요청들은 BatchCheck 하나로 나간다.
+     */
+    void fga_channel_execute_slots(FgaChannelSlot** slots, int count);
+
+    /*
+     * 응답을 기다리지 않고 큐에 넣는다 (FGA_REQUEST_FLAG_DETACHED).
+     * 이후 슬롯은 BGW 소유: 결과 처리와 반환을 BGW 가 한다. 큐가 가득 차면 슬롯을 반환하고 false.
+     */
+    bool fga_channel_submit_slot(FgaChannelSlot* slot);
+
     void fga_channel_execute(const FgaRequest* request, FgaResponse* response);
 
     bool fga_channel_wake_backend(const FgaChannelSlot* slot);
@@ -37,6 +37,21 @@ static Size queue_shmem_size(uint32 capacity)
     return size;
 }
 
+static Size arena_shmem_size(uint32 block_count)
+{
+    Size size = offsetof(FgaChannelArena, free);
+    size = add_size(size, mul_size(sizeof(uint32), block_count));
+    return size;
+}
+
+/* fga.channel_arena_size (kB) 를 블록 수로 */
+static uint32 compute_arena_blocks(void)
+{
+    FgaConfig* cfg = fga_get_config();
+
+    return (uint32)(((Size)cfg->channel_arena_size * 1024) / FGA_CHANNEL_ARENA_BLOCK_SIZE);
+}
+
 static int compute_slot_size(void)
 {
     const char* max_conn_str;
@@ -60,6 +75,7 @@ Size fga_channel_shmem_size(void)
 {
     uint32 slot_count = compute_slot_size();
     uint32 queue_capacity = pow2_ceil(slot_count);
+    uint32 arena_blocks = compute_arena_blocks();
     Size size = 0;
 
     // channel struct itself
@@ -71,6 +87,10 @@ Size fga_channel_shmem_size(void)
     // queue
     size = add_size(size, MAXALIGN(queue_shmem_size(queue_capacity)));
 
+    // arena
+    size = add_size(size, MAXALIGN(arena_shmem_size(arena_blocks)));
+    size = add_size(size, mul_size(FGA_CHANNEL_ARENA_BLOCK_SIZE, arena_blocks));
+
     return size;
 }
 
@@ -78,9 +98,12 @@ void fga_channel_shmem_init(FgaChannel* ch, LWLock* pool_lock, LWLock* queue_loc
 {
     FgaChannelSlotPool* pool;
     FgaChannelSlotQueue* queue;
+    FgaChannelArena* arena;
+    char* arena_data;
 
     uint32 slot_count = compute_slot_size();
     uint32 queue_capacity = pow2_ceil(slot_count);
+    uint32 arena_blocks = compute_arena_blocks();
 
     ch->pool_lock = pool_lock;
     ch->queue_lock = queue_lock;
@@ -96,12 +119,20 @@ void fga_channel_shmem_init(FgaChannel* ch, LWLock* pool_lock, LWLock* queue_loc
     queue = (FgaChannelSlotQueue*)ptr;
     ptr += MAXALIGN(queue_shmem_size(queue_capacity));
 
+    // arena
+    arena = (FgaChannelArena*)ptr;
+    ptr += MAXALIGN(arena_shmem_size(arena_blocks));
+    arena_data = ptr;
+    ptr += (Size)FGA_CHANNEL_ARENA_BLOCK_SIZE * arena_blocks;
+
     ch->pool = pool;
     ch->queue = queue;
+    ch->arena = arena;
 
     pg_atomic_init_u64(&ch->request_id, 0);
     pool_init(ch->pool, slot_count);
     queue_init(ch->queue, queue_capacity);
+    arena_init(ch->arena, arena_blocks, arena_data);
 
     if (unlikely(ptr != (char*)ch + MAXALIGN(fga_channel_shmem_size())))
     {
@@ -113,7 +144,11 @@ void fga_channel_shmem_init(FgaChannel* ch, LWLock* pool_lock, LWLock* queue_loc
         ereport(LOG,
                 errcode(ERRCODE_SUCCESSFUL_COMPLETION),
                 errmsg("postfga: channel initialized"),
-                errdetail("slot_count=%u, queue_capacity=%u, total_size=%zu", slot_count, queue_capacity, size));
+                errdetail("slot_count=%u, queue_capacity=%u, arena_blocks=%u, total_size=%zu",
+                          slot_count,
+                          queue_capacity,
+                          arena_blocks,
+                          size));
 
         ereport(LOG, errmsg("sizeof(FgaTuple) = %zu", sizeof(FgaTuple)));
         ereport(LOG, errmsg("sizeof(FgaRequest) = %zu", sizeof(FgaRequest)));
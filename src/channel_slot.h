@@ -19,6 +19,7 @@ extern "C"
     {
         uint32 i;
 
+        pool->size = max_slots;
         slist_init(&pool->head);
 
         for (i = 0; i < max_slots; i++)
@@ -33,6 +34,16 @@ extern "C"
         }
     }
 
+    static void arena_init(FgaChannelArena* arena, uint32 block_count, char* blocks)
+    {
+        arena->block_count = block_count;
+        arena->free_count = block_count;
+        arena->blocks = blocks;
+
+        for (uint32 i = 0; i < block_count; i++)
+            arena->free[i] = block_count - 1 - i;
+    }
+
     /*
      * queue_init
      *
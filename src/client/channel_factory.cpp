@@ -3,9 +3,14 @@
 namespace fga::client
 {
 
-    std::shared_ptr<::grpc::Channel> make_channel(const fga::Config& cfg)
+    std::shared_ptr<::grpc::Channel> make_channel(const fga::Config& cfg, int index)
     {
         grpc::ChannelArguments args;
+
+        // 채널마다 subchannel 을 공유하지 않도록 별도 pool + 고유 arg 부여
+        args.SetInt(GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL, 1);
+        args.SetInt("postfga.channel_index", index);
+
         if (!cfg.channel.load_balancing_policy.empty())
         {
             args.SetLoadBalancingPolicyName(cfg.channel.load_balancing_policy);
@@ -8,6 +8,9 @@
 namespace fga::client
 {
 
-    std::shared_ptr<::grpc::Channel> make_channel(const fga::Config& cfg);
+    /*
+     * index 는 channel args 에 실려 채널마다 서로 다른 subchannel(=TCP 연결)을 갖게 한다.
+     */
+    std::shared_ptr<::grpc::Channel> make_channel(const fga::Config& cfg, int index = 0);
 
 } // namespace fga::client
@@ -1,9 +1,15 @@
 // openfga.hpp
 #pragma once
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <span>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "config/config.hpp"
 
@@ -11,15 +17,89 @@ struct FgaPayload;
 
 namespace fga::client
 {
+    /**
+     * @brief 요청 완료 통지용 intrusive hook.
+     *
+     * 호출자(BGW)가 슬롯마다 하나씩 미리 만들어 두고 재사용한다.
+     * Client 는 payload.response 를 채운 뒤 gRPC 스레드에서 done() 을 정확히 한 번 호출한다.
+     * 힙 할당/타입 소거 콜백이 없으므로 hot path 에서 복사/이동 비용이 없다.
+     */
+    class Completion
+    {
+      public:
+        Completion() noexcept = default;
+        Completion(const Completion&) = delete;
+        Completion& operator=(const Completion&) = delete;
+
+        FgaPayload& payload() const noexcept { return *payload_; }
+
+        /* check 의 context/contextual_tuples (CheckRequest 의 JSON 표현 일부, 채널 arena 에 있음). 없으면 빈 값 */
+        std::string_view check_context() const noexcept { return check_context_; }
 
-    using ProcessCallback = std::function<void()>;
+        void bind(FgaPayload* payload, std::string_view check_context = {}) noexcept
+        {
+            payload_ = payload;
+            check_context_ = check_context;
+        }
 
-    struct ProcessItem
+        /* gRPC 스레드에서 호출됨: PostgreSQL 함수 호출 금지 */
+        virtual void done() noexcept = 0;
+
+      protected:
+        ~Completion() = default;
+
+      private:
+        FgaPayload* payload_ = nullptr;
+        std::string_view check_context_;
+    };
+
+    /* 채널(연결) 하나의 누적 통계 스냅샷 */
+    struct ChannelStats
+    {
+        uint32_t inflight = 0;
+        uint64_t calls = 0;
+        uint64_t errors = 0;
+        int state = 0; /* grpc_connectivity_state */
+    };
+
+    /* ReadChanges 로 관측한 tuple 변경 하나 */
+    struct ChangedTuple
     {
-        FgaPayload* payload;
-        ProcessCallback callback;
+        std::string object; /* "type:id" */
+        std::string user;   /* "type:id" 또는 "type:id#relation" */
     };
 
+    struct ReadChangesQuery
+    {
+        std::string store_id;
+        std::string continuation_token; /* 비어 있으면 start_time 부터 읽는다 */
+        /*
+         * token 이 없을 때 읽기 시작할 시각. 빈 페이지는 token 을 돌려주지 않으므로
+         * 호출할 때마다 now() 를 쓰면 그 사이 변경을 놓친다: 처음 정한 값을 token 을 받을 때까지 그대로 넘긴다.
+         */
+        std::chrono::system_clock::time_point start_time;
+        int page_size = 100;
+    };
+
+    struct ReadChangesResult
+    {
+        bool ok = false;
+        bool invalid_token = false; /* token 이 거부됨: 처음부터 다시 시작해야 함 */
+        std::string error_message;
+        std::vector<ChangedTuple> changes;
+        std::string continuation_token;
+    };
+
+    /* FGA_REQUEST_CHECK_RELATIONS 로 함께 물을 relation 하나 (bit = 레지스트리 비트 번호) */
+    struct RelationName
+    {
+        uint8_t bit;
+        std::string name;
+    };
+
+    /* gRPC 스레드에서 호출됨: PostgreSQL 함수 호출 금지 */
+    using ReadChangesCallback = std::function<void(ReadChangesResult&&)>;
+
     class Client
     {
       public:
@@ -27,8 +107,26 @@ namespace fga::client
 
         virtual bool is_healthy() const = 0;
 
-        virtual void process(FgaPayload& payload, ProcessCallback cb) = 0;
-        virtual void process_batch(std::span<ProcessItem> items) = 0;
+        virtual void process(Completion& completion) = 0;
+        virtual void process_batch(std::span<Completion*> items) = 0;
+
+        /*
+         * FGA_REQUEST_CHECK_RELATIONS: 같은 (object, subject) 의 relation 들을 BatchCheck 하나로.
+         * relation 이름은 공유 메모리 레지스트리에 있으므로 BGW 가 찾아서 넘긴다.
+         */
+        virtual void check_relations(Completion& completion, std::vector<RelationName> relations) = 0;
+
+        /*
+         * FGA_REQUEST_LIST: StreamedListObjects 를 끝까지 읽어 objects 에 object id ("type:" 제외) 를 모은다.
+         * 결과는 슬롯에 담기지 않으므로 BGW 가 슬롯마다 둔 objects 를 done() 이후에 list cache 로 옮긴다.
+         */
+        virtual void list_objects(Completion& completion, std::vector<std::string>& objects) = 0;
+
+        /* 백엔드 슬롯을 거치지 않는 BGW 내부 요청 (캐시 무효화 feed) */
+        virtual void read_changes(const ReadChangesQuery& query, ReadChangesCallback done) = 0;
+
+        /* 채널별 통계를 out 에 채우고 채운 개수를 반환 */
+        virtual std::size_t channel_stats(std::span<ChannelStats> out) const = 0;
 
         virtual void shutdown() = 0;
     };
@@ -10,15 +10,90 @@
 namespace fga::client
 {
 
+    namespace
+    {
+        bool is_channel_state_healthy(grpc_connectivity_state state)
+        {
+            switch (state)
+            {
+            case GRPC_CHANNEL_READY:
+                return true;
+
+            case GRPC_CHANNEL_IDLE:
+            case GRPC_CHANNEL_CONNECTING:
+                // 상황에 따라 true/false 선택 (여기선 "아직 완전 실패는 아님"으로 취급)
+                return true;
+
+            case GRPC_CHANNEL_TRANSIENT_FAILURE:
+            case GRPC_CHANNEL_SHUTDOWN:
+            default:
+                return false;
+            }
+        }
+
+        /*
+         * BatchCheck 는 consistency/deadline 이 요청 단위이므로 기본값과 다른 check 는 따로 보낸다.
+         * contextual tuple 이 있는 check (read-your-writes) 도 드물므로 묶지 않는다.
+         */
+        bool batchable_check(const FgaRequest& request)
+        {
+            return (request.flags & FGA_REQUEST_FLAG_HIGHER_CONSISTENCY) == 0 && request.timeout_ms == 0 &&
+                   request.body.checkTuple.contextual.count == 0 && request.arena_len == 0;
+        }
+    } // anonymous namespace
+
+    /* ========================================================================
+     * PooledChannel
+     * ====================================================================== */
+    PooledChannel::PooledChannel(const fga::Config& config, int index)
+        : channel_(make_channel(config, index)),
+          stub_(openfga::v1::OpenFGAService::NewStub(channel_))
+    {
+    }
+
+    void PooledChannel::begin() noexcept
+    {
+        inflight_.fetch_add(1, std::memory_order_relaxed);
+        calls_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void PooledChannel::end(bool ok) noexcept
+    {
+        inflight_.fetch_sub(1, std::memory_order_relaxed);
+        if (!ok)
+            errors_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool PooledChannel::is_healthy() const
+    {
+        // true 를 넣으면, 필요 시 CONNECTING으로 전환을 트리거할 수 있음
+        return is_channel_state_healthy(channel_->GetState(false /* try_to_connect */));
+    }
+
+    ChannelStats PooledChannel::stats() const
+    {
+        ChannelStats stats;
+        stats.inflight = inflight_.load(std::memory_order_relaxed);
+        stats.calls = calls_.load(std::memory_order_relaxed);
+        stats.errors = errors_.load(std::memory_order_relaxed);
+        stats.state = static_cast<int>(channel_->GetState(false));
+        return stats;
+    }
+
     /* ========================================================================
      * ctor / dtor
      * ====================================================================== */
     OpenFgaGrpcClient::OpenFgaGrpcClient(const fga::Config& config)
         : config_(config),
-          channel_(make_channel(config_)),
-          stub_(openfga::v1::OpenFGAService::NewStub(channel_)),
           inflight_(1000) // 기본값, 필요시 설정 가능
     {
+        const int pool_size = std::max(1, config_.channel.pool_size);
+
+        channels_.reserve(pool_size);
+        for (int i = 0; i < pool_size; ++i)
+        {
+            channels_.push_back(std::make_unique<PooledChannel>(config_, i));
+        }
     }
 
     OpenFgaGrpcClient::~OpenFgaGrpcClient()
@@ -31,43 +106,62 @@ namespace fga::client
      * ====================================================================== */
     bool OpenFgaGrpcClient::is_healthy() const
     {
-        if (!channel_ || stopping_.load(std::memory_order_acquire))
+        if (stopping_.load(std::memory_order_acquire))
         {
             return false;
         }
 
-        // 채널 상태를 보고 대략적인 health 판단
-        // true 를 넣으면, 필요 시 CONNECTING으로 전환을 트리거할 수 있음
-        auto state = channel_->GetState(false /* try_to_connect */);
-        switch (state)
+        // 채널 하나라도 살아 있으면 요청을 보낼 수 있음
+        return std::any_of(channels_.begin(), channels_.end(), [](const auto& ch) { return ch->is_healthy(); });
+        // auto deadline = std::chrono::system_clock::now() +
+        //                 std::chrono::milliseconds(config_.timeout_ms);
+        // return channel_->WaitForConnected(deadline);
+    }
+
+    std::size_t OpenFgaGrpcClient::channel_stats(std::span<ChannelStats> out) const
+    {
+        const std::size_t count = std::min(out.size(), channels_.size());
+        for (std::size_t i = 0; i < count; ++i)
         {
-        case GRPC_CHANNEL_READY:
-            return true;
+            out[i] = channels_[i]->stats();
+        }
+        return count;
+    }
 
-        case GRPC_CHANNEL_IDLE:
-        case GRPC_CHANNEL_CONNECTING:
-            // 상황에 따라 true/false 선택 (여기선 "아직 완전 실패는 아님"으로 취급)
-            return true;
+    /*
+     * in-flight RPC 가 가장 적은 채널 선택.
+     * 모두 같으면 시작 위치를 돌려가며 골고루 분산되도록 한다.
+     */
+    PooledChannel& OpenFgaGrpcClient::acquire_channel() noexcept
+    {
+        const std::size_t size = channels_.size();
+        if (size == 1)
+            return *channels_.front();
 
-        case GRPC_CHANNEL_TRANSIENT_FAILURE:
-        case GRPC_CHANNEL_SHUTDOWN:
-        default:
-            return false;
+        const std::size_t start = next_channel_.fetch_add(1, std::memory_order_relaxed) % size;
+        PooledChannel* best = channels_[start].get();
+        uint32_t best_load = best->inflight();
+
+        for (std::size_t i = 1; i < size && best_load > 0; ++i)
+        {
+            PooledChannel* candidate = channels_[(start + i) % size].get();
+            uint32_t load = candidate->inflight();
+            if (load < best_load)
+            {
+                best = candidate;
+                best_load = load;
+            }
         }
-        // auto deadline = std::chrono::system_clock::now() +
-        //                 std::chrono::milliseconds(config_.timeout_ms);
-        // return channel_->WaitForConnected(deadline);
+        return *best;
     }
 
-    void OpenFgaGrpcClient::process(FgaPayload& payload, ProcessCallback cb)
+    void OpenFgaGrpcClient::process(Completion& completion)
     {
-        auto variant = make_request_variant(payload);
-        std::visit([this, callback = std::move(cb)](auto& arg) mutable
-                   { this->handle_request(arg, std::move(callback)); },
-                   variant);
+        auto variant = make_request_variant(completion.payload());
+        std::visit([this, &completion](auto& arg) { this->handle_request(arg, completion); }, variant);
     }
 
-    void OpenFgaGrpcClient::process_batch(std::span<ProcessItem> items)
+    void OpenFgaGrpcClient::process_batch(std::span<Completion*> items)
     {
         // if (stopping_.load(std::memory_order_relaxed))
         // {
@@ -94,33 +188,48 @@ namespace fga::client
 
         if (size == 1)
         {
-            auto& item = items.front();
-            auto variant = make_request_variant(*item.payload);
-            std::visit([this, callback = std::move(item.callback)](auto& arg) mutable
-                       { this->handle_request(arg, std::move(callback)); },
-                       variant);
+            process(*items.front());
             return;
         }
 
         std::vector<BatchCheckItem> batch_check_items;
+        std::vector<WriteBatchItem> write_items;
         batch_check_items.reserve(items.size());
 
-        for (auto& item : items)
+        for (Completion* completion : items)
         {
-            auto variant = make_request_variant(*item.payload);
-            if (std::holds_alternative<CheckTuple>(variant))
+            auto variant = make_request_variant(completion->payload());
+            auto* params = std::get_if<CheckTuple>(&variant);
+            if (params != nullptr && !batchable_check(completion->payload().request))
+            {
+                handle_request(*params, *completion);
+            }
+            else if (params != nullptr)
             {
-                auto& params = std::get<CheckTuple>(variant);
                 batch_check_items.push_back(BatchCheckItem{
-                    .params = params,
-                    .callback = std::move(item.callback),
+                    .params = *params,
+                    .completion = completion,
+                });
+            }
+            else if (auto* write = std::get_if<WriteTuple>(&variant))
+            {
+                write_items.push_back(WriteBatchItem{
+                    .tuple = &write->request().tuple,
+                    .is_delete = false,
+                    .completion = completion,
+                });
+            }
+            else if (auto* del = std::get_if<DeleteTuple>(&variant))
+            {
+                write_items.push_back(WriteBatchItem{
+                    .tuple = &del->request().tuple,
+                    .is_delete = true,
+                    .completion = completion,
                 });
             }
             else
             {
-                std::visit([this, callback = std::move(item.callback)](auto& arg) mutable
-                           { this->handle_request(arg, callback); },
-                           variant);
+                std::visit([this, completion](auto& arg) { this->handle_request(arg, *completion); }, variant);
             }
         }
 
@@ -128,6 +237,11 @@ namespace fga::client
         {
             handle_check_batch(std::move(batch_check_items));
         }
+
+        if (!write_items.empty())
+        {
+            handle_write_batch(std::move(write_items));
+        }
     }
 
     void OpenFgaGrpcClient::shutdown()
@@ -146,6 +260,19 @@ namespace fga::client
         // pool_.join();
     }
 
-    void OpenFgaGrpcClient::handle_request(GetStore& req, ProcessCallback cb) {}
-    void OpenFgaGrpcClient::handle_request(InvalidRequest& req, ProcessCallback cb) {}
+    void OpenFgaGrpcClient::handle_request(GetStore& req, Completion& completion)
+    {
+        FgaResponse& res = req.response();
+        res.status = FGA_RESPONSE_CLIENT_ERROR;
+        strlcpy(res.error_message, "get store is not supported", sizeof(res.error_message));
+        completion.done();
+    }
+
+    void OpenFgaGrpcClient::handle_request(InvalidRequest& req, Completion& completion)
+    {
+        FgaResponse& res = req.payload.response;
+        res.status = FGA_RESPONSE_CLIENT_ERROR;
+        strlcpy(res.error_message, "invalid request type", sizeof(res.error_message));
+        completion.done();
+    }
 } // namespace fga::client
@@ -3,11 +3,11 @@
 
 #include <atomic>
 #include <chrono>
-#include <functional>
 #include <limits>
 #include <memory>
 #include <semaphore>
 #include <string>
+#include <vector>
 
 // gRPC / OpenFGA proto
 #include <grpcpp/grpcpp.h>
@@ -23,7 +23,41 @@ namespace fga::client
     struct BatchCheckItem
     {
         CheckTuple params;
-        ProcessCallback callback;
+        Completion* completion;
+    };
+
+    struct WriteBatchItem
+    {
+        const FgaTuple* tuple;
+        bool is_delete;
+        Completion* completion;
+    };
+
+    /**
+     * @brief 독립된 HTTP/2 연결을 갖는 채널 하나와 그 채널의 in-flight 카운터.
+     *
+     * begin()/end() 는 gRPC 스레드에서도 호출되므로 std::atomic 만 사용한다.
+     */
+    class PooledChannel
+    {
+      public:
+        PooledChannel(const fga::Config& config, int index);
+
+        openfga::v1::OpenFGAService::Stub* stub() const noexcept { return stub_.get(); }
+        uint32_t inflight() const noexcept { return inflight_.load(std::memory_order_relaxed); }
+
+        void begin() noexcept;
+        void end(bool ok) noexcept;
+
+        bool is_healthy() const;
+        ChannelStats stats() const;
+
+      private:
+        std::shared_ptr<::grpc::Channel> channel_;
+        std::unique_ptr<openfga::v1::OpenFGAService::Stub> stub_;
+        std::atomic<uint32_t> inflight_{0};
+        std::atomic<uint64_t> calls_{0};
+        std::atomic<uint64_t> errors_{0};
     };
 
     class OpenFgaGrpcClient : public Client, public std::enable_shared_from_this<OpenFgaGrpcClient>
@@ -34,24 +68,39 @@ namespace fga::client
 
         bool is_healthy() const;
 
-        void process(FgaPayload& payload, ProcessCallback cb) override;
-        void process_batch(std::span<ProcessItem> items) override;
+        void process(Completion& completion) override;
+        void process_batch(std::span<Completion*> items) override;
+        void check_relations(Completion& completion, std::vector<RelationName> relations) override;
+        void list_objects(Completion& completion, std::vector<std::string>& objects) override;
+
+        void read_changes(const ReadChangesQuery& query, ReadChangesCallback done) override;
+
+        std::size_t channel_stats(std::span<ChannelStats> out) const override;
 
         void shutdown() override;
 
       private:
+        PooledChannel& acquire_channel() noexcept;
+
+        /* 요청의 timeout_ms (options), 없으면 설정값 */
+        std::chrono::milliseconds timeout_for(const FgaRequest& request) const noexcept
+        {
+            return request.timeout_ms > 0 ? std::chrono::milliseconds(request.timeout_ms) : config_.timeout;
+        }
+
         void handle_check_batch(std::vector<BatchCheckItem> items);
-        void handle_request(CheckTuple& req, ProcessCallback cb);
-        void handle_request(WriteTuple& req, ProcessCallback cb);
-        void handle_request(DeleteTuple& req, ProcessCallback cb);
-        void handle_request(GetStore& req, ProcessCallback cb);
-        void handle_request(CreateStore& req, ProcessCallback cb);
-        void handle_request(DeleteStore& req, ProcessCallback cb);
-        void handle_request(InvalidRequest& req, ProcessCallback cb);
+        void handle_write_batch(std::vector<WriteBatchItem> items);
+        void handle_request(CheckTuple& req, Completion& completion);
+        void handle_request(WriteTuple& req, Completion& completion);
+        void handle_request(DeleteTuple& req, Completion& completion);
+        void handle_request(GetStore& req, Completion& completion);
+        void handle_request(CreateStore& req, Completion& completion);
+        void handle_request(DeleteStore& req, Completion& completion);
+        void handle_request(InvalidRequest& req, Completion& completion);
 
         fga::Config config_;
-        std::shared_ptr<::grpc::Channel> channel_;
-        std::unique_ptr<openfga::v1::OpenFGAService::Stub> stub_;
+        std::vector<std::unique_ptr<PooledChannel>> channels_;
+        std::atomic<uint32_t> next_channel_{0};
         mutable std::mutex mu_;
         std::atomic<bool> stopping_{false};
         fga::util::Counter inflight_;
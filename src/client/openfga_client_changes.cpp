@@ -0,0 +1,97 @@
+#include <chrono>
+#include <string>
+
+#include "openfga_client.hpp"
+
+namespace fga::client
+{
+    namespace
+    {
+        /*
+         * ReadChanges 한 페이지를 읽는다.
+         * 결과는 콜백으로 넘기고 BGW 메인 루프가 캐시에 반영한다.
+         */
+        class ReadChangesCall final : public ::grpc::ClientUnaryReactor
+        {
+          public:
+            ReadChangesCall(const ReadChangesQuery& query, ReadChangesCallback done)
+                : done_(std::move(done))
+            {
+                request_.set_store_id(query.store_id);
+                request_.mutable_page_size()->set_value(query.page_size);
+
+                if (!query.continuation_token.empty())
+                {
+                    request_.set_continuation_token(query.continuation_token);
+                }
+                else
+                {
+                    // token 이 없으면 과거 이력 전체 대신 feed 를 시작한 시각부터 읽는다
+                    const auto since = query.start_time.time_since_epoch();
+                    const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(since);
+                    const auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(since - seconds);
+
+                    request_.mutable_start_time()->set_seconds(seconds.count());
+                    request_.mutable_start_time()->set_nanos(static_cast<int32_t>(nanos.count()));
+                }
+            }
+
+            void start(PooledChannel& channel, std::chrono::milliseconds timeout)
+            {
+                channel_ = &channel;
+                channel_->begin();
+
+                // Set deadline
+                context_.set_deadline(std::chrono::system_clock::now() + timeout);
+
+                channel_->stub()->async()->ReadChanges(&context_, &request_, &response_, this);
+                StartCall();
+            }
+
+            void OnDone(const ::grpc::Status& status) override
+            {
+                ReadChangesResult result;
+
+                channel_->end(status.ok());
+
+                if (status.ok())
+                {
+                    result.ok = true;
+                    result.continuation_token = response_.continuation_token();
+                    result.changes.reserve(response_.changes_size());
+
+                    for (const auto& change : response_.changes())
+                    {
+                        result.changes.push_back(ChangedTuple{
+                            .object = change.tuple_key().object(),
+                            .user = change.tuple_key().user(),
+                        });
+                    }
+                }
+                else
+                {
+                    // 만료/형식 오류 token 은 INVALID_ARGUMENT 로 거부된다
+                    result.invalid_token = status.error_code() == ::grpc::StatusCode::INVALID_ARGUMENT &&
+                                           !request_.has_start_time();
+                    result.error_message = status.error_message();
+                }
+
+                done_(std::move(result));
+                delete this;
+            }
+
+          private:
+            PooledChannel* channel_ = nullptr;
+            ReadChangesCallback done_;
+            ::grpc::ClientContext context_;
+            ::openfga::v1::ReadChangesRequest request_;
+            ::openfga::v1::ReadChangesResponse response_;
+        };
+    } // anonymous namespace
+
+    void OpenFgaGrpcClient::read_changes(const ReadChangesQuery& query, ReadChangesCallback done)
+    {
+        auto* call = new ReadChangesCall(query, std::move(done));
+        call->start(acquire_channel(), config_.timeout);
+    }
+} // namespace fga::client
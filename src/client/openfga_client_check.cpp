@@ -1,4 +1,9 @@
 
+#include <string>
+#include <string_view>
+
+#include <google/protobuf/util/json_util.h>
+
 #include "openfga_client.hpp"
 #include "payload.h"
 #include "request_variant.hpp"
@@ -8,6 +13,67 @@ namespace fga::client
 {
     namespace
     {
+        template <typename Request> void set_consistency(const FgaRequest& in, Request& out)
+        {
+            if (in.flags & FGA_REQUEST_FLAG_HIGHER_CONSISTENCY)
+                out.set_consistency(::openfga::v1::ConsistencyPreference::HIGHER_CONSISTENCY);
+        }
+
+        std::string object_of(const FgaTuple& tuple)
+        {
+            return std::string(tuple.object_type) + ":" + tuple.object_id;
+        }
+
+        std::string user_of(const FgaTuple& tuple)
+        {
+            return std::string(tuple.subject_type) + ":" + tuple.subject_id;
+        }
+
+        void fill_contextual(const FgaContextualTuples& in, ::openfga::v1::ContextualTupleKeys* out)
+        {
+            for (uint32_t i = 0; i < in.count && i < FGA_CONTEXTUAL_TUPLES_MAX; ++i)
+            {
+                ::openfga::v1::TupleKey* key = out->add_tuple_keys();
+
+                key->set_object(object_of(in.tuples[i]));
+                key->set_user(user_of(in.tuples[i]));
+                key->set_relation(in.tuples[i].relation);
+            }
+        }
+
+        /*
+         * Completion::check_context() 를 CheckRequest 로 읽는다 (contextual_tuples, context 만 채워짐).
+         * 읽지 못하면 응답에 오류를 채워 완료 처리하고 false. RPC 를 보내기 전 BGW 스레드에서 호출한다.
+         */
+        bool read_check_context(Completion& completion, ::openfga::v1::CheckRequest& out)
+        {
+            const std::string_view json = completion.check_context();
+
+            if (json.empty())
+                return true;
+
+            const auto status = ::google::protobuf::util::JsonStringToMessage(std::string(json), &out);
+            if (status.ok())
+                return true;
+
+            FgaResponse& res = completion.payload().response;
+            const std::string message = "invalid check context: " + std::string(status.message());
+
+            res.status = FGA_RESPONSE_CLIENT_ERROR;
+            strlcpy(res.error_message, message.c_str(), sizeof(res.error_message));
+            completion.done();
+            return false;
+        }
+
+        /* CheckRequest 또는 BatchCheckItem 에 더한다 (overlay 의 contextual tuple 뒤에 붙음) */
+        template <typename Target> void merge_check_context(const ::openfga::v1::CheckRequest& context, Target& out)
+        {
+            if (context.has_contextual_tuples())
+                out.mutable_contextual_tuples()->MergeFrom(context.contextual_tuples());
+            if (context.has_context())
+                out.mutable_context()->MergeFrom(context.context());
+        }
+
         void fill_check_request(const CheckTuple& in, ::openfga::v1::CheckRequest& out)
         {
             out.set_store_id(in.store_id());
@@ -15,142 +81,308 @@ namespace fga::client
 
             const FgaCheckTupleRequest& payload = in.request();
             const FgaTuple& tuple = payload.tuple;
-            // out.set_consistency(::openfga::v1::ConsistencyPreference::HIGHER_CONSISTENCY);
+            set_consistency(in.payload.request, out);
 
             auto* tuple_key = out.mutable_tuple_key();
 
-            tuple_key->set_object(std::string(tuple.object_type) + ":" + tuple.object_id);
-            tuple_key->set_user(std::string(tuple.subject_type) + ":" + tuple.subject_id);
+            tuple_key->set_object(object_of(tuple));
+            tuple_key->set_user(user_of(tuple));
             tuple_key->set_relation(tuple.relation);
+
+            if (payload.contextual.count > 0)
+                fill_contextual(payload.contextual, out.mutable_contextual_tuples());
         }
 
         void fill_tuple_key(const FgaTuple& tuple, ::openfga::v1::CheckRequestTupleKey* tupleKey)
         {
-            tupleKey->set_object(std::string(tuple.object_type) + ":" + tuple.object_id);
-            tupleKey->set_user(std::string(tuple.subject_type) + ":" + tuple.subject_id);
+            tupleKey->set_object(object_of(tuple));
+            tupleKey->set_user(user_of(tuple));
             tupleKey->set_relation(tuple.relation);
         }
 
-        struct CheckContext
+        class CheckCall final : public ::grpc::ClientUnaryReactor
         {
-            grpc::ClientContext context;
-            ::openfga::v1::CheckRequest request;
-            ::openfga::v1::CheckResponse response;
+          public:
+            CheckCall(const CheckTuple& req, Completion& completion, const ::openfga::v1::CheckRequest& context)
+                : req_(req),
+                  completion_(completion)
+            {
+                fill_check_request(req_, request_);
+                merge_check_context(context, request_);
+            }
+
+            void start(PooledChannel& channel, std::chrono::milliseconds timeout)
+            {
+                channel_ = &channel;
+                channel_->begin();
+
+                // Set deadline
+                context_.set_deadline(std::chrono::system_clock::now() + timeout);
+
+                channel_->stub()->async()->Check(&context_, &request_, &response_, this);
+                StartCall();
+            }
+
+            void OnDone(const ::grpc::Status& status) override
+            {
+                FgaResponse& res = req_.response();
+                if (status.ok())
+                {
+                    res.status = FGA_RESPONSE_OK;
+                    res.body.checkTuple.allow = response_.allowed();
+                }
+                else
+                {
+                    res.status = FGA_RESPONSE_CLIENT_ERROR;
+                    res.body.checkTuple.allow = false;
+                    strlcpy(res.error_message, status.error_message().c_str(), sizeof(res.error_message));
+                }
+                channel_->end(status.ok());
+                completion_.done();
+                delete this;
+            }
+
+          private:
+            PooledChannel* channel_ = nullptr;
+            CheckTuple req_;
+            Completion& completion_;
+            ::grpc::ClientContext context_;
+            ::openfga::v1::CheckRequest request_;
+            ::openfga::v1::CheckResponse response_;
         };
 
-        struct BatchCheckContext
+        class BatchCheckCall final : public ::grpc::ClientUnaryReactor
         {
-            grpc::ClientContext context;
-            ::openfga::v1::BatchCheckRequest request;
-            ::openfga::v1::BatchCheckResponse response;
-        };
-    } // anonymous namespace
+          public:
+            explicit BatchCheckCall(std::vector<BatchCheckItem> items)
+                : items_(std::move(items))
+            {
+                const BatchCheckItem& first = items_.front();
+                request_.set_store_id(first.params.store_id());
+                request_.set_authorization_model_id(first.params.model_id());
 
-    void OpenFgaGrpcClient::handle_check_batch(std::vector<BatchCheckItem> items)
-    {
-        auto ctx = std::make_shared<BatchCheckContext>();
+                /* 기본 consistency 인 요청만 묶인다 (batchable_check) */
+                for (const auto& item : items_)
+                {
+                    ::openfga::v1::BatchCheckItem* check = request_.add_checks();
+                    check->set_correlation_id(std::to_string(item.params.request_id()));
 
-        const BatchCheckItem& first = items.front();
-        ctx->request.set_store_id(first.params.store_id());
-        ctx->request.set_authorization_model_id(first.params.model_id());
+                    const FgaCheckTupleRequest& request = item.params.request();
+                    ::openfga::v1::CheckRequestTupleKey* tupleKey = check->mutable_tuple_key();
+                    fill_tuple_key(request.tuple, tupleKey);
+                }
+            }
 
-        // ctx->request.set_store_id(config_.store_id);
-        // ctx->request.set_authorization_model_id(config_.model_id());
-        // ctx->request.set_consistency(::openfga::v1::ConsistencyPreference::HIGHER_CONSISTENCY);
-        for (const auto& item : items)
-        {
-            ::openfga::v1::BatchCheckItem* check = ctx->request.add_checks();
-            check->set_correlation_id(std::to_string(item.params.request_id()));
+            void start(PooledChannel& channel, std::chrono::milliseconds timeout)
+            {
+                channel_ = &channel;
+                channel_->begin();
 
-            const FgaCheckTupleRequest& request = item.params.request();
-            ::openfga::v1::CheckRequestTupleKey* tupleKey = check->mutable_tuple_key();
-            fill_tuple_key(request.tuple, tupleKey);
-        }
+                // Set deadline
+                context_.set_deadline(std::chrono::system_clock::now() + timeout);
 
-        // Set deadline
-        ctx->context.set_deadline(std::chrono::system_clock::now() + config_.timeout);
+                channel_->stub()->async()->BatchCheck(&context_, &request_, &response_, this);
+                StartCall();
+            }
 
-        auto callback = [ctx, items = std::move(items)](::grpc::Status status)
-        {
-            if (status.ok())
+            void OnDone(const ::grpc::Status& status) override
             {
-                const auto& result_map = ctx->response.result();
-                for (auto& item : items)
+                // 마지막 done() 뒤에는 processor 와 client (채널 풀) 가 해제될 수 있으므로 먼저 반납한다
+                channel_->end(status.ok());
+
+                if (status.ok())
                 {
-                    const auto& correlation_id = std::to_string(item.params.request_id());
-                    const auto& it = result_map.find(correlation_id);
-                    FgaResponse& out = item.params.response();
-                    if (it == result_map.end())
+                    const auto& result_map = response_.result();
+                    for (auto& item : items_)
                     {
+                        const auto& correlation_id = std::to_string(item.params.request_id());
+                        const auto& it = result_map.find(correlation_id);
+                        FgaResponse& out = item.params.response();
+                        if (it == result_map.end())
+                        {
+                            out.body.checkTuple.allow = false;
+                            out.status = FGA_RESPONSE_CLIENT_ERROR;
+                        }
+                        else
+                        {
+                            const auto& res = it->second;
+                            if (res.has_allowed())
+                            {
+                                out.status = FGA_RESPONSE_OK;
+                                out.body.checkTuple.allow = res.allowed();
+                            }
+                            else if (res.has_error())
+                            {
+                                out.status = FGA_RESPONSE_SERVER_ERROR;
+                                out.body.checkTuple.allow = false;
+                                strlcpy(out.error_message, res.error().message().c_str(), sizeof(out.error_message));
+                            }
+                            else
+                            {
+                                out.status = FGA_RESPONSE_CLIENT_ERROR;
+                                out.body.checkTuple.allow = false;
+                                strlcpy(out.error_message, "Invalid response received", sizeof(out.error_message));
+                            }
+                        }
+                        item.completion->done();
+                    }
+                }
+                else
+                {
+                    for (auto& item : items_)
+                    {
+                        FgaResponse& out = item.params.response();
                         out.body.checkTuple.allow = false;
                         out.status = FGA_RESPONSE_CLIENT_ERROR;
+                        strlcpy(out.error_message, status.error_message().c_str(), sizeof(out.error_message));
+                        item.completion->done();
                     }
-                    else
+                }
+                delete this;
+            }
+
+          private:
+            PooledChannel* channel_ = nullptr;
+            std::vector<BatchCheckItem> items_;
+            ::grpc::ClientContext context_;
+            ::openfga::v1::BatchCheckRequest request_;
+            ::openfga::v1::BatchCheckResponse response_;
+        };
+
+        /*
+         * 한 tuple 의 여러 relation 을 BatchCheck 하나로 확인 (correlation_id = relation 비트 번호).
+         * 물은 relation(relation_bit) 의 결과가 있으면 OK, 나머지는 받은 만큼 known 에 표시한다.
+         */
+        class CheckRelationsCall final : public ::grpc::ClientUnaryReactor
+        {
+          public:
+            CheckRelationsCall(Completion& completion,
+                               std::vector<RelationName> relations,
+                               const ::openfga::v1::CheckRequest& context)
+                : completion_(completion),
+                  relations_(std::move(relations))
+            {
+                const FgaRequest& req = completion_.payload().request;
+                const FgaTuple& tuple = req.body.checkRelations.tuple;
+
+                request_.set_store_id(req.store_id);
+                request_.set_authorization_model_id(req.model_id);
+                set_consistency(req, request_);
+
+                for (const auto& relation : relations_)
+                {
+                    ::openfga::v1::BatchCheckItem* check = request_.add_checks();
+                    check->set_correlation_id(std::to_string(relation.bit));
+
+                    ::openfga::v1::CheckRequestTupleKey* tupleKey = check->mutable_tuple_key();
+                    fill_tuple_key(tuple, tupleKey);
+                    tupleKey->set_relation(relation.name);
+
+                    if (req.body.checkRelations.contextual.count > 0)
+                        fill_contextual(req.body.checkRelations.contextual, check->mutable_contextual_tuples());
+                    merge_check_context(context, *check);
+                }
+            }
+
+            void start(PooledChannel& channel, std::chrono::milliseconds timeout)
+            {
+                channel_ = &channel;
+                channel_->begin();
+
+                // Set deadline
+                context_.set_deadline(std::chrono::system_clock::now() + timeout);
+
+                channel_->stub()->async()->BatchCheck(&context_, &request_, &response_, this);
+                StartCall();
+            }
+
+            void OnDone(const ::grpc::Status& status) override
+            {
+                FgaPayload& payload = completion_.payload();
+                FgaResponse& out = payload.response;
+                const uint64_t wanted = uint64_t{1} << payload.request.body.checkRelations.relation_bit;
+
+                out.body.checkRelations.allowed = 0;
+                out.body.checkRelations.known = 0;
+                out.error_message[0] = '\0';
+
+                if (status.ok())
+                {
+                    const auto& result_map = response_.result();
+                    for (const auto& relation : relations_)
                     {
-                        const auto& res = it->second;
-                        if (res.has_allowed())
+                        const auto& it = result_map.find(std::to_string(relation.bit));
+                        const uint64_t bit = uint64_t{1} << relation.bit;
+
+                        if (it == result_map.end())
+                            continue;
+
+                        if (it->second.has_allowed())
                         {
-                            out.status = FGA_RESPONSE_OK;
-                            out.body.checkTuple.allow = res.allowed();
+                            out.body.checkRelations.known |= bit;
+                            if (it->second.allowed())
+                                out.body.checkRelations.allowed |= bit;
                         }
-                        else if (res.has_error())
+                        else if (bit == wanted && it->second.has_error())
                         {
-                            out.status = FGA_RESPONSE_SERVER_ERROR;
-                            out.body.checkTuple.allow = false;
-                            strlcpy(out.error_message, res.error().message().c_str(), sizeof(out.error_message));
+                            strlcpy(out.error_message, it->second.error().message().c_str(), sizeof(out.error_message));
                         }
-                        else
-                        {
-                            out.status = FGA_RESPONSE_CLIENT_ERROR;
-                            out.body.checkTuple.allow = false;
+                    }
+
+                    if (out.body.checkRelations.known & wanted)
+                        out.status = FGA_RESPONSE_OK;
+                    else
+                    {
+                        out.status = FGA_RESPONSE_SERVER_ERROR;
+                        if (out.error_message[0] == '\0')
                             strlcpy(out.error_message, "Invalid response received", sizeof(out.error_message));
-                        }
                     }
-                    item.callback();
                 }
-            }
-            else
-            {
-                for (auto& item : items)
+                else
                 {
-                    FgaResponse& out = item.params.response();
-                    out.body.checkTuple.allow = false;
                     out.status = FGA_RESPONSE_CLIENT_ERROR;
                     strlcpy(out.error_message, status.error_message().c_str(), sizeof(out.error_message));
-                    item.callback();
                 }
+                channel_->end(status.ok());
+                completion_.done();
+                delete this;
             }
+
+          private:
+            PooledChannel* channel_ = nullptr;
+            Completion& completion_;
+            std::vector<RelationName> relations_;
+            ::grpc::ClientContext context_;
+            ::openfga::v1::BatchCheckRequest request_;
+            ::openfga::v1::BatchCheckResponse response_;
         };
+    } // anonymous namespace
 
-        stub_->async()->BatchCheck(&ctx->context, &ctx->request, &ctx->response, std::move(callback));
-    }
+    void OpenFgaGrpcClient::check_relations(Completion& completion, std::vector<RelationName> relations)
+    {
+        ::openfga::v1::CheckRequest context;
+
+        if (!read_check_context(completion, context))
+            return;
 
+        auto* call = new CheckRelationsCall(completion, std::move(relations), context);
+        call->start(acquire_channel(), timeout_for(completion.payload().request));
+    }
 
-    void OpenFgaGrpcClient::handle_request(CheckTuple& req, ProcessCallback cb)
+    void OpenFgaGrpcClient::handle_check_batch(std::vector<BatchCheckItem> items)
     {
-        auto ctx = std::make_shared<CheckContext>();
-        fill_check_request(req, ctx->request);
+        auto* call = new BatchCheckCall(std::move(items));
+        call->start(acquire_channel(), config_.timeout);
+    }
 
-        // Set deadline
-        ctx->context.set_deadline(std::chrono::system_clock::now() + config_.timeout);
+    void OpenFgaGrpcClient::handle_request(CheckTuple& req, Completion& completion)
+    {
+        ::openfga::v1::CheckRequest context;
 
-        auto callback = [ctx, req, cb = std::move(cb)](::grpc::Status status)
-        {
-            FgaResponse& res = req.response();
-            if (status.ok())
-            {
-                res.status = FGA_RESPONSE_OK;
-                res.body.checkTuple.allow = ctx->response.allowed();
-            }
-            else
-            {
-                res.status = FGA_RESPONSE_CLIENT_ERROR;
-                res.body.checkTuple.allow = false;
-                strlcpy(res.error_message, status.error_message().c_str(), sizeof(res.error_message));
-            }
-            cb();
-        };
+        if (!read_check_context(completion, context))
+            return;
 
-        stub_->async()->Check(&ctx->context, &ctx->request, &ctx->response, std::move(callback));
+        auto* call = new CheckCall(req, completion, context);
+        call->start(acquire_channel(), timeout_for(req.payload.request));
     }
 } // namespace fga::client
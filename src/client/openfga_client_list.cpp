@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "openfga_client.hpp"
+#include "payload.h"
+
+namespace fga::client
+{
+    namespace
+    {
+        size_t varint_size(size_t value)
+        {
+            size_t size = 1;
+            while (value >= 0x80)
+            {
+                value >>= 7;
+                ++size;
+            }
+            return size;
+        }
+
+        /*
+         * StreamedListObjects 를 끝까지 읽는다.
+         * object 는 "type:id" 로 오므로 요청한 type 을 떼고 objects 에 모은다 (정렬/저장은 BGW 메인 루프).
+         * 정렬 전 순서로 front coding 크기의 상한을 누적해 list cache 한도(max_bytes)를 넘거나
+         * FGA_LIST_ID_MAX_LEN 보다 긴 id 가 오면 스트림을 취소하고 실패시킨다 (결과를 끝까지 모으지 않음).
+         */
+        class StreamedListObjectsCall final
+            : public ::grpc::ClientReadReactor<::openfga::v1::StreamedListObjectsResponse>
+        {
+          public:
+            StreamedListObjectsCall(Completion& completion, std::vector<std::string>& objects)
+                : completion_(completion),
+                  objects_(objects)
+            {
+                const FgaRequest& req = completion.payload().request;
+                const FgaListObjectsRequest& body = req.body.listObjects;
+
+                request_.set_store_id(req.store_id);
+                request_.set_authorization_model_id(req.model_id);
+                request_.set_type(body.tuple.object_type);
+                request_.set_relation(body.tuple.relation);
+                request_.set_user(std::string(body.tuple.subject_type) + ":" + body.tuple.subject_id);
+
+                if (req.flags & FGA_REQUEST_FLAG_HIGHER_CONSISTENCY)
+                    request_.set_consistency(::openfga::v1::ConsistencyPreference::HIGHER_CONSISTENCY);
+
+                /* overlay: 이 트랜잭션에서 쓴 tuple */
+                for (uint32_t i = 0; i < body.contextual.count && i < FGA_CONTEXTUAL_TUPLES_MAX; ++i)
+                {
+                    const FgaTuple& tuple = body.contextual.tuples[i];
+                    ::openfga::v1::TupleKey* key = request_.mutable_contextual_tuples()->add_tuple_keys();
+
+                    key->set_object(std::string(tuple.object_type) + ":" + tuple.object_id);
+                    key->set_user(std::string(tuple.subject_type) + ":" + tuple.subject_id);
+                    key->set_relation(tuple.relation);
+                }
+
+                prefix_ = std::string(body.tuple.object_type) + ":";
+                max_bytes_ = body.max_bytes;
+            }
+
+            void start(PooledChannel& channel, std::chrono::milliseconds timeout)
+            {
+                channel_ = &channel;
+                channel_->begin();
+
+                // 스트림 전체에 대한 deadline
+                context_.set_deadline(std::chrono::system_clock::now() + timeout);
+
+                channel_->stub()->async()->StreamedListObjects(&context_, &request_, this);
+                StartRead(&response_);
+                StartCall();
+            }
+
+            void OnReadDone(bool ok) override
+            {
+                // 스트림 끝 또는 오류: OnDone 이 이어서 불린다
+                if (!ok)
+                    return;
+
+                const std::string& object = response_.object();
+                if (object.compare(0, prefix_.size(), prefix_) == 0)
+                    objects_.emplace_back(object, prefix_.size());
+                else
+                    objects_.push_back(object);
+
+                if (!account(objects_.back()))
+                {
+                    // 더 읽지 않는다: 취소하면 OnDone 이 CANCELLED 로 불린다
+                    context_.TryCancel();
+                    return;
+                }
+
+                StartRead(&response_);
+            }
+
+            void OnDone(const ::grpc::Status& status) override
+            {
+                FgaResponse& res = completion_.payload().response;
+                if (!error_.empty())
+                {
+                    res.status = FGA_RESPONSE_CLIENT_ERROR;
+                    strlcpy(res.error_message, error_.c_str(), sizeof(res.error_message));
+                    objects_.clear();
+                }
+                else if (status.ok())
+                {
+                    res.status = FGA_RESPONSE_OK;
+                }
+                else
+                {
+                    res.status = FGA_RESPONSE_CLIENT_ERROR;
+                    strlcpy(res.error_message, status.error_message().c_str(), sizeof(res.error_message));
+                    objects_.clear();
+                }
+                // 우리가 취소한 스트림은 채널 장애가 아니다
+                channel_->end(status.ok() || !error_.empty());
+                completion_.done();
+                delete this;
+            }
+
+          private:
+            /*
+             * 방금 받은 id 를 인코딩 크기 상한에 더한다. 정렬 후 front coding 은 id 마다
+             * varint 두 개와 직전 id 와 겹치지 않는 suffix 이하만 쓰므로, 스트림 순서의 직전 id 로 잰 값이 상한이다.
+             */
+            bool account(const std::string& id)
+            {
+                char message[128];
+
+                if (id.size() > FGA_LIST_ID_MAX_LEN)
+                {
+                    snprintf(message, sizeof(message), "object id longer than %d bytes", FGA_LIST_ID_MAX_LEN);
+                    error_ = message;
+                    return false;
+                }
+
+                size_t shared = 0;
+                if (objects_.size() > 1)
+                {
+                    const std::string& prev = objects_[objects_.size() - 2];
+                    size_t limit = std::min(prev.size(), id.size());
+                    while (shared < limit && prev[shared] == id[shared])
+                        ++shared;
+                }
+
+                bound_ += 2 * varint_size(id.size()) + (id.size() - shared);
+                if (bound_ > max_bytes_)
+                {
+                    snprintf(message,
+                             sizeof(message),
+                             "list objects result exceeds fga.list_cache_size after %zu objects",
+                             objects_.size());
+                    error_ = message;
+                    return false;
+                }
+                return true;
+            }
+
+            PooledChannel* channel_ = nullptr;
+            Completion& completion_;
+            std::vector<std::string>& objects_;
+            std::string prefix_;
+            uint64_t max_bytes_ = 0;
+            uint64_t bound_ = 0;    // 지금까지 받은 id 의 인코딩 크기 상한
+            std::string error_;     // 스트림을 취소한 이유
+            ::grpc::ClientContext context_;
+            ::openfga::v1::StreamedListObjectsRequest request_;
+            ::openfga::v1::StreamedListObjectsResponse response_;
+        };
+    } // namespace
+
+    void OpenFgaGrpcClient::list_objects(Completion& completion, std::vector<std::string>& objects)
+    {
+        auto* call = new StreamedListObjectsCall(completion, objects);
+        call->start(acquire_channel(), timeout_for(completion.payload().request));
+    }
+} // namespace fga::client
@@ -8,73 +8,115 @@ namespace fga::client
 {
     namespace
     {
-        struct CreateStoreContext
+        class CreateStoreCall final : public ::grpc::ClientUnaryReactor
         {
-            grpc::ClientContext context;
-            ::openfga::v1::CreateStoreRequest request;
-            ::openfga::v1::CreateStoreResponse response;
-        };
-        
-        struct DeleteStoreContext
-        {
-            grpc::ClientContext context;
-            ::openfga::v1::DeleteStoreRequest request;
-            ::openfga::v1::DeleteStoreResponse response;
-        };
-    } // anonymous namespace
-
-    void OpenFgaGrpcClient::handle_request(CreateStore& req, ProcessCallback cb)
-    {
-        auto ctx = std::make_shared<CreateStoreContext>();
-        ctx->request.set_name(req.request().name);
-        
-        // Set deadline
-        ctx->context.set_deadline(std::chrono::system_clock::now() + config_.timeout);
-
-        auto callback = [ctx, req, cb = std::move(cb)](::grpc::Status status)
-        {
-            FgaResponse& res = req.response();
-            FgaCreateStoreResponse& body = res.body.createStore;
-            if (status.ok())
+          public:
+            CreateStoreCall(const CreateStore& req, Completion& completion)
+                : req_(req),
+                  completion_(completion)
             {
-                res.status = FGA_RESPONSE_OK;
-                strlcpy(body.id, ctx->response.id().c_str(), sizeof(body.id));
-                strlcpy(body.name, ctx->response.name().c_str(), sizeof(body.name));
+                request_.set_name(req_.request().name);
             }
-            else
+
+            void start(PooledChannel& channel, std::chrono::milliseconds timeout)
             {
-                res.status = FGA_RESPONSE_CLIENT_ERROR;
-                strlcpy(res.error_message, status.error_message().c_str(), sizeof(res.error_message));
+                channel_ = &channel;
+                channel_->begin();
+
+                // Set deadline
+                context_.set_deadline(std::chrono::system_clock::now() + timeout);
+
+                channel_->stub()->async()->CreateStore(&context_, &request_, &response_, this);
+                StartCall();
             }
-            cb();
-        };
 
-        stub_->async()->CreateStore(&ctx->context, &ctx->request, &ctx->response, std::move(callback));
-    }
+            void OnDone(const ::grpc::Status& status) override
+            {
+                FgaResponse& res = req_.response();
+                FgaCreateStoreResponse& body = res.body.createStore;
+                if (status.ok())
+                {
+                    res.status = FGA_RESPONSE_OK;
+                    strlcpy(body.id, response_.id().c_str(), sizeof(body.id));
+                    strlcpy(body.name, response_.name().c_str(), sizeof(body.name));
+                }
+                else
+                {
+                    res.status = FGA_RESPONSE_CLIENT_ERROR;
+                    strlcpy(res.error_message, status.error_message().c_str(), sizeof(res.error_message));
+                }
+                channel_->end(status.ok());
+                completion_.done();
+                delete this;
+            }
 
-    void OpenFgaGrpcClient::handle_request(DeleteStore& req, ProcessCallback cb)
-    {
-        auto ctx = std::make_shared<DeleteStoreContext>();
-        ctx->request.set_store_id(req.store_id());
-        
-        // Set deadline
-        ctx->context.set_deadline(std::chrono::system_clock::now() + config_.timeout);
+          private:
+            PooledChannel* channel_ = nullptr;
+            CreateStore req_;
+            Completion& completion_;
+            ::grpc::ClientContext context_;
+            ::openfga::v1::CreateStoreRequest request_;
+            ::openfga::v1::CreateStoreResponse response_;
+        };
 
-        auto callback = [ctx, req, cb = std::move(cb)](::grpc::Status status)
+        class DeleteStoreCall final : public ::grpc::ClientUnaryReactor
         {
-            FgaResponse& res = req.response();
-            if (status.ok())
+          public:
+            DeleteStoreCall(const DeleteStore& req, Completion& completion)
+                : req_(req),
+                  completion_(completion)
             {
-                res.status = FGA_RESPONSE_OK;
+                request_.set_store_id(req_.store_id());
+            }
+
+            void start(PooledChannel& channel, std::chrono::milliseconds timeout)
+            {
+                channel_ = &channel;
+                channel_->begin();
+
+                // Set deadline
+                context_.set_deadline(std::chrono::system_clock::now() + timeout);
+
+                channel_->stub()->async()->DeleteStore(&context_, &request_, &response_, this);
+                StartCall();
             }
-            else
+
+            void OnDone(const ::grpc::Status& status) override
             {
-                res.status = FGA_RESPONSE_CLIENT_ERROR;
-                strlcpy(res.error_message, status.error_message().c_str(), sizeof(res.error_message));
+                FgaResponse& res = req_.response();
+                if (status.ok())
+                {
+                    res.status = FGA_RESPONSE_OK;
+                }
+                else
+                {
+                    res.status = FGA_RESPONSE_CLIENT_ERROR;
+                    strlcpy(res.error_message, status.error_message().c_str(), sizeof(res.error_message));
+                }
+                channel_->end(status.ok());
+                completion_.done();
+                delete this;
             }
-            cb();
+
+          private:
+            PooledChannel* channel_ = nullptr;
+            DeleteStore req_;
+            Completion& completion_;
+            ::grpc::ClientContext context_;
+            ::openfga::v1::DeleteStoreRequest request_;
+            ::openfga::v1::DeleteStoreResponse response_;
         };
+    } // anonymous namespace
 
-        stub_->async()->DeleteStore(&ctx->context, &ctx->request, &ctx->response, std::move(callback));
+    void OpenFgaGrpcClient::handle_request(CreateStore& req, Completion& completion)
+    {
+        auto* call = new CreateStoreCall(req, completion);
+        call->start(acquire_channel(), config_.timeout);
+    }
+
+    void OpenFgaGrpcClient::handle_request(DeleteStore& req, Completion& completion)
+    {
+        auto* call = new DeleteStoreCall(req, completion);
+        call->start(acquire_channel(), config_.timeout);
     }
 } // namespace fga::client
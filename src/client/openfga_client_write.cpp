@@ -1,3 +1,8 @@
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <unordered_set>
+
 #include "openfga_client.hpp"
 #include "payload.h"
 #include "request_variant.hpp"
@@ -14,94 +19,188 @@ namespace fga::client
             tuple_key->set_relation(tuple.relation);
         }
 
-        void fill_request(const WriteTuple& in, ::openfga::v1::WriteRequest& out)
-        {
-            out.set_store_id(in.store_id());
-            out.set_authorization_model_id(in.model_id());
-
-            const FgaWriteTupleRequest& payload = in.request();
-            ::openfga::v1::WriteRequestWrites* writes = out.mutable_writes();
-            writes->set_on_duplicate("ignore");
-
-            ::openfga::v1::TupleKey* tuple_key = writes->add_tuple_keys();
-            const FgaTuple& tuple = payload.tuple;
-            fill_tuple_key(tuple, tuple_key);
-        }
-
-        void fill_request(const DeleteTuple& in, ::openfga::v1::WriteRequest& out)
+        void fill_tuple_key(const FgaTuple& tuple, ::openfga::v1::TupleKeyWithoutCondition* tuple_key)
         {
-            out.set_store_id(in.store_id());
-
-            const FgaDeleteTupleRequest& payload = in.request();
-            ::openfga::v1::WriteRequestDeletes* deletes = out.mutable_deletes();
-            deletes->set_on_missing("ignore");
-
-            ::openfga::v1::TupleKeyWithoutCondition* tuple_key = deletes->add_tuple_keys();
-            const FgaTuple& tuple = payload.tuple;
             tuple_key->set_object(std::string(tuple.object_type) + ":" + tuple.object_id);
             tuple_key->set_user(std::string(tuple.subject_type) + ":" + tuple.subject_id);
             tuple_key->set_relation(tuple.relation);
         }
 
-        struct WriteContext
+        /* 같은 요청 안에서 중복/충돌(write + delete) 여부 판별용 키 */
+        std::string tuple_identity(const FgaTuple& tuple)
         {
-            ::grpc::ClientContext context;
-            ::openfga::v1::WriteRequest request;
-            ::openfga::v1::WriteResponse response;
-        };
-    } // anonymous namespace
-
-    void OpenFgaGrpcClient::handle_request(WriteTuple& req, ProcessCallback cb)
-    {
-        auto ctx = std::make_shared<WriteContext>();
-        fill_request(req, ctx->request);
+            std::string id;
+            id.reserve(128);
+            id.append(tuple.object_type).append(":").append(tuple.object_id);
+            id.append("#").append(tuple.relation);
+            id.append("@").append(tuple.subject_type).append(":").append(tuple.subject_id);
+            return id;
+        }
 
-        // Set deadline
-        ctx->context.set_deadline(std::chrono::system_clock::now() + config_.timeout);
+        /*
+         * 요청 자체가 거부된 경우(검증 오류 등)에만 bisect 한다.
+         * 전송/서버 상태 오류는 나눠 보내도 같은 결과이므로 전체 실패로 처리.
+         */
+        bool should_bisect(const ::grpc::Status& status)
+        {
+            switch (status.error_code())
+            {
+            case ::grpc::StatusCode::CANCELLED:
+            case ::grpc::StatusCode::DEADLINE_EXCEEDED:
+            case ::grpc::StatusCode::RESOURCE_EXHAUSTED:
+            case ::grpc::StatusCode::ABORTED:
+            case ::grpc::StatusCode::UNAVAILABLE:
+            case ::grpc::StatusCode::UNAUTHENTICATED:
+            case ::grpc::StatusCode::PERMISSION_DENIED:
+            case ::grpc::StatusCode::INTERNAL:
+                return false;
+            default:
+                return true;
+            }
+        }
 
-        auto callback = [ctx, req, cb = std::move(cb)](::grpc::Status status)
+        /*
+         * 여러 슬롯의 write/delete 를 하나의 WriteRequest 로 보낸다.
+         * OpenFGA Write 는 all-or-nothing 이므로 실패 시 반으로 나눠 재전송하면서
+         * 실제로 실패한 튜플의 슬롯에만 에러를 보고한다.
+         */
+        class WriteBatchCall final : public ::grpc::ClientUnaryReactor
         {
-            FgaResponse& res = req.response();
-            if (status.ok())
+          public:
+            explicit WriteBatchCall(std::vector<WriteBatchItem> items)
+                : items_(std::move(items))
             {
-                res.status = FGA_RESPONSE_OK;
+                const FgaRequest& first = items_.front().completion->payload().request;
+                request_.set_store_id(first.store_id);
+                request_.set_authorization_model_id(first.model_id);
+
+                for (const auto& item : items_)
+                {
+                    if (item.is_delete)
+                    {
+                        ::openfga::v1::WriteRequestDeletes* deletes = request_.mutable_deletes();
+                        deletes->set_on_missing("ignore");
+                        fill_tuple_key(*item.tuple, deletes->add_tuple_keys());
+                    }
+                    else
+                    {
+                        ::openfga::v1::WriteRequestWrites* writes = request_.mutable_writes();
+                        writes->set_on_duplicate("ignore");
+                        fill_tuple_key(*item.tuple, writes->add_tuple_keys());
+                    }
+                }
+            }
+
+            void start(PooledChannel& channel, std::chrono::milliseconds timeout)
+            {
+                channel_ = &channel;
+                channel_->begin();
+                timeout_ = timeout;
+
+                // Set deadline
+                context_.set_deadline(std::chrono::system_clock::now() + timeout);
+
+                channel_->stub()->async()->Write(&context_, &request_, &response_, this);
+                StartCall();
             }
-            else
+
+            void OnDone(const ::grpc::Status& status) override
             {
-                // res.body.checkTuple.allow = false;
-                res.status = FGA_RESPONSE_CLIENT_ERROR;
-                strlcpy(res.error_message, status.error_message().c_str(), sizeof(res.error_message));
+                channel_->end(status.ok());
+
+                if (status.ok())
+                {
+                    for (auto& item : items_)
+                    {
+                        FgaResponse& res = item.completion->payload().response;
+                        res.status = FGA_RESPONSE_OK;
+                        res.body.writeTuple.success = true;
+                        item.completion->done();
+                    }
+                }
+                else if (items_.size() > 1 && should_bisect(status))
+                {
+                    // 같은 채널로 절반씩 재전송 (gRPC callback 스레드에서 시작해도 안전)
+                    const auto mid = items_.begin() + items_.size() / 2;
+                    std::vector<WriteBatchItem> left(items_.begin(), mid);
+                    std::vector<WriteBatchItem> right(mid, items_.end());
+
+                    (new WriteBatchCall(std::move(left)))->start(*channel_, timeout_);
+                    (new WriteBatchCall(std::move(right)))->start(*channel_, timeout_);
+                }
+                else
+                {
+                    for (auto& item : items_)
+                    {
+                        FgaResponse& res = item.completion->payload().response;
+                        res.status = FGA_RESPONSE_CLIENT_ERROR;
+                        strlcpy(res.error_message, status.error_message().c_str(), sizeof(res.error_message));
+                        item.completion->done();
+                    }
+                }
+                delete this;
             }
-            cb();
+
+          private:
+            PooledChannel* channel_ = nullptr;
+            std::chrono::milliseconds timeout_{0};
+            std::vector<WriteBatchItem> items_;
+            ::grpc::ClientContext context_;
+            ::openfga::v1::WriteRequest request_;
+            ::openfga::v1::WriteResponse response_;
         };
 
-        stub_->async()->Write(&ctx->context, &ctx->request, &ctx->response, std::move(callback));
-    }
+        bool same_target(const WriteBatchItem& a, const WriteBatchItem& b)
+        {
+            const FgaRequest& ra = a.completion->payload().request;
+            const FgaRequest& rb = b.completion->payload().request;
+            return std::strcmp(ra.store_id, rb.store_id) == 0 && std::strcmp(ra.model_id, rb.model_id) == 0;
+        }
+    } // anonymous namespace
 
-    void OpenFgaGrpcClient::handle_request(DeleteTuple& req, ProcessCallback cb)
+    /*
+     * store/model 별로 묶고, 서버 제한(max_tuples_per_write) 과
+     * 요청 내 중복 튜플 금지 규칙에 맞춰 잘라서 전송한다.
+     */
+    void OpenFgaGrpcClient::handle_write_batch(std::vector<WriteBatchItem> items)
     {
-        auto ctx = std::make_shared<WriteContext>();
-        fill_request(req, ctx->request);
-
-        // Set deadline
-        ctx->context.set_deadline(std::chrono::system_clock::now() + config_.timeout);
+        const std::size_t limit = std::max(1, config_.max_tuples_per_write);
 
-        auto callback = [ctx, req, cb = std::move(cb)](::grpc::Status status)
+        while (!items.empty())
         {
-            FgaResponse& res = req.response();
-            if (status.ok())
-            {
-                res.status = FGA_RESPONSE_OK;
-                res.body.deleteTuple.success = true;
-            }
-            else
+            std::vector<WriteBatchItem> chunk;
+            std::vector<WriteBatchItem> rest;
+            std::unordered_set<std::string> seen;
+
+            chunk.reserve(std::min(limit, items.size()));
+
+            for (auto& item : items)
             {
-                res.status = FGA_RESPONSE_CLIENT_ERROR;
-                strlcpy(res.error_message, status.error_message().c_str(), sizeof(res.error_message));
+                if (chunk.size() < limit && same_target(items.front(), item) &&
+                    seen.insert(tuple_identity(*item.tuple)).second)
+                {
+                    chunk.push_back(item);
+                }
+                else
+                {
+                    rest.push_back(item);
+                }
             }
-            cb();
-        };
 
-        stub_->async()->Write(&ctx->context, &ctx->request, &ctx->response, std::move(callback));
+            auto* call = new WriteBatchCall(std::move(chunk));
+            call->start(acquire_channel(), config_.timeout);
+
+            items.swap(rest);
+        }
+    }
+
+    void OpenFgaGrpcClient::handle_request(WriteTuple& req, Completion& completion)
+    {
+        handle_write_batch({WriteBatchItem{.tuple = &req.request().tuple, .is_delete = false, .completion = &completion}});
+    }
+
+    void OpenFgaGrpcClient::handle_request(DeleteTuple& req, Completion& completion)
+    {
+        handle_write_batch({WriteBatchItem{.tuple = &req.request().tuple, .is_delete = true, .completion = &completion}});
     }
 } // namespace fga::client
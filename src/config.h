@@ -15,8 +15,24 @@ typedef struct FgaConfig
     bool cache_enabled;            /* Enable or disable the permission cache */
     int cache_size;                /* Size in MB */
     int cache_ttl_ms;              /* Cache TTL in milliseconds */
+    int cache_refresh_window_ms;   /* Refresh hits this close to expiry in the background */
+    char* cache_ttl_policy;        /* Per-relation / allow-deny TTL rules */
+    char* cache_transitive_types;  /* Object types whose writes invalidate the whole store */
+    bool cache_prewarm;            /* Load the L2 dump at start, dump at shutdown */
+    int cache_dump_interval_s;     /* Periodic L2 dump interval (0 = shutdown only) */
+    bool cache_admission;          /* TinyLFU admission when L2 evicts a live entry */
+    int l1_cache_entries;          /* Per-backend L1 entries (0 = off) */
+    int l1_cache_ways;             /* Per-backend L1 associativity (1..16) */
     int max_slots;                 /* Maximum number of request slots */
+    int channel_arena_size;        /* Shared arena for check context (kB, 0 = off) */
+    int list_cache_size;           /* Shared fga_list_objects result cache (kB, 0 = off) */
+    int list_cache_ttl_ms;         /* fga_list_objects result TTL (0 = no reuse) */
     int max_relations;             /* Maximum number of relations */
+    int grpc_channels;             /* Number of gRPC channels (connections) */
+    int write_batch_size;          /* Max tuples merged into one Write RPC */
+    int check_batch_size;          /* Rows per batched fga_check qual (0 = off) */
+    int trace_sample_rate;         /* Trace 1 in N requests (0 = off) */
+    int changes_poll_interval_ms;  /* ReadChanges poll interval (0 = off) */
 } FgaConfig;
 
 /* Global configuration instance */
@@ -15,6 +15,10 @@ namespace fga
         Config cfg;
         cfg.endpoint = guc->endpoint ? guc->endpoint : "";
         cfg.timeout = std::chrono::milliseconds(guc->cache_ttl_ms);
+        cfg.max_tuples_per_write = guc->write_batch_size > 0 ? guc->write_batch_size : 1;
+        cfg.channel.pool_size = guc->grpc_channels > 0 ? guc->grpc_channels : 1;
+        cfg.changes.store_id = guc->store_id ? guc->store_id : "";
+        cfg.changes.poll_interval = std::chrono::milliseconds(guc->changes_poll_interval_ms);
         // cfg.use_tls = false;
         return cfg;
     }
@@ -43,6 +43,8 @@ namespace fga
 
         std::string load_balancing_policy; // 예: "round_robin"
 
+        int pool_size = 1; // 독립된 subchannel 을 갖는 채널 개수
+
         bool operator==(const GrpcChannelOptions&) const = default;
     };
 
@@ -54,15 +56,26 @@ namespace fga
         bool operator==(const ConcurrencyOptions&) const = default;
     };
 
+    struct ChangeFeedOptions
+    {
+        std::string store_id;                        // 변경을 읽을 store (BGW 의 fga.store_id)
+        std::chrono::milliseconds poll_interval{0};  // 0 = 사용 안 함
+        int page_size = 100;                         // OpenFGA ReadChanges 최대 page size
+
+        bool operator==(const ChangeFeedOptions&) const = default;
+    };
+
     struct Config
     {
         std::string endpoint;
         std::chrono::milliseconds timeout = std::chrono::milliseconds(10000); // 기본 10초
+        int max_tuples_per_write = 100;                                       // OpenFGA maxTuplesPerWrite
 
         GrpcTlsOptions tls;
         GrpcChannelOptions channel;
         RetryOptions retry;
         ConcurrencyOptions concurrency;
+        ChangeFeedOptions changes;
 
         bool operator==(const Config&) const = default;
     };
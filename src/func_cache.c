@@ -0,0 +1,320 @@
+/*-------------------------------------------------------------------------
+ * func_cache.c
+ *    SQL interface for the shared permission cache
+ *-------------------------------------------------------------------------
+ */
+
+#include <postgres.h>
+
+#include <common/pg_prng.h>
+#include <fmgr.h>
+#include <funcapi.h>
+#include <utils/builtins.h>
+#include <varatt.h>
+
+#include "cache.h"
+#include "cache_probe.h"
+#include "config.h"
+#include "list_cache.h"
+#include "relation.h"
+#include "state.h"
+
+PG_FUNCTION_INFO_V1(fga_cache_dump);
+PG_FUNCTION_INFO_V1(fga_cache_invalidate);
+PG_FUNCTION_INFO_V1(fga_cache_entries);
+PG_FUNCTION_INFO_V1(fga_cache_summary);
+
+/*
+ * 유효한 L2 엔트리를 $PGDATA/postfga_cache.dump 에 기록하고 개수를 반환.
+ * 적재는 다음 BGW 시작 시에만 한다 (change feed 위치가 없으면 종료 시 덤프로 덮어써져야 적재됨).
+ */
+Datum fga_cache_dump(PG_FUNCTION_ARGS)
+{
+    PG_RETURN_INT64(fga_cache_dump_file(ERROR, false));
+}
+
+/* -------------------------------------------------------------------------
+ * fga_cache_invalidate(store, object_type, object_id, subject_type, subject_id)
+ * -------------------------------------------------------------------------
+ */
+
+/* key 를 만드는 인자는 fga_check 와 같은 길이 제한을 따른다 (max_len 은 NUL 포함) */
+static void check_arg_length(size_t len, const char* name, size_t max_len)
+{
+    if (len >= max_len)
+        ereport(ERROR,
+                (errcode(ERRCODE_STRING_DATA_RIGHT_TRUNCATION),
+                 errmsg("postfga: %s is too long", name),
+                 errdetail("At most %zu bytes are allowed.", max_len - 1)));
+}
+
+/* type 과 id 는 함께 주거나 함께 생략해야 한다. 둘 다 있으면 true */
+static bool arg_pair(FunctionCallInfo fcinfo,
+                     int type_arg,
+                     const char* what,
+                     size_t type_max_len,
+                     size_t id_max_len,
+                     text** type_out,
+                     text** id_out)
+{
+    bool has_type = !PG_ARGISNULL(type_arg);
+    bool has_id = !PG_ARGISNULL(type_arg + 1);
+    char name[32];
+
+    if (has_type != has_id)
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                 errmsg("postfga: %s_type and %s_id must be given together", what, what)));
+
+    if (!has_type)
+        return false;
+
+    *type_out = PG_GETARG_TEXT_PP(type_arg);
+    *id_out = PG_GETARG_TEXT_PP(type_arg + 1);
+
+    snprintf(name, sizeof(name), "%s_type", what);
+    check_arg_length(VARSIZE_ANY_EXHDR(*type_out), name, type_max_len);
+    snprintf(name, sizeof(name), "%s_id", what);
+    check_arg_length(VARSIZE_ANY_EXHDR(*id_out), name, id_max_len);
+    return true;
+}
+
+/*
+ * 캐시된 결과를 generation 으로 무효화하고 올린 단위를 반환한다.
+ *   object 를 주면 'object' (subject 도 주면 그 object 의 결과 전체가 대상: object 슬롯이 더 좁다)
+ *   subject 만 주면 'subject', 둘 다 없으면 'global'
+ * global generation 은 store 구분이 없으므로 모든 store 의 캐시가 무효가 된다.
+ */
+Datum fga_cache_invalidate(PG_FUNCTION_ARGS)
+{
+    FgaConfig* config = fga_get_config();
+    const char* store_id = PG_ARGISNULL(0) ? config->store_id : text_to_cstring(PG_GETARG_TEXT_PP(0));
+    text* type = NULL;
+    text* id = NULL;
+
+    if (store_id == NULL || store_id[0] == '\0')
+        ereport(ERROR, errmsg("postfga: store_id is not configured"));
+    check_arg_length(strlen(store_id), "store", OPENFGA_STORE_ID_LEN);
+
+    if (arg_pair(fcinfo, 1, "object", OBJECT_TYPE_MAX_LEN, OBJECT_ID_MAX_LEN, &type, &id))
+    {
+        fga_generation_bump_object(fga_cache_object_key(
+            store_id, VARDATA_ANY(type), VARSIZE_ANY_EXHDR(type), VARDATA_ANY(id), VARSIZE_ANY_EXHDR(id)));
+        /* list 엔트리는 object generation 을 보지 않는다: 쓰기와 같이 모든 목록을 무효화 */
+        fga_list_cache_bump();
+
+        /* subject 인자 검사만 */
+        arg_pair(fcinfo, 3, "subject", SUBJECT_TYPE_MAX_LEN, SUBJECT_ID_MAX_LEN, &type, &id);
+        PG_RETURN_TEXT_P(cstring_to_text("object"));
+    }
+
+    if (arg_pair(fcinfo, 3, "subject", SUBJECT_TYPE_MAX_LEN, SUBJECT_ID_MAX_LEN, &type, &id))
+    {
+        fga_generation_bump_subject(fga_cache_subject_key(
+            store_id, VARDATA_ANY(type), VARSIZE_ANY_EXHDR(type), VARDATA_ANY(id), VARSIZE_ANY_EXHDR(id)));
+        PG_RETURN_TEXT_P(cstring_to_text("subject"));
+    }
+
+    fga_generation_bump_global();
+    PG_RETURN_TEXT_P(cstring_to_text("global"));
+}
+
+/* -------------------------------------------------------------------------
+ * fga_cache_entries(max_entries)
+ * -------------------------------------------------------------------------
+ */
+static const char* status_name(FgaCacheEntryStatus status)
+{
+    switch (status)
+    {
+    case FGA_CACHE_ENTRY_LIVE:
+        return "live";
+    case FGA_CACHE_ENTRY_EXPIRED:
+        return "expired";
+    case FGA_CACHE_ENTRY_STALE:
+        return "stale";
+    }
+    return "unknown";
+}
+
+static void put_entry(const FgaCacheEntryInfo* entry, void* arg)
+{
+    ReturnSetInfo* rsinfo = (ReturnSetInfo*)arg;
+    char key[33];
+    Datum values[9];
+    bool nulls[9] = {false};
+
+    snprintf(key,
+             sizeof(key),
+             "%016llx%016llx",
+             (unsigned long long)entry->key_high,
+             (unsigned long long)entry->key_low);
+
+    values[0] = Int64GetDatum(entry->group);
+    values[1] = Int32GetDatum(entry->slot);
+    values[2] = CStringGetTextDatum(key);
+    values[3] = Int64GetDatum((int64)entry->allowed);
+    values[4] = Int64GetDatum((int64)entry->known);
+    values[5] = Int64GetDatum(entry->expires_in_ms);
+    values[6] = Int16GetDatum(entry->usage);
+    values[7] = CStringGetTextDatum(status_name(entry->status));
+    values[8] = BoolGetDatum(entry->refresh_pending);
+
+    tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+}
+
+/*
+ * L2 엔트리 표본. 임의의 그룹부터 max_entries 개를 읽는다 (NULL 이면 전체).
+ * allowed/known 은 relation 비트 mask 를 그대로 bigint 로 보여준다.
+ */
+Datum fga_cache_entries(PG_FUNCTION_ARGS)
+{
+    int64 max_entries = PG_ARGISNULL(0) ? -1 : PG_GETARG_INT32(0);
+    uint32 start;
+
+    if (!PG_ARGISNULL(0) && max_entries < 0)
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE), errmsg("postfga: max_entries must not be negative")));
+
+    InitMaterializedSRF(fcinfo, 0);
+
+    start = pg_prng_uint32(&pg_global_prng_state) % fga_cache_group_count();
+    fga_cache_scan(start, max_entries, put_entry, fcinfo->resultinfo);
+
+    return (Datum)0;
+}
+
+/* -------------------------------------------------------------------------
+ * fga_cache_summary()
+ * -------------------------------------------------------------------------
+ */
+
+/* 남은 TTL 분포 (L2 는 저장 시각을 보관하지 않으므로 나이 대신 만료까지 남은 시간) */
+static const struct
+{
+    const char* name;
+    int64 below_ms;
+} expires_buckets[] = {
+    {"<1s", 1000},
+    {"<10s", 10 * 1000},
+    {"<1m", 60 * 1000},
+    {"<10m", 10 * 60 * 1000},
+    {"<1h", 60 * 60 * 1000},
+    {">=1h", PG_INT64_MAX},
+};
+
+#define EXPIRES_BUCKETS lengthof(expires_buckets)
+
+typedef struct CacheSummary
+{
+    int64 live;
+    int64 expired;
+    int64 stale;
+    int64 filled;
+    int64 expires_in[EXPIRES_BUCKETS];
+} CacheSummary;
+
+static void count_entry(const FgaCacheEntryInfo* entry, void* arg)
+{
+    CacheSummary* summary = (CacheSummary*)arg;
+
+    summary->filled++;
+    switch (entry->status)
+    {
+    case FGA_CACHE_ENTRY_LIVE:
+        summary->live++;
+        break;
+    case FGA_CACHE_ENTRY_EXPIRED:
+        summary->expired++;
+        return;
+    case FGA_CACHE_ENTRY_STALE:
+        summary->stale++;
+        return;
+    }
+
+    for (int i = 0; i < (int)EXPIRES_BUCKETS; i++)
+    {
+        if (entry->expires_in_ms < expires_buckets[i].below_ms)
+        {
+            summary->expires_in[i]++;
+            break;
+        }
+    }
+}
+
+static void add_row(ReturnSetInfo* rsinfo, const char* section, const char* metric, double value)
+{
+    Datum values[3];
+    bool nulls[3] = {false, false, false};
+
+    values[0] = CStringGetTextDatum(section);
+    values[1] = CStringGetTextDatum(metric);
+    values[2] = Float8GetDatum(value);
+
+    tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+}
+
+/* relation 별 hit/miss 와 허용 비율 (각 백엔드가 RELATION_STATS_FLUSH_EVERY 마다 반영하므로 조금 늦다) */
+static void relation_rows(ReturnSetInfo* rsinfo)
+{
+    FgaRelationRegistry* registry = fga_get_state()->relations;
+    uint32 count;
+    char section[16 + OBJECT_TYPE_MAX_LEN + RELATION_MAX_LEN];
+
+    if (registry == NULL)
+        return;
+
+    count = pg_atomic_read_u32(&registry->count);
+    pg_read_barrier();
+
+    for (uint32 i = 0; i < count; i++)
+    {
+        RelationBitMapEntry* entry = &registry->entries[i];
+        uint64 hits = pg_atomic_read_u64(&entry->hits);
+        uint64 misses = pg_atomic_read_u64(&entry->misses);
+        uint64 allowed;
+        uint64 denied;
+
+        snprintf(section, sizeof(section), "relation.%s#%s", entry->object_type, entry->relation_name);
+        add_row(rsinfo, section, "hits", (double)hits);
+        add_row(rsinfo, section, "misses", (double)misses);
+        if (hits + misses > 0)
+            add_row(rsinfo, section, "hit_ratio", (double)hits / (double)(hits + misses));
+
+        /* fga_check_support 가 selectivity 로 쓰는 값 */
+        allowed = pg_atomic_read_u64(&entry->allowed);
+        denied = pg_atomic_read_u64(&entry->denied);
+        if (allowed + denied > 0)
+            add_row(rsinfo, section, "allow_ratio", (double)allowed / (double)(allowed + denied));
+    }
+}
+
+/*
+ * L2 전체를 훑어 점유율과 남은 TTL 분포, relation 별 hit ratio 를 보여준다.
+ * 잠금 없이 읽으므로 쓰는 중인 그룹의 엔트리는 빠질 수 있다.
+ */
+Datum fga_cache_summary(PG_FUNCTION_ARGS)
+{
+    ReturnSetInfo* rsinfo = (ReturnSetInfo*)fcinfo->resultinfo;
+    CacheSummary summary;
+    double capacity;
+
+    InitMaterializedSRF(fcinfo, 0);
+
+    MemSet(&summary, 0, sizeof(summary));
+    fga_cache_scan(0, -1, count_entry, &summary);
+    capacity = (double)fga_cache_group_count() * FGA_PROBE_GROUP_SIZE;
+
+    add_row(rsinfo, "occupancy", "capacity", capacity);
+    add_row(rsinfo, "occupancy", "live", (double)summary.live);
+    add_row(rsinfo, "occupancy", "expired", (double)summary.expired);
+    add_row(rsinfo, "occupancy", "stale", (double)summary.stale);
+    add_row(rsinfo, "occupancy", "empty", capacity - (double)summary.filled);
+    add_row(rsinfo, "occupancy", "fill_ratio", (double)summary.live / capacity);
+
+    for (int i = 0; i < (int)EXPIRES_BUCKETS; i++)
+        add_row(rsinfo, "expires_in", expires_buckets[i].name, (double)summary.expires_in[i]);
+
+    relation_rows(rsinfo);
+
+    return (Datum)0;
+}
@@ -2,13 +2,20 @@
 
 #include <fmgr.h>
 #include <funcapi.h>
+#include <lib/stringinfo.h>
+#include <port/pg_bitutils.h>
 #include <utils/builtins.h>
 #include <utils/jsonb.h>
+#include <utils/numeric.h>
+#include <xxhash.h>
 
 #include "cache.h"
 #include "channel.h"
 #include "config.h"
+#include "func_fga.h"
+#include "overlay.h"
 #include "payload.h"
+#include "relation.h"
 
 PG_FUNCTION_INFO_V1(fga_check);
 PG_FUNCTION_INFO_V1(fga_write_tuple);
@@ -16,15 +23,46 @@ PG_FUNCTION_INFO_V1(fga_delete_tuple);
 PG_FUNCTION_INFO_V1(fga_create_store);
 PG_FUNCTION_INFO_V1(fga_delete_store);
 
-typedef struct TupleArgsView
+/* miss 하나가 함께 채우는 relation 수 (물은 relation 포함, FGA_CHECK_RELATIONS_MAX 이하) */
+#define FGA_CHECK_RELATIONS_FILL 8
+
+/* batch scan 한 번이 동시에 잡는 슬롯은 pool (fga.max_slots) 의 이 분의 1 까지 */
+#define CHECK_BATCH_SLOT_SHARE 8
+
+/*
+ * check 의 options jsonb
+ *   consistency       : "minimize_latency" (기본) | "higher"  higher 는 캐시를 읽지 않고 OpenFGA 에도 HIGHER_CONSISTENCY 로 묻는다
+ *   cache             : "on" (기본) | "refresh" | "off"       refresh 는 읽지 않고 저장만, off 는 둘 다 안 함
+ *   timeout_ms        : 이 호출의 RPC deadline (기본 fga 설정값)
+ *   context           : condition 평가용 object (CheckRequest.context)
+ *   contextual_tuples : [{"object", "relation", "user"[, "condition"]}, ...] (CheckRequest.contextual_tuples)
+ * 결과는 어느 경우든 저장해 두므로 (off 제외) 지연에 관대한 호출은 계속 hit 를 얻는다.
+ * context/contextual_tuples 는 channel arena 로 BGW 에 넘기고, 그 해시를 캐시 key 에 넣어 같은 값끼리 결과를 공유한다.
+ */
+typedef struct CheckOptions
+{
+    bool cache_read;
+    bool cache_write;
+    bool higher_consistency;
+    uint32 timeout_ms;
+    bool overlay;                 /* 이 트랜잭션에서 쓴 tuple 이 있음 (options 가 아니라 overlay.h) */
+    JsonbValue context;           /* jbvBinary object, 없으면 jbvNull */
+    JsonbValue contextual_tuples; /* jbvBinary array, 없으면 jbvNull */
+    char* context_json;           /* arena 에 넣을 JSON (둘 다 없으면 NULL) */
+    int context_len;
+    uint64 context_hash;          /* context_json 의 해시 (없으면 0) */
+} CheckOptions;
+
+/* check 하나의 진행 상태: check_begin → (풀리지 않았으면) check_fill_slot → RPC → check_finish */
+typedef struct CheckState
 {
-    text* object_type;
-    text* object_id;
-    text* subject_type;
-    text* subject_id;
-    text* relation;
-    Jsonb* options;
-} TupleArgsView;
+    const FgaTupleArgs* args;
+    CheckOptions opts;
+    FgaAclCacheKey key;
+    FgaGenerationSnapshot snapshot;
+    uint64 relations; /* CHECK_RELATIONS 로 같이 물은 relation (0 = CHECK) */
+    bool allowed;
+} CheckState;
 
 /*-------------------------------------------------------------------------
  * Static helpers
@@ -51,7 +89,7 @@ static inline void write_text(char* dst, size_t dst_size, const text* src)
     dst[len] = '\0';
 }
 
-static inline void fill_tuple(TupleArgsView v, FgaTuple* tuple)
+static inline void fill_tuple(FgaTupleArgs v, FgaTuple* tuple)
 {
     write_text(tuple->object_type, sizeof(tuple->object_type), v.object_type);
     write_text(tuple->object_id, sizeof(tuple->object_id), v.object_id);
@@ -75,7 +113,7 @@ static inline void fill_request(FgaRequest* request)
     }
 }
 
-static inline void build_cache_key(FgaAclCacheKey* key, const TupleArgsView* args)
+static inline void build_cache_key(FgaAclCacheKey* key, const FgaTupleArgs* args, uint64 context_hash)
 {
     FgaConfig* config = fga_get_config();
     
@@ -86,11 +124,143 @@ static inline void build_cache_key(FgaAclCacheKey* key, const TupleArgsView* arg
                   args->object_id,
                   args->subject_type,
                   args->subject_id,
-                  args->relation);
+                  args->relation,
+                  context_hash);
+
+}
+
+/*
+ * 같은 type 에서 캐시 조회에 쓰인 다른 relation 도 함께 물을 비트 mask.
+ * 0 이면 단일 check (relation 이 하나뿐이거나 key 가 relation 별 엔트리).
+ * 쓰기에서만 본 relation 은 묻지 않고, 물은 relation 과 낮은 비트부터 FGA_CHECK_RELATIONS_FILL 개까지만 채운다.
+ * (CHECK_RELATIONS 는 miss 마다 따로 가는 BatchCheck 이므로 크게 만들지 않는다)
+ */
+static uint64 relations_to_fill(const FgaTupleArgs* args, const FgaAclCacheKey* key)
+{
+    uint64 bit = FGA_CACHE_RELATION_BIT(key);
+    uint64 mask;
+    uint64 rest;
+
+    if (!key->grouped)
+        return 0;
+
+    mask = fga_relation_checked_mask(VARDATA_ANY(args->object_type), VARSIZE_ANY_EXHDR(args->object_type)) | bit;
+    if (mask == bit)
+        return 0;
+
+    rest = mask & ~bit;
+    mask = bit;
+    for (int n = 1; n < FGA_CHECK_RELATIONS_FILL && rest != 0; n++)
+    {
+        uint64 lowest = rest & (~rest + 1);
+
+        mask |= lowest;
+        rest &= ~lowest;
+    }
+    return mask;
+}
+
+/* relations != 0 이면 CHECK_RELATIONS, 아니면 CHECK */
+static void fill_check_request(FgaRequest* request, const FgaTupleArgs* args, const FgaAclCacheKey* key, uint64 relations)
+{
+    fill_request(request);
 
+    if (relations != 0)
+    {
+        request->type = FGA_REQUEST_CHECK_RELATIONS;
+        fill_tuple(*args, &request->body.checkRelations.tuple);
+        request->body.checkRelations.relations = relations;
+        request->body.checkRelations.relation_bit = (uint8)key->relation_id;
+    }
+    else
+    {
+        request->type = FGA_REQUEST_CHECK;
+        fill_tuple(*args, &request->body.checkTuple.tuple);
+    }
 }
 
-static inline void validate_not_empty(text* arg, const char* argname)
+/* context JSON 을 슬롯의 arena 블록에 복사. 넘길 것이 없으면 true, 블록을 못 얻으면 false */
+static bool attach_context(FgaChannelSlot* slot, const CheckOptions* opts)
+{
+    char* data;
+
+    if (opts->context_len == 0)
+        return true;
+
+    data = fga_channel_arena_alloc(slot, (uint32)opts->context_len);
+    if (data == NULL)
+        return false;
+
+    memcpy(data, opts->context_json, opts->context_len);
+    return true;
+}
+
+/*
+ * stale-while-revalidate: 만료가 가까운 hit 를 BGW 가 다시 check 해서 L2 에 저장하도록 한다.
+ * 기다리지 않으며, 빈 슬롯이나 arena 블록이 없으면 갱신 요청 표시를 지우고 포기한다 (다음 hit 가 다시 시도).
+ */
+static void request_refresh(const FgaTupleArgs* args,
+                            const CheckOptions* opts,
+                            const FgaAclCacheKey* key,
+                            const FgaGenerationSnapshot* snapshot)
+{
+    FgaChannelSlot* slot = fga_channel_try_acquire_slot();
+    FgaCacheStoreHint hint;
+    FgaRequest* request;
+    uint64 relations;
+
+    fga_cache_store_hint(&hint, key, snapshot);
+
+    if (slot != NULL && !attach_context(slot, opts))
+    {
+        fga_channel_release_slot(slot);
+        slot = NULL;
+    }
+
+    if (slot != NULL)
+    {
+        request = &slot->payload.request;
+        relations = relations_to_fill(args, key);
+        fill_check_request(request, args, key, relations);
+
+        if (relations != 0)
+            request->body.checkRelations.cache = hint;
+        else
+            request->body.checkTuple.cache = hint;
+
+        if (fga_channel_submit_slot(slot))
+            return;
+    }
+
+    /* 요청 표시만 남으면 다른 백엔드도 갱신하지 않는다 */
+    fga_cache_release_refresh(&hint);
+}
+
+/* key 의 relation_id 로 인덱싱하는 TTL 표 (fga.cache_ttl_policy) */
+static inline const FgaCacheTtl* cache_ttls(const FgaTupleArgs* args, const FgaAclCacheKey* key, FgaCacheTtl* single)
+{
+    return fga_cache_ttls(key->grouped,
+                          VARDATA_ANY(args->object_type),
+                          VARSIZE_ANY_EXHDR(args->object_type),
+                          VARDATA_ANY(args->relation),
+                          VARSIZE_ANY_EXHDR(args->relation),
+                          single);
+}
+
+/*
+ * 성공한 write/delete 를 캐시에 반영 (무효화만).
+ * 쓴 직접 관계라도 exclusion/intersection 이 있는 relation 은 deny 일 수 있으므로 결과를 저장하지 않는다.
+ */
+static void invalidate_cache(const FgaTupleArgs* args)
+{
+    FgaAclCacheKey key;
+
+    build_cache_key(&key, args, 0);
+    fga_cache_invalidate_tuple(&key, args->object_type, args->subject_id);
+}
+
+/* payload 필드와 캐시 key 에 들어가므로 비어 있지 않고 max_len 미만 (NUL 포함) 이어야 한다 */
+static inline void validate_arg(text* arg, const char* argname, size_t max_len)
 {
     if (unlikely(arg == NULL))
     {
@@ -102,69 +272,429 @@ static inline void validate_not_empty(text* arg, const char* argname)
         ereport(ERROR,
                 (errcode(ERRCODE_STRING_DATA_LENGTH_MISMATCH), errmsg("postfga: %s argument must not be empty", argname)));
     }
+
+    if (VARSIZE_ANY_EXHDR(arg) >= max_len)
+    {
+        ereport(ERROR,
+                (errcode(ERRCODE_STRING_DATA_RIGHT_TRUNCATION),
+                 errmsg("postfga: %s argument is too long", argname),
+                 errdetail("At most %zu bytes are allowed.", max_len - 1)));
+    }
 }
 
-static inline TupleArgsView read_tuple_args(FunctionCallInfo fcinfo)
+static const char* option_string(const char* key, const JsonbValue* value)
 {
-    TupleArgsView v;
-    v.object_type = PG_ARGISNULL(0) ? NULL : PG_GETARG_TEXT_PP(0);
-    validate_not_empty(v.object_type, "object_type");
+    if (value->type != jbvString)
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE), errmsg("postfga: option \"%s\" must be a string", key)));
 
-    v.object_id = PG_ARGISNULL(1) ? NULL : PG_GETARG_TEXT_PP(1);
-    validate_not_empty(v.object_id, "object_id");
+    return pnstrdup(value->val.string.val, value->val.string.len);
+}
 
-    v.subject_type = PG_ARGISNULL(2) ? NULL : PG_GETARG_TEXT_PP(2);
-    validate_not_empty(v.subject_type, "subject_type");
+static void invalid_option_value(const char* key, const char* value, const char* expected)
+{
+    ereport(ERROR,
+            (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+             errmsg("postfga: invalid value \"%s\" for option \"%s\"", value, key),
+             errhint("Expected %s.", expected)));
+}
 
-    v.subject_id = PG_ARGISNULL(3) ? NULL : PG_GETARG_TEXT_PP(3);
-    validate_not_empty(v.subject_id, "subject_id");
+/* contextual_tuples 의 원소는 object (필드는 OpenFGA 가 검사한다) */
+static void check_contextual_tuples(JsonbContainer* tuples)
+{
+    JsonbIterator* it = JsonbIteratorInit(tuples);
+    JsonbValue v;
+    JsonbIteratorToken r;
 
-    v.relation = PG_ARGISNULL(4) ? NULL : PG_GETARG_TEXT_PP(4);
-    validate_not_empty(v.relation, "relation");
+    while ((r = JsonbIteratorNext(&it, &v, true)) != WJB_DONE)
+    {
+        if (r == WJB_ELEM && (v.type != jbvBinary || !JsonContainerIsObject(v.val.binary.data)))
+            ereport(ERROR,
+                    (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                     errmsg("postfga: each element of option \"contextual_tuples\" must be a JSON object")));
+    }
+}
+
+static void apply_option(CheckOptions* opts, const char* key, const JsonbValue* value)
+{
+    if (strcmp(key, "consistency") == 0)
+    {
+        const char* s = option_string(key, value);
+
+        if (strcmp(s, "higher") == 0)
+        {
+            opts->higher_consistency = true;
+            opts->cache_read = false;
+        }
+        else if (strcmp(s, "minimize_latency") != 0)
+            invalid_option_value(key, s, "\"minimize_latency\" or \"higher\"");
+    }
+    else if (strcmp(key, "cache") == 0)
+    {
+        const char* s = option_string(key, value);
+
+        if (strcmp(s, "off") == 0)
+            opts->cache_read = opts->cache_write = false;
+        else if (strcmp(s, "refresh") == 0)
+            opts->cache_read = false;
+        else if (strcmp(s, "on") != 0)
+            invalid_option_value(key, s, "\"on\", \"refresh\" or \"off\"");
+    }
+    else if (strcmp(key, "timeout_ms") == 0)
+    {
+        int32 timeout_ms;
 
+        if (value->type != jbvNumeric)
+            ereport(ERROR,
+                    (errcode(ERRCODE_INVALID_PARAMETER_VALUE), errmsg("postfga: option \"%s\" must be a number", key)));
+
+        timeout_ms = DatumGetInt32(DirectFunctionCall1(numeric_int4, NumericGetDatum(value->val.numeric)));
+        if (timeout_ms <= 0)
+            ereport(ERROR,
+                    (errcode(ERRCODE_INVALID_PARAMETER_VALUE), errmsg("postfga: option \"%s\" must be positive", key)));
+        opts->timeout_ms = (uint32)timeout_ms;
+    }
+    else if (strcmp(key, "context") == 0)
+    {
+        if (value->type != jbvBinary || !JsonContainerIsObject(value->val.binary.data))
+            ereport(ERROR,
+                    (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                     errmsg("postfga: option \"%s\" must be a JSON object", key)));
+        opts->context = *value;
+    }
+    else if (strcmp(key, "contextual_tuples") == 0)
+    {
+        if (value->type != jbvBinary || !JsonContainerIsArray(value->val.binary.data))
+            ereport(ERROR,
+                    (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                     errmsg("postfga: option \"%s\" must be a JSON array", key)));
+        check_contextual_tuples(value->val.binary.data);
+        opts->contextual_tuples = *value;
+    }
+    else
+        ereport(ERROR,
+                (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                 errmsg("postfga: unknown option \"%s\"", key),
+                 errhint("Valid options: consistency, cache, timeout_ms, context, contextual_tuples")));
+}
+
+/*
+ * context/contextual_tuples 를 CheckRequest 의 JSON 표현 일부로 만들고 해시한다.
+ * jsonb 출력은 object key 가 정렬되고 중복이 제거된 형태이므로 같은 값은 같은 해시가 된다
+ * (배열 순서는 그대로 반영된다).
+ */
+static void build_context_json(CheckOptions* opts)
+{
+    StringInfoData json;
+    StringInfo buf = &json;
+
+    if (opts->context.type == jbvNull && opts->contextual_tuples.type == jbvNull)
+        return;
+
+    initStringInfo(buf);
+    appendStringInfoChar(buf, '{');
+    if (opts->contextual_tuples.type != jbvNull)
+    {
+        appendStringInfoString(buf, "\"contextual_tuples\":{\"tuple_keys\":");
+        JsonbToCString(buf, opts->contextual_tuples.val.binary.data, opts->contextual_tuples.val.binary.len);
+        appendStringInfoChar(buf, '}');
+    }
+    if (opts->context.type != jbvNull)
+    {
+        if (opts->contextual_tuples.type != jbvNull)
+            appendStringInfoChar(buf, ',');
+        appendStringInfoString(buf, "\"context\":");
+        JsonbToCString(buf, opts->context.val.binary.data, opts->context.val.binary.len);
+    }
+    appendStringInfoChar(buf, '}');
+
+    if (buf->len > FGA_CHANNEL_ARENA_BLOCK_SIZE)
+        ereport(ERROR,
+                (errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+                 errmsg("postfga: check context is too large"),
+                 errdetail("context and contextual_tuples take %d bytes, at most %d are allowed.",
+                           buf->len,
+                           FGA_CHANNEL_ARENA_BLOCK_SIZE)));
+
+    opts->context_json = buf->data;
+    opts->context_len = buf->len;
+    opts->context_hash = XXH3_64bits(buf->data, buf->len);
+}
+
+/* 모르는 key 나 값은 ERROR (보안 경로에서 오타로 캐시를 읽는 일이 없도록) */
+static void read_check_options(Jsonb* options, CheckOptions* opts)
+{
+    JsonbIterator* it;
+    JsonbValue v;
+    JsonbIteratorToken r;
+
+    opts->cache_read = opts->cache_write = true;
+    opts->higher_consistency = false;
+    opts->timeout_ms = 0;
+    opts->overlay = false;
+    opts->context.type = jbvNull;
+    opts->contextual_tuples.type = jbvNull;
+    opts->context_json = NULL;
+    opts->context_len = 0;
+    opts->context_hash = 0;
+
+    if (options == NULL)
+        return;
+
+    if (!JB_ROOT_IS_OBJECT(options) || JB_ROOT_IS_SCALAR(options))
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE), errmsg("postfga: options must be a JSON object")));
+
+    it = JsonbIteratorInit(&options->root);
+    while ((r = JsonbIteratorNext(&it, &v, true)) != WJB_DONE)
+    {
+        char* key;
+
+        if (r != WJB_KEY)
+            continue;
+
+        key = pnstrdup(v.val.string.val, v.val.string.len);
+        JsonbIteratorNext(&it, &v, true); /* WJB_VALUE */
+        apply_option(opts, key, &v);
+    }
+
+    build_context_json(opts);
+}
+
+static void validate_tuple_args(const FgaTupleArgs* v)
+{
+    validate_arg(v->object_type, "object_type", OBJECT_TYPE_MAX_LEN);
+    validate_arg(v->object_id, "object_id", OBJECT_ID_MAX_LEN);
+    validate_arg(v->subject_type, "subject_type", SUBJECT_TYPE_MAX_LEN);
+    validate_arg(v->subject_id, "subject_id", SUBJECT_ID_MAX_LEN);
+    validate_arg(v->relation, "relation", RELATION_MAX_LEN);
+}
+
+static inline FgaTupleArgs read_tuple_args(FunctionCallInfo fcinfo)
+{
+    FgaTupleArgs v;
+    v.object_type = PG_ARGISNULL(0) ? NULL : PG_GETARG_TEXT_PP(0);
+    v.object_id = PG_ARGISNULL(1) ? NULL : PG_GETARG_TEXT_PP(1);
+    v.subject_type = PG_ARGISNULL(2) ? NULL : PG_GETARG_TEXT_PP(2);
+    v.subject_id = PG_ARGISNULL(3) ? NULL : PG_GETARG_TEXT_PP(3);
+    v.relation = PG_ARGISNULL(4) ? NULL : PG_GETARG_TEXT_PP(4);
     v.options = (PG_NARGS() >= 6 && !PG_ARGISNULL(5)) ? DatumGetJsonbP(PG_GETARG_DATUM(5)) : NULL;
+
+    validate_tuple_args(&v);
     return v;
 }
 
+/*
+ * 캐시로 결과가 정해지면 true (state->allowed).
+ * false 면 RPC 가 필요하다. generation snapshot 은 어느 경우든 RPC 이전 값으로 잡아 둔다.
+ */
+static bool check_begin(CheckState* state, const FgaTupleArgs* args)
+{
+    const char* store_id = fga_get_config()->store_id;
+    bool refresh = false;
+
+    state->args = args;
+    state->relations = 0;
+    state->allowed = false;
+    read_check_options(args->options, &state->opts);
+
+    /*
+     * read-your-writes: 이 트랜잭션에서 쓴 tuple 이 있으면 캐시 대신 RPC.
+     * 쓴 직접 관계와 똑같은 check 라도 `but not`/`and` 가 있는 relation 은 deny 일 수 있으므로
+     * (모델을 읽지 않음) 바로 allow 하지 않고 contextual tuple 로 붙여 묻는다.
+     */
+    if (fga_overlay_active(store_id))
+    {
+        state->opts.cache_read = false;
+        state->opts.overlay = true;
+    }
+
+    build_cache_key(&state->key, args, state->opts.context_hash);
+
+    if (state->opts.cache_read)
+    {
+        if (fga_cache_lookup(&state->key, &state->allowed, &state->snapshot, &refresh))
+        {
+            if (refresh)
+                request_refresh(args, &state->opts, &state->key, &state->snapshot);
+            fga_relation_count_result(state->key.relation_slot, state->allowed);
+            return true;
+        }
+    }
+    else
+    {
+        /* 조회를 건너뛰어도 RPC 이전 generation 은 잡아 둔다 (저장 시 RPC 도중의 무효화 반영) */
+        fga_generation_snapshot(state->key.object_key, state->key.subject_key, &state->snapshot);
+    }
+    return false;
+}
+
+/*
+ * RPC 요청을 슬롯에 채운다. group 이면 같은 type 의 다른 relation 도 함께 묻는다 (CHECK_RELATIONS).
+ * arena 블록을 얻지 못하면 false (슬롯 반환은 호출자).
+ */
+static bool check_fill_slot(CheckState* state, FgaChannelSlot* slot, bool group)
+{
+    FgaRequest* request = &slot->payload.request;
+    const CheckOptions* opts = &state->opts;
+
+    if (!attach_context(slot, opts))
+        return false;
+
+    state->relations = (group && opts->cache_write) ? relations_to_fill(state->args, &state->key) : 0;
+    fill_check_request(request, state->args, &state->key, state->relations);
+    if (opts->higher_consistency || opts->overlay)
+        request->flags |= FGA_REQUEST_FLAG_HIGHER_CONSISTENCY;
+    request->timeout_ms = opts->timeout_ms;
+    if (opts->overlay)
+        fga_overlay_contextual(request->store_id,
+                               state->relations != 0 ? &request->body.checkRelations.contextual
+                                                     : &request->body.checkTuple.contextual);
+    return true;
+}
+
+/* 응답으로 결과를 정하고 캐시에 저장 */
+static bool check_finish(CheckState* state, const FgaResponse* response)
+{
+    FgaCacheTtl single;
+
+    if (response->status != FGA_RESPONSE_OK)
+    {
+        ereport(INFO, (errmsg("postfga: check tuple failed - %s", response->error_message)));
+        return false;
+    }
+
+    if (state->relations != 0)
+    {
+        /* 물은 relation 외에 같이 받은 relation 들도 한 엔트리에 저장 */
+        state->allowed = (response->body.checkRelations.allowed & FGA_CACHE_RELATION_BIT(&state->key)) != 0;
+        fga_cache_store_relations(&state->key,
+                                  response->body.checkRelations.allowed,
+                                  response->body.checkRelations.known,
+                                  cache_ttls(state->args, &state->key, &single),
+                                  &state->snapshot);
+    }
+    else
+    {
+        state->allowed = response->body.checkTuple.allow;
+        if (state->opts.cache_write)
+            fga_cache_store(&state->key, state->allowed, cache_ttls(state->args, &state->key, &single), &state->snapshot);
+    }
+
+    /* planner 의 selectivity 추정용 (fga_check_support) */
+    fga_relation_count_result(state->key.relation_slot, state->allowed);
+    return state->allowed;
+}
+
+static void arena_exhausted(void)
+{
+    ereport(ERROR,
+            (errcode(ERRCODE_OUT_OF_MEMORY),
+             errmsg("postfga: channel arena exhausted"),
+             errhint("Increase fga.channel_arena_size.")));
+}
+
 Datum fga_check(PG_FUNCTION_ARGS)
 {
+    FgaTupleArgs args = read_tuple_args(fcinfo);
+    CheckState state;
+    FgaChannelSlot* slot;
     bool allowed;
-    TupleArgsView args = read_tuple_args(fcinfo);
 
-    FgaAclCacheKey key;
-    build_cache_key(&key, &args);
+    if (check_begin(&state, &args))
+        PG_RETURN_BOOL(state.allowed);
 
-    if (fga_cache_lookup(&key, &allowed))
+    slot = fga_channel_acquire_slot();
+    if (!check_fill_slot(&state, slot, true))
     {
-        PG_RETURN_BOOL(allowed);
+        fga_channel_release_slot(slot);
+        arena_exhausted();
     }
 
+    fga_channel_execute_slot(slot);
+
+    allowed = check_finish(&state, &slot->payload.response);
+    fga_channel_release_slot(slot);
+
+    PG_RETURN_BOOL(allowed);
+}
+
+/*
+ * 풀리지 않은 check 들을 슬롯에 채워 보낸다 (states[pending[0..n)]).
+ * 한 번에 pool 의 1/CHECK_BATCH_SLOT_SHARE 까지만 잡고, 빈 슬롯이 모자라면 잡은 만큼씩 나눠 보낸다.
+ * 동시에 도는 batch scan 들이 pool 을 비워 다른 백엔드의 fga_check 가 실패하지 않게 한다.
+ */
+static void check_batch_send(CheckState* states, const int* pending, int n, bool* results)
+{
+    int limit = Max(1, fga_get_config()->max_slots / CHECK_BATCH_SLOT_SHARE);
+    FgaChannelSlot** slots = (FgaChannelSlot**)palloc(sizeof(FgaChannelSlot*) * Min(n, limit));
+
+    for (int done = 0; done < n;)
     {
-        FgaChannelSlot* slot = fga_channel_acquire_slot();
-        FgaRequest* request = &slot->payload.request;
-        FgaResponse* response = &slot->payload.response;
-        request->type = FGA_REQUEST_CHECK;
-        fill_request(request);
-        fill_tuple(args, &request->body.checkTuple.tuple);
+        volatile int chunk = 0;
 
-        fga_channel_execute_slot(slot);
+        PG_TRY();
+        {
+            while (chunk < limit && done + chunk < n)
+            {
+                FgaChannelSlot* slot = fga_channel_try_acquire_slot();
+
+                if (slot == NULL)
+                {
+                    /* 하나도 못 잡았으면 단일 check 와 같이 오류 */
+                    if (chunk > 0)
+                        break;
+                    slot = fga_channel_acquire_slot();
+                }
+                slots[chunk++] = slot;
+
+                if (!check_fill_slot(&states[pending[done + chunk - 1]], slot, false))
+                    arena_exhausted();
+            }
+        }
+        PG_CATCH();
+        {
+            for (int j = 0; j < chunk; j++)
+                fga_channel_release_slot(slots[j]);
+            PG_RE_THROW();
+        }
+        PG_END_TRY();
 
-        if (response->status == FGA_RESPONSE_OK)
+        fga_channel_execute_slots(slots, chunk);
+
+        for (int j = 0; j < chunk; j++)
         {
-            allowed = response->body.checkTuple.allow;
-        } else {
-            ereport(INFO, (errmsg("postfga: check tuple failed - %s", response->error_message)));
+            results[pending[done + j]] = check_finish(&states[pending[done + j]], &slots[j]->payload.response);
+            fga_channel_release_slot(slots[j]);
         }
+        done += chunk;
+    }
 
-        fga_channel_release_slot(slot);
+    pfree(slots);
+}
+
+void fga_check_batch(const FgaTupleArgs* args, int count, bool* results)
+{
+    CheckState* states = (CheckState*)palloc(sizeof(CheckState) * count);
+    int* pending = (int*)palloc(sizeof(int) * count);
+    int n = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        validate_tuple_args(&args[i]);
+        if (check_begin(&states[i], &args[i]))
+            results[i] = states[i].allowed;
+        else
+            pending[n++] = i;
     }
 
-    PG_RETURN_BOOL(allowed);
+    /* CHECK_RELATIONS 는 요청마다 따로 BatchCheck 가 되므로, 묶을 때는 물은 relation 만 묻는다 */
+    if (n > 0)
+        check_batch_send(states, pending, n, results);
 }
 
 Datum fga_write_tuple(PG_FUNCTION_ARGS)
 {
-    TupleArgsView args = read_tuple_args(fcinfo);
+    FgaTupleArgs args = read_tuple_args(fcinfo);
 
     FgaChannelSlot* const slot = fga_channel_acquire_slot();
     FgaRequest* const request = &slot->payload.request;
@@ -183,6 +713,9 @@ Datum fga_write_tuple(PG_FUNCTION_ARGS)
             ereport(ERROR, errmsg("postfga: write tuple failed - %s", slot->payload.response.error_message));
         }
 
+        invalidate_cache(&args);
+        fga_overlay_record(request->store_id, &request->body.writeTuple.tuple, false);
+
         fga_channel_release_slot(slot);
         PG_RETURN_BOOL(true);
     }
@@ -196,7 +729,7 @@ Datum fga_write_tuple(PG_FUNCTION_ARGS)
 
 Datum fga_delete_tuple(PG_FUNCTION_ARGS)
 {
-    TupleArgsView args = read_tuple_args(fcinfo);
+    FgaTupleArgs args = read_tuple_args(fcinfo);
 
     FgaChannelSlot* const slot = fga_channel_acquire_slot();
     FgaRequest* const request = &slot->payload.request;
@@ -215,6 +748,9 @@ Datum fga_delete_tuple(PG_FUNCTION_ARGS)
             ereport(ERROR, errmsg("postfga: delete tuple failed - %s", response->error_message));
         }
 
+        invalidate_cache(&args);
+        fga_overlay_record(request->store_id, &request->body.deleteTuple.tuple, true);
+
         fga_channel_release_slot(slot);
         PG_RETURN_BOOL(true);
     }
@@ -0,0 +1,39 @@
+/*-------------------------------------------------------------------------
+ *
+ * func_fga.h
+ *    fga_check entry points shared with the executor.
+ *
+ * fga_check 는 SQL 함수로 행마다 불리지만, batch_check.c 의 CustomScan 은
+ * 여러 행의 인자를 모아 fga_check_batch 로 한 번에 확인한다.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef FGA_FUNC_FGA_H
+#define FGA_FUNC_FGA_H
+
+#include <postgres.h>
+
+#include <fmgr.h>
+#include <utils/jsonb.h>
+
+/* fga_check / fga_write_tuple / fga_delete_tuple 의 인자 (NULL = SQL NULL) */
+typedef struct FgaTupleArgs
+{
+    text* object_type;
+    text* object_id;
+    text* subject_type;
+    text* subject_id;
+    text* relation;
+    Jsonb* options;
+} FgaTupleArgs;
+
+extern PGDLLEXPORT Datum fga_check(PG_FUNCTION_ARGS);
+
+/*
+ * args[0..count) 를 fga_check 와 같은 규칙 (인자 검사, options, overlay, 캐시) 으로 확인해 results 에 채운다.
+ * 캐시에서 풀리지 않은 것은 한꺼번에 채널에 넣으므로 BGW 가 BatchCheck 로 묶어 보낸다.
+ */
+void fga_check_batch(const FgaTupleArgs* args, int count, bool* results);
+
+#endif /* FGA_FUNC_FGA_H */
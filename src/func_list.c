@@ -0,0 +1,146 @@
+/*-------------------------------------------------------------------------
+ *
+ * func_list.c
+ *    fga_list_objects: object ids a subject can reach through a relation.
+ *
+ * 행마다 fga_check 를 부르는 대신 허용된 id 집합 하나를 얻어 join 한다.
+ *   SELECT d.* FROM documents d
+ *   WHERE d.id IN (SELECT fga_list_objects('doc', 'viewer', 'user', $1))
+ * planner 는 이 집합으로 hash join / semi join 을 만들 수 있다.
+ *
+ * 결과는 list cache (list_cache.h) 에서 읽는다. 없으면 BGW 가 StreamedListObjects 를 끝까지 읽어
+ * list cache 에 저장하고 그 위치를 응답한다. 이 트랜잭션에서 tuple 을 썼으면 (overlay) 캐시를 건너뛰고
+ * 그 tuple 을 contextual tuple 로 함께 보내며, 결과는 이 호출만 읽는다.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <postgres.h>
+
+#include <fmgr.h>
+#include <funcapi.h>
+#include <utils/builtins.h>
+
+#include "channel.h"
+#include "config.h"
+#include "list_cache.h"
+#include "overlay.h"
+#include "payload.h"
+
+PG_FUNCTION_INFO_V1(fga_list_objects);
+
+/* 비어 있거나 payload 필드보다 긴 인자는 ERROR */
+static char* read_arg(FunctionCallInfo fcinfo, int n, const char* name, size_t max_len)
+{
+    text* value = PG_GETARG_TEXT_PP(n);
+    size_t len = VARSIZE_ANY_EXHDR(value);
+
+    if (len == 0)
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE), errmsg("postfga: %s must not be empty", name)));
+    if (len >= max_len)
+        ereport(ERROR,
+                (errcode(ERRCODE_STRING_DATA_RIGHT_TRUNCATION),
+                 errmsg("postfga: %s is too long", name),
+                 errdetail("At most %zu bytes are allowed.", max_len - 1)));
+
+    return text_to_cstring(value);
+}
+
+/* StreamedListObjects 를 BGW 에 맡기고 결과가 저장된 list cache 엔트리를 읽는다 */
+static void request_list(const FgaTuple* tuple, const FgaListCacheKey* key, bool overlay, char** data, uint32* len)
+{
+    FgaConfig* config = fga_get_config();
+    FgaChannelSlot* slot = fga_channel_acquire_slot();
+    FgaRequest* request = &slot->payload.request;
+    const FgaResponse* response = &slot->payload.response;
+    FgaListObjectsResponse result;
+
+    request->type = FGA_REQUEST_LIST;
+    strlcpy(request->store_id, config->store_id, sizeof(request->store_id));
+    if (config->model_id != NULL)
+        strlcpy(request->model_id, config->model_id, sizeof(request->model_id));
+
+    request->body.listObjects.tuple = *tuple;
+    fga_list_cache_hint(key, !overlay, &request->body.listObjects.cache);
+    if (overlay)
+    {
+        request->flags |= FGA_REQUEST_FLAG_HIGHER_CONSISTENCY;
+        fga_overlay_contextual(request->store_id, &request->body.listObjects.contextual);
+    }
+
+    fga_channel_execute_slot(slot);
+
+    if (response->status != FGA_RESPONSE_OK)
+    {
+        char message[FGA_RESPONSE_ERROR_MESSAGE_LEN];
+
+        strlcpy(message, response->error_message, sizeof(message));
+        fga_channel_release_slot(slot);
+        ereport(ERROR, errmsg("postfga: list objects failed - %s", message));
+    }
+
+    result = response->body.listObjects;
+    fga_channel_release_slot(slot);
+
+    /*
+     * 응답 후 읽기 전에 다른 결과가 같은 ring 구간이나 엔트리를 덮어쓴 경우.
+     * 공유 결과면 같은 key 의 더 새 결과가 저장된 것일 수 있으므로 key 로 한 번 더 찾는다.
+     */
+    if (!fga_list_cache_fetch(result.entry, result.serial, data, len) &&
+        (overlay || !fga_list_cache_lookup(key, data, len)))
+        ereport(ERROR,
+                (errcode(ERRCODE_OUT_OF_MEMORY),
+                 errmsg("postfga: list objects result was evicted before it was read"),
+                 errhint("Increase fga.list_cache_size.")));
+}
+
+/*
+ * fga_list_objects(object_type, relation, subject_type, subject_id) RETURNS SETOF text
+ * object_type 을 뺀 id 를 정렬된 순서로 돌려준다.
+ */
+Datum fga_list_objects(PG_FUNCTION_ARGS)
+{
+    ReturnSetInfo* rsinfo = (ReturnSetInfo*)fcinfo->resultinfo;
+    FgaConfig* config = fga_get_config();
+    FgaTuple tuple;
+    FgaListCacheKey key;
+    FgaListCursor* cursor;
+    char* data;
+    uint32 len;
+    bool overlay;
+
+    if (config->store_id == NULL || config->store_id[0] == '\0')
+        ereport(ERROR, errmsg("postfga: store_id is not configured"));
+    if (config->list_cache_size == 0)
+        ereport(ERROR,
+                (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+                 errmsg("postfga: fga_list_objects is disabled"),
+                 errhint("Set fga.list_cache_size to a non-zero value and restart the server.")));
+
+    MemSet(&tuple, 0, sizeof(tuple));
+    strlcpy(tuple.object_type, read_arg(fcinfo, 0, "object_type", OBJECT_TYPE_MAX_LEN), sizeof(tuple.object_type));
+    strlcpy(tuple.relation, read_arg(fcinfo, 1, "relation", RELATION_MAX_LEN), sizeof(tuple.relation));
+    strlcpy(tuple.subject_type, read_arg(fcinfo, 2, "subject_type", SUBJECT_TYPE_MAX_LEN), sizeof(tuple.subject_type));
+    strlcpy(tuple.subject_id, read_arg(fcinfo, 3, "subject_id", SUBJECT_ID_MAX_LEN), sizeof(tuple.subject_id));
+
+    InitMaterializedSRF(fcinfo, 0);
+
+    fga_list_cache_key(
+        &key, config->store_id, config->model_id, tuple.object_type, tuple.relation, tuple.subject_type, tuple.subject_id);
+
+    overlay = fga_overlay_active(config->store_id);
+    if (overlay || !fga_list_cache_lookup(&key, &data, &len))
+        request_list(&tuple, &key, overlay, &data, &len);
+
+    cursor = (FgaListCursor*)palloc(sizeof(FgaListCursor));
+    fga_list_cursor_init(cursor, data, len);
+    while (fga_list_cursor_next(cursor))
+    {
+        Datum value = PointerGetDatum(cstring_to_text_with_len(cursor->id, cursor->len));
+        bool isnull = false;
+
+        tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, &value, &isnull);
+    }
+
+    return (Datum)0;
+}
@@ -10,6 +10,7 @@
 #include <miscadmin.h>
 #include <utils/builtins.h>
 
+#include "payload.h"
 #include "state.h"
 #include "stats.h"
 
@@ -30,7 +31,8 @@ static void backend_stats(Tuplestorestate* tupstore, TupleDesc tupdesc)
     FgaStats* stats = fga_get_stats();
 
     uint64 cache_l1_hits = 0, cache_l1_misses = 0, cache_l1_evictions = 0;
-    uint64 cache_l2_hits = 0, cache_l2_misses = 0, cache_l2_evictions = 0;
+    uint64 cache_l2_hits = 0, cache_l2_misses = 0, cache_l2_evictions = 0, cache_l2_refreshes = 0;
+    uint64 cache_l2_admission_rejects = 0;
     uint64 check_calls = 0, check_allowed = 0, check_denied = 0;
     uint64 rpc_calls = 0, rpc_errors = 0, rpc_latency_sum = 0;
 
@@ -44,6 +46,8 @@ static void backend_stats(Tuplestorestate* tupstore, TupleDesc tupdesc)
         cache_l2_hits += b->cache_l2_hits;
         cache_l2_misses += b->cache_l2_misses;
         cache_l2_evictions += b->cache_l2_evictions;
+        cache_l2_refreshes += b->cache_l2_refreshes;
+        cache_l2_admission_rejects += b->cache_l2_admission_rejects;
 
         check_calls += b->check_calls;
         check_allowed += b->check_allowed;
@@ -59,6 +63,8 @@ static void backend_stats(Tuplestorestate* tupstore, TupleDesc tupdesc)
     add_row(tupstore, tupdesc, "cache.l2", "hits", cache_l2_hits);
     add_row(tupstore, tupdesc, "cache.l2", "misses", cache_l2_misses);
     add_row(tupstore, tupdesc, "cache.l2", "evictions", cache_l2_evictions);
+    add_row(tupstore, tupdesc, "cache.l2", "refreshes", cache_l2_refreshes);
+    add_row(tupstore, tupdesc, "cache.l2", "admission_rejects", cache_l2_admission_rejects);
 
     add_row(tupstore, tupdesc, "check", "calls", check_calls);
     add_row(tupstore, tupdesc, "check", "allowed", check_allowed);
@@ -68,6 +74,34 @@ static void backend_stats(Tuplestorestate* tupstore, TupleDesc tupdesc)
     add_row(tupstore, tupdesc, "rpc", "latency_sum_us", rpc_latency_sum);
 }
 
+static void grpc_channel_stats(Tuplestorestate* tupstore, TupleDesc tupdesc)
+{
+    FgaStats* stats = fga_get_stats();
+    uint32 count = pg_atomic_read_u32(&stats->grpc_channel_count);
+    char section[32];
+
+    for (uint32 i = 0; i < count && i < FGA_GRPC_CHANNELS_MAX; i++)
+    {
+        FgaGrpcChannelStats* ch = &stats->grpc_channels[i];
+
+        snprintf(section, sizeof(section), "grpc.channel.%u", i);
+        add_row(tupstore, tupdesc, section, "calls", pg_atomic_read_u64(&ch->calls));
+        add_row(tupstore, tupdesc, section, "errors", pg_atomic_read_u64(&ch->errors));
+        add_row(tupstore, tupdesc, section, "inflight", pg_atomic_read_u32(&ch->inflight));
+        add_row(tupstore, tupdesc, section, "state", pg_atomic_read_u32(&ch->state));
+    }
+}
+
+static void change_feed_stats(Tuplestorestate* tupstore, TupleDesc tupdesc)
+{
+    FgaChangeFeedStats* feed = &fga_get_stats()->change_feed;
+
+    add_row(tupstore, tupdesc, "change_feed", "polls", pg_atomic_read_u64(&feed->polls));
+    add_row(tupstore, tupdesc, "change_feed", "changes", pg_atomic_read_u64(&feed->changes));
+    add_row(tupstore, tupdesc, "change_feed", "errors", pg_atomic_read_u64(&feed->errors));
+    add_row(tupstore, tupdesc, "change_feed", "resets", pg_atomic_read_u64(&feed->resets));
+}
+
 PG_FUNCTION_INFO_V1(fga_stats);
 
 Datum fga_stats(PG_FUNCTION_ARGS)
@@ -103,5 +137,186 @@ Datum fga_stats(PG_FUNCTION_ARGS)
     /* 4) backend별 통계 합산 */
     backend_stats(tupstore, tupdesc);
 
+    /* 5) gRPC 채널별 통계 */
+    grpc_channel_stats(tupstore, tupdesc);
+
+    /* 6) ReadChanges 기반 무효화 */
+    change_feed_stats(tupstore, tupdesc);
+
+    return (Datum)0;
+}
+
+PG_FUNCTION_INFO_V1(fga_backend_stats);
+
+/*
+ * L1 을 할당한 백엔드별 메모리와 hit 률.
+ * 다른 백엔드가 갱신 중인 값을 잠금 없이 읽으므로 행 안의 값끼리 약간 어긋날 수 있다.
+ */
+Datum fga_backend_stats(PG_FUNCTION_ARGS)
+{
+    ReturnSetInfo* rsinfo = (ReturnSetInfo*)fcinfo->resultinfo;
+    FgaStats* stats = fga_get_stats();
+
+    InitMaterializedSRF(fcinfo, 0);
+
+    for (int i = 0; i < MaxBackends; i++)
+    {
+        FgaBackendStats* b = &stats->backends[i];
+        int32 pid = b->l1_pid;
+        uint64 hits;
+        uint64 misses;
+        Datum values[8];
+        bool nulls[8] = {false};
+
+        if (pid == 0)
+            continue;
+
+        pg_read_barrier();
+        hits = b->l1_hits;
+        misses = b->l1_misses;
+
+        values[0] = Int32GetDatum(pid);
+        values[1] = Int64GetDatum(b->l1_entries);
+        values[2] = Int32GetDatum(b->l1_ways);
+        values[3] = Int64GetDatum(b->l1_bytes);
+        values[4] = Int64GetDatum(hits);
+        values[5] = Int64GetDatum(misses);
+        values[6] = Int64GetDatum(b->l1_evictions);
+        if (hits + misses > 0)
+            values[7] = Float8GetDatum((double)hits / (double)(hits + misses));
+        else
+            nulls[7] = true;
+
+        tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+    }
+
+    return (Datum)0;
+}
+
+static const char* request_type_name(int type)
+{
+    switch (type)
+    {
+    case FGA_REQUEST_CHECK:
+        return "check";
+    case FGA_REQUEST_READ:
+        return "read";
+    case FGA_REQUEST_WRITE_TUPLE:
+        return "write_tuple";
+    case FGA_REQUEST_DELETE_TUPLE:
+        return "delete_tuple";
+    case FGA_REQUEST_LIST:
+        return "list";
+    case FGA_REQUEST_GET_STORE:
+        return "get_store";
+    case FGA_REQUEST_CREATE_STORE:
+        return "create_store";
+    case FGA_REQUEST_DELETE_STORE:
+        return "delete_store";
+    case FGA_REQUEST_CHECK_RELATIONS:
+        return "check_relations";
+    default:
+        return "unknown";
+    }
+}
+
+static const char* const latency_stage_names[FGA_LATENCY_STAGES] = {
+    "queue",
+    "dispatch",
+    "rpc",
+    "wakeup",
+    "total",
+};
+
+PG_FUNCTION_INFO_V1(fga_latency);
+
+/*
+ * 요청 타입 x 단계별 지연 시간 분포 (us)
+ * percentile 값은 해당 버킷의 상한이므로 최대 ~12.5% 과대 추정된다.
+ */
+Datum fga_latency(PG_FUNCTION_ARGS)
+{
+    ReturnSetInfo* rsinfo = (ReturnSetInfo*)fcinfo->resultinfo;
+    FgaStats* stats = fga_get_stats();
+
+    InitMaterializedSRF(fcinfo, 0);
+
+    for (int type = 1; type < FGA_LATENCY_REQUEST_TYPES; type++)
+    {
+        for (int stage = 0; stage < FGA_LATENCY_STAGES; stage++)
+        {
+            FgaLatencyHistogram* hist = &stats->latency[type][stage];
+            uint64 count = pg_atomic_read_u64(&hist->count);
+            Datum values[9];
+            bool nulls[9] = {false};
+
+            if (count == 0)
+                continue;
+
+            values[0] = CStringGetTextDatum(request_type_name(type));
+            values[1] = CStringGetTextDatum(latency_stage_names[stage]);
+            values[2] = Int64GetDatum(count);
+            values[3] = Float8GetDatum((double)pg_atomic_read_u64(&hist->sum_us) / (double)count);
+            values[4] = Int64GetDatum(fga_stats_latency_percentile(hist, 0.50));
+            values[5] = Int64GetDatum(fga_stats_latency_percentile(hist, 0.95));
+            values[6] = Int64GetDatum(fga_stats_latency_percentile(hist, 0.99));
+            values[7] = Int64GetDatum(fga_stats_latency_percentile(hist, 0.999));
+            values[8] = Int64GetDatum(pg_atomic_read_u64(&hist->max_us));
+
+            tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+        }
+    }
+
+    return (Datum)0;
+}
+
+static void put_offset(Datum* value, bool* isnull, uint64 base, uint64 at)
+{
+    if (base == 0 || at == 0)
+    {
+        *isnull = true;
+        return;
+    }
+    *value = Int64GetDatum(fga_elapsed_us(base, at));
+}
+
+PG_FUNCTION_INFO_V1(fga_trace_recent);
+
+/*
+ * 샘플링된 최근 요청 타임라인 (최신 순).
+ * 각 시각은 슬롯 확보(acquire) 기준 경과 us 이며, 기록되지 않은 단계는 NULL.
+ */
+Datum fga_trace_recent(PG_FUNCTION_ARGS)
+{
+    ReturnSetInfo* rsinfo = (ReturnSetInfo*)fcinfo->resultinfo;
+    uint64 next = pg_atomic_read_u64(&fga_get_stats()->trace_next);
+    uint64 oldest = next > FGA_TRACE_RING_SIZE ? next - FGA_TRACE_RING_SIZE : 0;
+
+    InitMaterializedSRF(fcinfo, 0);
+
+    for (uint64 pos = next; pos > oldest; pos--)
+    {
+        FgaTraceRecord r;
+        Datum values[11];
+        bool nulls[11] = {false};
+
+        if (!fga_stats_trace_read(pos - 1, &r))
+            continue;
+
+        values[0] = Int64GetDatum(r.request_id);
+        values[1] = CStringGetTextDatum(request_type_name(r.request_type));
+        values[2] = Int32GetDatum(r.backend_pid);
+        values[3] = Int32GetDatum(r.status);
+        put_offset(&values[4], &nulls[4], r.acquire_us, r.enqueue_us);
+        put_offset(&values[5], &nulls[5], r.acquire_us, r.drain_us);
+        put_offset(&values[6], &nulls[6], r.acquire_us, r.rpc_start_us);
+        put_offset(&values[7], &nulls[7], r.acquire_us, r.rpc_end_us);
+        put_offset(&values[8], &nulls[8], r.acquire_us, r.complete_us);
+        put_offset(&values[9], &nulls[9], r.acquire_us, r.wake_us);
+        values[10] = Int64GetDatum(fga_elapsed_us(r.acquire_us, r.wake_us));
+
+        tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+    }
+
     return (Datum)0;
 }
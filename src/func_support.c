@@ -0,0 +1,153 @@
+/*-------------------------------------------------------------------------
+ *
+ * func_support.c
+ *    Planner support function for fga_check.
+ *
+ * fga_check 의 선언 COST 는 매번 RPC 를 가정한 고정값이고 selectivity 는 기본값 (1/3) 이다.
+ * 캐시가 대부분을 푸는 환경에서는 비용을, 허용 비율이 치우친 relation 에서는 행 수를 잘못 본다.
+ *
+ *   cost        : L1/L2 hit ratio 와 check 의 평균 왕복 시간 (FgaStats) 으로 한 번의 기대 시간을 구해 환산
+ *   selectivity : relation 별로 관측한 허용 비율 (object_type/relation 인자가 상수일 때)
+ *
+ * planner 는 qual 을 비용 순서로 평가하므로, 더 싼 qual 이 먼저 행을 거른 뒤에 fga_check 가 불린다.
+ * 표본이 적으면 NULL 을 돌려 선언된 COST 와 기본 selectivity 를 쓴다.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <postgres.h>
+
+#include <fmgr.h>
+#include <miscadmin.h>
+#include <nodes/supportnodes.h>
+#include <optimizer/cost.h>
+#include <utils/builtins.h>
+#include <utils/selfuncs.h>
+
+#include "payload.h"
+#include "relation.h"
+#include "state.h"
+#include "stats.h"
+
+PG_FUNCTION_INFO_V1(fga_check_support);
+
+/* 이보다 적게 관측했으면 추정하지 않는다 */
+#define SUPPORT_MIN_SAMPLES 100
+
+/* 백엔드별 통계 합계를 다시 읽는 간격 (planner 는 qual 마다 부르므로 매번 MaxBackends 를 훑지 않는다) */
+#define SUPPORT_REFRESH_US (1000 * 1000)
+
+/* 캐시 조회 한 번의 대략적인 시간 (us) */
+#define SUPPORT_L1_US 0.5
+#define SUPPORT_L2_US 2.0
+
+/* cpu_operator_cost 하나에 해당한다고 보는 시간 (us). 내장 연산자 한 번 정도 */
+#define SUPPORT_OPERATOR_US 0.05
+
+static double expected_us = -1.0; /* 음수 = 추정 불가 */
+static uint64 expected_at_us = 0;
+
+static void sum_latency(FgaLatencyHistogram* hist, uint64* count, uint64* sum_us)
+{
+    *count += pg_atomic_read_u64(&hist->count);
+    *sum_us += pg_atomic_read_u64(&hist->sum_us);
+}
+
+/*
+ * check 한 번의 기대 시간 (us)
+ *   L1 + (1 - L1 hit) * (L2 + (1 - L2 hit) * 왕복)
+ * 왕복은 enqueue 부터 백엔드가 깨어날 때까지 (큐 대기와 BatchCheck 묶음 포함)
+ */
+static double estimate_check_us(void)
+{
+    FgaStats* stats = fga_get_stats();
+    uint64 l1_hits = 0, l1_misses = 0, l2_hits = 0, l2_misses = 0;
+    uint64 rpc_count = 0, rpc_sum_us = 0;
+    double l1_miss_ratio, l2_miss_ratio;
+
+    if (stats == NULL)
+        return -1.0;
+
+    for (int i = 0; i < MaxBackends; i++)
+    {
+        FgaBackendStats* b = &stats->backends[i];
+
+        l1_hits += b->cache_l1_hits;
+        l1_misses += b->cache_l1_misses;
+        l2_hits += b->cache_l2_hits;
+        l2_misses += b->cache_l2_misses;
+    }
+
+    sum_latency(&stats->latency[FGA_REQUEST_CHECK][FGA_LATENCY_TOTAL], &rpc_count, &rpc_sum_us);
+    sum_latency(&stats->latency[FGA_REQUEST_CHECK_RELATIONS][FGA_LATENCY_TOTAL], &rpc_count, &rpc_sum_us);
+
+    if (l1_hits + l1_misses < SUPPORT_MIN_SAMPLES || rpc_count == 0)
+        return -1.0;
+
+    l1_miss_ratio = (double)l1_misses / (double)(l1_hits + l1_misses);
+    l2_miss_ratio = (l2_hits + l2_misses) > 0 ? (double)l2_misses / (double)(l2_hits + l2_misses) : 1.0;
+
+    return SUPPORT_L1_US + l1_miss_ratio * (SUPPORT_L2_US + l2_miss_ratio * ((double)rpc_sum_us / (double)rpc_count));
+}
+
+static double current_check_us(void)
+{
+    uint64 now = fga_clock_us();
+
+    if (expected_at_us == 0 || now - expected_at_us >= SUPPORT_REFRESH_US)
+    {
+        expected_us = estimate_check_us();
+        expected_at_us = now;
+    }
+    return expected_us;
+}
+
+/* 상수 text 인자 (아니면 NULL) */
+static char* const_text(List* args, int n)
+{
+    Node* arg;
+
+    if (list_length(args) <= n)
+        return NULL;
+
+    arg = (Node*)list_nth(args, n);
+    if (!IsA(arg, Const) || ((Const*)arg)->constisnull)
+        return NULL;
+
+    return TextDatumGetCString(((Const*)arg)->constvalue);
+}
+
+Datum fga_check_support(PG_FUNCTION_ARGS)
+{
+    Node* rawreq = (Node*)PG_GETARG_POINTER(0);
+
+    if (IsA(rawreq, SupportRequestCost))
+    {
+        SupportRequestCost* req = (SupportRequestCost*)rawreq;
+        double us = current_check_us();
+
+        if (us < 0)
+            PG_RETURN_POINTER(NULL);
+
+        req->startup = 0;
+        req->per_tuple = us / SUPPORT_OPERATOR_US * cpu_operator_cost;
+        PG_RETURN_POINTER(req);
+    }
+
+    if (IsA(rawreq, SupportRequestSelectivity))
+    {
+        SupportRequestSelectivity* req = (SupportRequestSelectivity*)rawreq;
+        double ratio;
+
+        /* fga_check(object_type, object_id, subject_type, subject_id, relation[, options]) */
+        if (!fga_relation_allow_ratio(
+                const_text(req->args, 0), const_text(req->args, 4), SUPPORT_MIN_SAMPLES, &ratio))
+            PG_RETURN_POINTER(NULL);
+
+        req->selectivity = ratio;
+        CLAMP_PROBABILITY(req->selectivity);
+        PG_RETURN_POINTER(req);
+    }
+
+    PG_RETURN_POINTER(NULL);
+}
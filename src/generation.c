@@ -0,0 +1,85 @@
+/*-------------------------------------------------------------------------
+ *
+ * generation.c
+ *    Generation tracking for cache invalidation.
+ *
+ * 모든 카운터는 atomic 이므로 락이 없다. bump 는 fetch_add 한 번이다.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <postgres.h>
+
+#include "generation.h"
+#include "state.h"
+
+static inline FgaGenerationTable* generation_table(void)
+{
+    return fga_get_state()->generations;
+}
+
+static inline pg_atomic_uint32* object_slot(FgaGenerationTable* table, uint64 object_key)
+{
+    /* object_key 는 XXH3 해시이므로 하위 비트를 그대로 슬롯 번호로 사용 */
+    return &table->objects[object_key & table->mask];
+}
+
+static inline pg_atomic_uint32* subject_slot(FgaGenerationTable* table, uint64 subject_key)
+{
+    return &table->subjects[subject_key & table->mask];
+}
+
+/*-------------------------------------------------------------------------
+ * Shared memory
+ *-------------------------------------------------------------------------*/
+Size fga_generation_shmem_size(void)
+{
+    StaticAssertDecl((DEFAULT_GEN_MAP_SIZE & (DEFAULT_GEN_MAP_SIZE - 1)) == 0,
+                     "DEFAULT_GEN_MAP_SIZE must be power of two");
+
+    /* objects[] 와 subjects[] */
+    return add_size(offsetof(FgaGenerationTable, objects), mul_size(sizeof(pg_atomic_uint32), 2 * DEFAULT_GEN_MAP_SIZE));
+}
+
+void fga_generation_shmem_init(FgaGenerationTable* table)
+{
+    table->mask = DEFAULT_GEN_MAP_SIZE - 1;
+    table->subjects = &table->objects[DEFAULT_GEN_MAP_SIZE];
+    pg_atomic_init_u32(&table->global, 0);
+
+    for (uint32 i = 0; i < DEFAULT_GEN_MAP_SIZE; i++)
+    {
+        pg_atomic_init_u32(&table->objects[i], 0);
+        pg_atomic_init_u32(&table->subjects[i], 0);
+    }
+}
+
+/*-------------------------------------------------------------------------
+ * Public API
+ *-------------------------------------------------------------------------*/
+void fga_generation_snapshot(uint64 object_key, uint64 subject_key, FgaGenerationSnapshot* snapshot)
+{
+    FgaGenerationTable* table = generation_table();
+
+    snapshot->global = pg_atomic_read_u32(&table->global);
+    snapshot->object = pg_atomic_read_u32(object_slot(table, object_key));
+    snapshot->subject = pg_atomic_read_u32(subject_slot(table, subject_key));
+}
+
+void fga_generation_bump_global(void)
+{
+    pg_atomic_fetch_add_u32(&generation_table()->global, 1);
+}
+
+void fga_generation_bump_object(uint64 object_key)
+{
+    FgaGenerationTable* table = generation_table();
+
+    pg_atomic_fetch_add_u32(object_slot(table, object_key), 1);
+}
+
+void fga_generation_bump_subject(uint64 subject_key)
+{
+    FgaGenerationTable* table = generation_table();
+
+    pg_atomic_fetch_add_u32(subject_slot(table, subject_key), 1);
+}
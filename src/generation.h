@@ -0,0 +1,66 @@
+/*-------------------------------------------------------------------------
+ *
+ * generation.h
+ *    Generation tracking for cache invalidation.
+ *
+ * 캐시 엔트리는 저장 시점의 generation 을 함께 기록하고, 조회 시 현재 값과
+ * 다르면 lazy 하게 무효로 본다.
+ *   - global  : store 전체 (모델 변경, 전이적 관계 등)
+ *   - object  : object_key(store + object_type + object_id) 해시 슬롯별
+ *   - subject : subject_key(store + subject_type + subject_id) 해시 슬롯별 (fga_cache_invalidate)
+ *
+ * object/subject 슬롯은 고정 크기 테이블이라 서로 다른 object 가 같은 슬롯을 공유할 수
+ * 있다. 이 경우 불필요한 무효화가 생길 뿐 잘못된 hit 는 생기지 않는다.
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef FGA_GENERATION_H
+#define FGA_GENERATION_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <postgres.h>
+
+#include <port/atomics.h>
+
+#include "postfga.h"
+
+    typedef struct FgaGenerationTable
+    {
+        pg_atomic_uint32 global;
+        uint32 mask;                /* DEFAULT_GEN_MAP_SIZE - 1 */
+        pg_atomic_uint32* subjects; /* [DEFAULT_GEN_MAP_SIZE], objects[] 바로 뒤 */
+        pg_atomic_uint32 objects[FLEXIBLE_ARRAY_MEMBER];
+    } FgaGenerationTable;
+
+    /* 캐시 조회 시점의 generation 스냅샷 */
+    typedef struct FgaGenerationSnapshot
+    {
+        uint32 global;
+        uint32 object;
+        uint32 subject;
+    } FgaGenerationSnapshot;
+
+    Size fga_generation_shmem_size(void);
+    void fga_generation_shmem_init(FgaGenerationTable* table);
+
+    /* 슬롯 번호는 key 의 하위 비트이므로 object_key/subject_key 대신 슬롯 번호를 넘겨도 같다 */
+    void fga_generation_snapshot(uint64 object_key, uint64 subject_key, FgaGenerationSnapshot* snapshot);
+
+    void fga_generation_bump_global(void);
+    void fga_generation_bump_object(uint64 object_key);
+    void fga_generation_bump_subject(uint64 subject_key);
+
+    static inline bool fga_generation_equals(const FgaGenerationSnapshot* a, const FgaGenerationSnapshot* b)
+    {
+        return a->global == b->global && a->object == b->object && a->subject == b->subject;
+    }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FGA_GENERATION_H */
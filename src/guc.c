@@ -17,7 +17,9 @@
 #include <string.h>
 #include <utils/guc.h>
 
+#include "cache_ttl.h"
 #include "config.h"
+#include "postfga.h"
 #include "relation.h"
 
 /* -------------------------------------------------------------------------
@@ -153,6 +155,65 @@ void fga_guc_init(void)
                             NULL,
                             NULL);
 
+    /* fga.max_relations */
+    DefineCustomIntVariable("fga.max_relations",
+                            "Maximum number of (object type, relation) pairs cached together per object and subject",
+                            "Relations are registered as they are first seen, up to 64 per object type. "
+                            "Relations beyond the limit are cached one entry per relation. 0 disables grouping.",
+                            &cfg->max_relations,
+                            256,
+                            0,
+                            4096,
+                            PGC_POSTMASTER,
+                            0,
+                            NULL,
+                            NULL,
+                            NULL);
+
+    /* fga.channel_arena_size */
+    DefineCustomIntVariable("fga.channel_arena_size",
+                            "Shared memory for check context and contextual tuples passed to the background worker",
+                            "Each check with a context or contextual_tuples option holds one 8kB block until it "
+                            "completes. 0 disables these options.",
+                            &cfg->channel_arena_size,
+                            1024,
+                            0,
+                            1024 * 1024,
+                            PGC_POSTMASTER,
+                            GUC_UNIT_KB,
+                            NULL,
+                            NULL,
+                            NULL);
+
+    /* fga.list_cache_size */
+    DefineCustomIntVariable("fga.list_cache_size",
+                            "Shared memory for fga_list_objects results",
+                            "Results are stored sorted and prefix-compressed; one result may use at most half of "
+                            "it. 0 disables fga_list_objects.",
+                            &cfg->list_cache_size,
+                            4096,
+                            0,
+                            1024 * 1024,
+                            PGC_POSTMASTER,
+                            GUC_UNIT_KB,
+                            NULL,
+                            NULL,
+                            NULL);
+
+    /* fga.list_cache_ttl_ms */
+    DefineCustomIntVariable("fga.list_cache_ttl_ms",
+                            "How long fga_list_objects results are reused",
+                            "Any tuple write or delete also invalidates them. 0 always calls StreamedListObjects.",
+                            &cfg->list_cache_ttl_ms,
+                            10000,
+                            0,
+                            3600000, /* max: 1 hour */
+                            PGC_SIGHUP,
+                            GUC_UNIT_MS,
+                            NULL,
+                            NULL,
+                            NULL);
+
     /* fga.cache_ttl_ms */
     DefineCustomIntVariable("fga.cache_ttl_ms",
                             "Cache entry time-to-live in milliseconds",
@@ -166,6 +227,194 @@ void fga_guc_init(void)
                             NULL,
                             NULL,
                             NULL);
+
+    /* fga.cache_refresh_window_ms */
+    DefineCustomIntVariable("fga.cache_refresh_window_ms",
+                            "Refresh cache entries in the background when a hit is this close to expiry",
+                            "The cached decision is returned immediately and the background worker re-checks it. "
+                            "Capped at half of fga.cache_ttl_ms. 0 disables background refresh.",
+                            &cfg->cache_refresh_window_ms,
+                            5000,
+                            0,
+                            1800000,
+                            PGC_SIGHUP,
+                            GUC_UNIT_MS,
+                            NULL,
+                            NULL,
+                            NULL);
+
+    /* fga.cache_ttl_policy */
+    DefineCustomStringVariable("fga.cache_ttl_policy",
+                               "Cache TTLs per relation, object type and allow/deny outcome",
+                               "Comma-separated rules target[:allow|:deny]=ttl, where target is type#relation, "
+                               "relation, type#* or * (e.g. 'owner:allow=1h, document#viewer=30s, *:deny=2s'). "
+                               "The most specific target wins. Unmatched decisions use fga.cache_ttl_ms; 0 disables "
+                               "caching. Also caps fga.cache_refresh_window_ms at half of the shortest TTL.",
+                               &cfg->cache_ttl_policy,
+                               "",
+                               PGC_SIGHUP,
+                               GUC_LIST_INPUT,
+                               fga_cache_ttl_policy_check,
+                               fga_cache_ttl_policy_assign,
+                               NULL);
+
+    /* fga.cache_transitive_types */
+    DefineCustomStringVariable("fga.cache_transitive_types",
+                               "Object types whose tuple writes invalidate the whole store cache",
+                               "Comma-separated list of object types referenced by other objects' relations "
+                               "(e.g. 'folder,group'). The default '*' treats every write as transitive; "
+                               "narrow it only when the model guarantees that writes on the other types "
+                               "affect no object but the written one.",
+                               &cfg->cache_transitive_types,
+                               "*",
+                               PGC_SIGHUP,
+                               GUC_LIST_INPUT,
+                               NULL,
+                               NULL,
+                               NULL);
+
+    /* fga.cache_prewarm */
+    DefineCustomBoolVariable("fga.cache_prewarm",
+                             "Persist the shared cache across restarts",
+                             "The background worker loads $PGDATA/postfga_cache.dump at startup "
+                             "and writes unexpired entries back at shutdown.",
+                             &cfg->cache_prewarm,
+                             true,
+                             PGC_SIGHUP,
+                             0,
+                             NULL,
+                             NULL,
+                             NULL);
+
+    /* fga.cache_dump_interval */
+    DefineCustomIntVariable("fga.cache_dump_interval",
+                            "Interval between periodic shared cache dumps",
+                            "Used when fga.cache_prewarm is on. 0 dumps only at shutdown.",
+                            &cfg->cache_dump_interval_s,
+                            300,
+                            0,
+                            INT_MAX / 1000,
+                            PGC_SIGHUP,
+                            GUC_UNIT_S,
+                            NULL,
+                            NULL,
+                            NULL);
+
+    /* fga.cache_admission */
+    DefineCustomBoolVariable("fga.cache_admission",
+                             "Admit new shared cache entries by estimated access frequency",
+                             "When the shared cache has to evict a live entry, the new decision replaces it only if "
+                             "it is looked up more often (TinyLFU). Keeps one-off scans from flushing hot entries.",
+                             &cfg->cache_admission,
+                             true,
+                             PGC_SIGHUP,
+                             0,
+                             NULL,
+                             NULL,
+                             NULL);
+
+    /* fga.l1_cache_entries */
+    DefineCustomIntVariable("fga.l1_cache_entries",
+                            "Number of entries in each backend's local cache",
+                            "Allocated on the first permission check of a session, rounded down to a power-of-two "
+                            "number of sets. Each entry takes about 73 bytes. 0 disables the local cache.",
+                            &cfg->l1_cache_entries,
+                            32768,
+                            0,
+                            1 << 22,
+                            PGC_BACKEND,
+                            0,
+                            NULL,
+                            NULL,
+                            NULL);
+
+    /* fga.l1_cache_ways */
+    DefineCustomIntVariable("fga.l1_cache_ways",
+                            "Associativity of each backend's local cache",
+                            NULL,
+                            &cfg->l1_cache_ways,
+                            16,
+                            1,
+                            16,
+                            PGC_BACKEND,
+                            0,
+                            NULL,
+                            NULL,
+                            NULL);
+
+    /* fga.changes_poll_interval_ms */
+    DefineCustomIntVariable("fga.changes_poll_interval_ms",
+                            "Interval between ReadChanges polls for cache invalidation",
+                            "The background worker reads tuple changes made outside PostgreSQL and invalidates "
+                            "the affected cache entries. 0 disables polling.",
+                            &cfg->changes_poll_interval_ms,
+                            0,
+                            0,
+                            3600000,
+                            PGC_SIGHUP,
+                            GUC_UNIT_MS,
+                            NULL,
+                            NULL,
+                            NULL);
+
+    /* fga.grpc_channels */
+    DefineCustomIntVariable("fga.grpc_channels",
+                            "Number of gRPC channels opened to OpenFGA",
+                            "Each channel owns its own HTTP/2 connection; requests go to the least loaded one.",
+                            &cfg->grpc_channels,
+                            1,
+                            1,
+                            FGA_GRPC_CHANNELS_MAX,
+                            PGC_SIGHUP,
+                            0,
+                            NULL,
+                            NULL,
+                            NULL);
+
+    /* fga.write_batch_size */
+    DefineCustomIntVariable("fga.write_batch_size",
+                            "Maximum number of tuples merged into one Write RPC",
+                            "Concurrent fga_write_tuple/fga_delete_tuple calls are coalesced up to this many tuples. "
+                            "Must not exceed the OpenFGA server's maxTuplesPerWrite.",
+                            &cfg->write_batch_size,
+                            100,
+                            1,
+                            1000,
+                            PGC_SIGHUP,
+                            0,
+                            NULL,
+                            NULL,
+                            NULL);
+
+    /* fga.check_batch_size */
+    DefineCustomIntVariable("fga.check_batch_size",
+                            "Number of rows whose fga_check quals are resolved together",
+                            "Scans filtered by fga_check(...) read this many rows ahead and send the checks that "
+                            "miss the cache as one batch. 0 disables batching (one round trip per row).",
+                            &cfg->check_batch_size,
+                            50,
+                            0,
+                            1000,
+                            PGC_USERSET,
+                            0,
+                            NULL,
+                            NULL,
+                            NULL);
+
+    /* fga.trace_sample_rate */
+    DefineCustomIntVariable("fga.trace_sample_rate",
+                            "Record the timeline of one in every N requests",
+                            "Sampled timelines are kept in a shared ring buffer and shown by fga_trace_recent(). "
+                            "0 disables tracing.",
+                            &cfg->trace_sample_rate,
+                            1000,
+                            0,
+                            INT_MAX,
+                            PGC_SUSET,
+                            0,
+                            NULL,
+                            NULL,
+                            NULL);
 }
 
 void fga_guc_fini(void)
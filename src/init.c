@@ -11,6 +11,7 @@
 #include <postmaster/bgworker.h>
 #include <storage/ipc.h>
 
+#include "batch_check.h"
 #include "bgw/bgw.h"
 #include "guc.h"
 #include "state.h"
@@ -54,6 +55,9 @@ void _PG_init(void)
     prev_shmem_startup_hook = shmem_startup_hook;
     shmem_startup_hook = fga_shmem_startup_hook;
 
+    // Wrap scans filtered by fga_check in the batched CustomScan
+    fga_batch_check_init();
+
     fga_bgw_init();
 
     ereport(DEBUG1, (errmsg("postfga: Extension initialized")));
@@ -64,6 +68,7 @@ void _PG_fini(void)
     ereport(LOG, (errmsg("postfga: Extension unloading")));
 
     fga_bgw_fini();
+    fga_batch_check_fini();
     fga_guc_fini();
 
     // Restore previous hooks so other extensions in the chain keep working
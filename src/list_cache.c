@@ -0,0 +1,431 @@
+/*-------------------------------------------------------------------------
+ *
+ * list_cache.c
+ *    Shared cache of fga_list_objects results for PostFGA extension.
+ *
+ * This module implements:
+ *   - Shared memory layout (entry directory + ring data area)
+ *   - Front-coded encoding of sorted id sets
+ *   - Lookup by key (TTL/generation checked) and by (entry, serial) for the requesting backend
+ *
+ * 엔트리 수가 작고 (데이터 8kB 당 하나) 조회는 SQL 호출 단위이므로 directory 는 선형으로 찾는다.
+ * 모든 접근은 lock 하나로 보호한다. BGW 는 결과 하나를 저장할 때만 exclusive 로 잡는다.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <postgres.h>
+
+#include <xxhash.h>
+
+#include "cache.h"
+#include "config.h"
+#include "generation.h"
+#include "list_cache.h"
+#include "state.h"
+#include "stats.h"
+
+/* 데이터 영역 8kB 당 엔트리 하나 */
+#define LIST_CACHE_BYTES_PER_ENTRY 8192
+#define LIST_CACHE_MIN_ENTRIES 16
+
+static inline FgaListCache* list_cache(void)
+{
+    return fga_get_state()->list_cache;
+}
+
+static uint32 entry_count_for(Size data_size)
+{
+    return (uint32)Max(LIST_CACHE_MIN_ENTRIES, data_size / LIST_CACHE_BYTES_PER_ENTRY);
+}
+
+/* -------------------------------------------------------------------------
+ * Shared memory
+ * -------------------------------------------------------------------------
+ */
+Size fga_list_cache_shmem_size(void)
+{
+    Size data_size = (Size)fga_get_config()->list_cache_size * 1024;
+    Size size;
+
+    if (data_size == 0)
+        return MAXALIGN(offsetof(FgaListCache, entries));
+
+    size = MAXALIGN(add_size(offsetof(FgaListCache, entries),
+                             mul_size(sizeof(FgaListCacheEntry), entry_count_for(data_size))));
+    return add_size(size, data_size);
+}
+
+void fga_list_cache_shmem_init(FgaListCache* cache, LWLock* lock)
+{
+    Size data_size = (Size)fga_get_config()->list_cache_size * 1024;
+
+    cache->lock = lock;
+    pg_atomic_init_u32(&cache->generation, 0);
+    cache->write_pos = 0;
+    cache->next_serial = 1;
+
+    if (data_size == 0)
+    {
+        cache->entry_count = 0;
+        cache->data_size = 0;
+        cache->data = NULL;
+        return;
+    }
+
+    cache->entry_count = entry_count_for(data_size);
+    cache->data_size = (uint32)data_size;
+    cache->data = (char*)cache +
+                  MAXALIGN(offsetof(FgaListCache, entries) + sizeof(FgaListCacheEntry) * cache->entry_count);
+    MemSet(cache->entries, 0, sizeof(FgaListCacheEntry) * cache->entry_count);
+}
+
+/* -------------------------------------------------------------------------
+ * Encoding
+ * -------------------------------------------------------------------------
+ */
+static inline uint32 varint_size(uint32 value)
+{
+    uint32 size = 1;
+
+    while (value >= 0x80)
+    {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+static inline char* put_varint(char* p, uint32 value)
+{
+    while (value >= 0x80)
+    {
+        *p++ = (char)((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    *p++ = (char)value;
+    return p;
+}
+
+static inline bool get_varint(const char** p, const char* end, uint32* value)
+{
+    uint32 result = 0;
+
+    for (int shift = 0; shift < 32 && *p < end; shift += 7)
+    {
+        uint8 byte = (uint8)**p;
+
+        (*p)++;
+
+        result |= (uint32)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline uint32 shared_prefix(const char* a, uint32 a_len, const char* b, uint32 b_len)
+{
+    uint32 n = Min(a_len, b_len);
+    uint32 i = 0;
+
+    while (i < n && a[i] == b[i])
+        i++;
+    return i;
+}
+
+/* 인코딩한 크기. FGA_LIST_ID_MAX_LEN 보다 긴 id 가 있으면 false */
+static bool encoded_size(const char* const* ids, const uint32* lens, uint32 count, uint32* size_out)
+{
+    const char* prev = NULL;
+    uint32 prev_len = 0;
+    uint64 size = 0;
+
+    for (uint32 i = 0; i < count; i++)
+    {
+        uint32 prefix;
+
+        if (lens[i] > FGA_LIST_ID_MAX_LEN)
+            return false;
+
+        prefix = prev != NULL ? shared_prefix(prev, prev_len, ids[i], lens[i]) : 0;
+        size += varint_size(prefix) + varint_size(lens[i] - prefix) + (lens[i] - prefix);
+        prev = ids[i];
+        prev_len = lens[i];
+    }
+
+    *size_out = size > PG_UINT32_MAX ? PG_UINT32_MAX : (uint32)size;
+    return true;
+}
+
+static void encode(char* out, const char* const* ids, const uint32* lens, uint32 count)
+{
+    const char* prev = NULL;
+    uint32 prev_len = 0;
+
+    for (uint32 i = 0; i < count; i++)
+    {
+        uint32 prefix = prev != NULL ? shared_prefix(prev, prev_len, ids[i], lens[i]) : 0;
+
+        out = put_varint(out, prefix);
+        out = put_varint(out, lens[i] - prefix);
+        memcpy(out, ids[i] + prefix, lens[i] - prefix);
+        out += lens[i] - prefix;
+        prev = ids[i];
+        prev_len = lens[i];
+    }
+}
+
+bool fga_list_cursor_next(FgaListCursor* cursor)
+{
+    uint32 prefix;
+    uint32 suffix;
+
+    if (cursor->pos >= cursor->end)
+        return false;
+
+    if (!get_varint(&cursor->pos, cursor->end, &prefix) || !get_varint(&cursor->pos, cursor->end, &suffix) ||
+        prefix > cursor->len || (uint64)prefix + suffix > FGA_LIST_ID_MAX_LEN ||
+        suffix > (uint32)(cursor->end - cursor->pos))
+        return false;
+
+    memcpy(cursor->id + prefix, cursor->pos, suffix);
+    cursor->pos += suffix;
+    cursor->len = prefix + suffix;
+    cursor->id[cursor->len] = '\0';
+    return true;
+}
+
+/* -------------------------------------------------------------------------
+ * Keys
+ * -------------------------------------------------------------------------
+ */
+static char* append_field(char* p, const char* str)
+{
+    size_t len = str != NULL ? strlen(str) : 0;
+
+    Assert(len <= 128);
+    *p++ = (uint8)len;
+    if (len > 0)
+        memcpy(p, str, len);
+    return p + len;
+}
+
+void fga_list_cache_key(FgaListCacheKey* key,
+                        const char* store_id,
+                        const char* model_id,
+                        const char* object_type,
+                        const char* relation,
+                        const char* subject_type,
+                        const char* subject_id)
+{
+    char buf[1024];
+    char* p = buf;
+    XXH128_hash_t h;
+
+    p = append_field(p, store_id);
+    p = append_field(p, model_id);
+    p = append_field(p, object_type);
+    p = append_field(p, relation);
+    p = append_field(p, subject_type);
+    p = append_field(p, subject_id);
+
+    h = XXH3_128bits(buf, p - buf);
+    key->low = h.low64;
+    key->high = h.high64;
+    key->subject_key =
+        fga_cache_subject_key(store_id, subject_type, strlen(subject_type), subject_id, strlen(subject_id));
+}
+
+void fga_list_cache_hint(const FgaListCacheKey* key, bool shared, FgaListCacheHint* hint)
+{
+    FgaGenerationSnapshot snapshot;
+
+    fga_generation_snapshot(0, key->subject_key, &snapshot);
+
+    hint->key_low = key->low;
+    hint->key_high = key->high;
+    hint->gen_global = snapshot.global;
+    hint->gen_subject = snapshot.subject;
+    hint->gen_list = pg_atomic_read_u32(&list_cache()->generation);
+    hint->shared = shared ? 1 : 0;
+}
+
+/* -------------------------------------------------------------------------
+ * Lookup / store
+ * -------------------------------------------------------------------------
+ */
+static void copy_out(const FgaListCache* cache, const FgaListCacheEntry* entry, char** data_out, uint32* len_out)
+{
+    char* data = (char*)palloc(Max(entry->length, 1));
+
+    memcpy(data, cache->data + entry->offset, entry->length);
+    *data_out = data;
+    *len_out = entry->length;
+}
+
+bool fga_list_cache_lookup(const FgaListCacheKey* key, char** data_out, uint32* len_out)
+{
+    FgaListCache* cache = list_cache();
+    FgaGenerationSnapshot snapshot;
+    uint32 gen_list;
+    uint64 now = fga_clock_us();
+    bool found = false;
+
+    if (cache->entry_count == 0 || fga_get_config()->list_cache_ttl_ms == 0)
+        return false;
+
+    fga_generation_snapshot(0, key->subject_key, &snapshot);
+    gen_list = pg_atomic_read_u32(&cache->generation);
+
+    /* 같은 key 라도 overlay 결과나 옛 generation 의 엔트리가 있을 수 있으므로 끝까지 본다 */
+    LWLockAcquire(cache->lock, LW_SHARED);
+    for (uint32 i = 0; i < cache->entry_count; i++)
+    {
+        FgaListCacheEntry* entry = &cache->entries[i];
+
+        if (entry->serial == 0 || !entry->shared || entry->key_low != key->low || entry->key_high != key->high)
+            continue;
+
+        if (entry->expires_us > now && entry->gen_global == snapshot.global &&
+            entry->gen_subject == snapshot.subject && entry->gen_list == gen_list)
+        {
+            copy_out(cache, entry, data_out, len_out);
+            found = true;
+            break;
+        }
+    }
+    LWLockRelease(cache->lock);
+
+    return found;
+}
+
+bool fga_list_cache_fetch(uint32 entry_index, uint64 serial, char** data_out, uint32* len_out)
+{
+    FgaListCache* cache = list_cache();
+    bool found = false;
+
+    if (entry_index >= cache->entry_count)
+        return false;
+
+    LWLockAcquire(cache->lock, LW_SHARED);
+    if (cache->entries[entry_index].serial == serial)
+    {
+        copy_out(cache, &cache->entries[entry_index], data_out, len_out);
+        found = true;
+    }
+    LWLockRelease(cache->lock);
+
+    return found;
+}
+
+/*
+ * 같은 key 의 공유 엔트리, 빈 엔트리, 가장 오래된 엔트리 순으로 고른다.
+ * overlay 결과는 그것을 요청한 백엔드가 아직 읽지 않았을 수 있으므로 key 로 재사용하지 않는다.
+ */
+static FgaListCacheEntry* choose_entry(FgaListCache* cache, const FgaListCacheHint* hint)
+{
+    FgaListCacheEntry* empty = NULL;
+    FgaListCacheEntry* oldest = &cache->entries[0];
+
+    for (uint32 i = 0; i < cache->entry_count; i++)
+    {
+        FgaListCacheEntry* entry = &cache->entries[i];
+
+        if (entry->serial == 0)
+        {
+            if (empty == NULL)
+                empty = entry;
+            continue;
+        }
+        if (hint->shared && entry->shared && entry->key_low == hint->key_low && entry->key_high == hint->key_high)
+            return entry;
+        if (entry->serial < oldest->serial)
+            oldest = entry;
+    }
+    return empty != NULL ? empty : oldest;
+}
+
+/* ring 에서 len bytes 를 잡고, 그 구간과 겹치는 엔트리를 버린다 */
+static uint32 reserve(FgaListCache* cache, uint32 len)
+{
+    uint32 start = cache->write_pos;
+    uint32 end;
+
+    if ((uint64)start + len > cache->data_size)
+        start = 0;
+    end = start + len;
+
+    for (uint32 i = 0; i < cache->entry_count; i++)
+    {
+        FgaListCacheEntry* entry = &cache->entries[i];
+
+        if (entry->serial != 0 && entry->offset < end && start < entry->offset + entry->length)
+            entry->serial = 0;
+    }
+
+    cache->write_pos = end;
+    return start;
+}
+
+uint32 fga_list_cache_max_bytes(void)
+{
+    FgaListCache* cache = list_cache();
+
+    return cache->entry_count == 0 ? 0 : cache->data_size / 2;
+}
+
+FgaListStoreResult fga_list_cache_store(const FgaListCacheHint* hint,
+                                        const char* const* ids,
+                                        const uint32* lens,
+                                        uint32 count,
+                                        uint32* entry_out,
+                                        uint64* serial_out)
+{
+    FgaListCache* cache = list_cache();
+    FgaListCacheEntry* entry;
+    uint32 len;
+    int ttl_ms = fga_get_config()->list_cache_ttl_ms;
+
+    if (!encoded_size(ids, lens, count, &len))
+        return FGA_LIST_STORE_ID_TOO_LONG;
+
+    if (cache->entry_count == 0 || len > fga_list_cache_max_bytes())
+        return FGA_LIST_STORE_TOO_LARGE;
+
+    LWLockAcquire(cache->lock, LW_EXCLUSIVE);
+
+    entry = choose_entry(cache, hint);
+    entry->serial = 0;
+
+    entry->offset = reserve(cache, len);
+    encode(cache->data + entry->offset, ids, lens, count);
+
+    entry->key_low = hint->key_low;
+    entry->key_high = hint->key_high;
+    entry->expires_us = (hint->shared && ttl_ms > 0) ? fga_clock_us() + (uint64)ttl_ms * 1000 : 0;
+    entry->gen_global = hint->gen_global;
+    entry->gen_subject = hint->gen_subject;
+    entry->gen_list = hint->gen_list;
+    entry->length = len;
+    entry->count = count;
+    entry->shared = hint->shared != 0;
+    entry->serial = cache->next_serial++;
+
+    *entry_out = (uint32)(entry - cache->entries);
+    *serial_out = entry->serial;
+
+    LWLockRelease(cache->lock);
+    return FGA_LIST_STORE_OK;
+}
+
+void fga_list_cache_bump(void)
+{
+    FgaListCache* cache = list_cache();
+
+    if (cache != NULL)
+        pg_atomic_fetch_add_u32(&cache->generation, 1);
+}
@@ -0,0 +1,137 @@
+/*-------------------------------------------------------------------------
+ *
+ * list_cache.h
+ *    Shared cache of fga_list_objects results for PostFGA extension.
+ *
+ * (store, model, object_type, relation, subject) 마다 object id 집합 하나를 둔다.
+ * id 는 정렬해서 앞 id 와 겹치는 prefix 를 빼고 저장한다 (front coding):
+ *   [varint 공유 prefix 길이][varint 나머지 길이][나머지 bytes] ...
+ * 같은 type 의 id 는 대개 prefix 가 길어서 (doc-2024-..., uuid 등) 원래 크기보다 훨씬 작다.
+ *
+ * 데이터 영역은 ring 이다. 새 결과는 write 위치에 이어 쓰고, 겹치는 옛 엔트리는 버린다 (FIFO).
+ * 엔트리는 fga.list_cache_ttl_ms 가 지나거나 global/subject generation 또는
+ * list generation (tuple 쓰기마다 올림: 어느 목록이 바뀌는지 알 수 없음) 이 바뀌면 무효다.
+ *
+ * BGW 는 StreamedListObjects 결과를 여기에 저장하고 엔트리 위치 (entry, serial) 만 응답하므로,
+ * 결과 크기가 슬롯과 상관없다. 백엔드는 그 위치로 TTL 과 상관없이 읽는다.
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef FGA_LIST_CACHE_H
+#define FGA_LIST_CACHE_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <postgres.h>
+
+#include <port/atomics.h>
+#include <storage/lwlock.h>
+
+#include "payload.h"
+
+    typedef enum FgaListStoreResult
+    {
+        FGA_LIST_STORE_OK = 0,
+        FGA_LIST_STORE_TOO_LARGE,  /* 인코딩 크기가 데이터 영역의 절반보다 큼 */
+        FGA_LIST_STORE_ID_TOO_LONG /* FGA_LIST_ID_MAX_LEN 보다 긴 id */
+    } FgaListStoreResult;
+
+    typedef struct FgaListCacheKey
+    {
+        uint64 low;
+        uint64 high;
+        uint64 subject_key; /* generation 슬롯 (fga_cache_subject_key) */
+    } FgaListCacheKey;
+
+    typedef struct FgaListCacheEntry
+    {
+        uint64 key_low;
+        uint64 key_high;
+        uint64 serial;      /* 0 = 빈 엔트리 */
+        uint64 expires_us;  /* fga_clock_us 기준 */
+        uint32 gen_global;
+        uint32 gen_subject;
+        uint32 gen_list;
+        uint32 offset;      /* data[] 안의 위치 */
+        uint32 length;      /* 인코딩된 bytes */
+        uint32 count;       /* id 수 */
+        bool shared;        /* false = overlay 결과: 요청한 백엔드만 (entry, serial) 로 읽고 key 로는 찾지 않는다 */
+    } FgaListCacheEntry;
+
+    typedef struct FgaListCache
+    {
+        LWLock* lock;
+        pg_atomic_uint32 generation; /* tuple 쓰기마다 올린다 */
+        uint32 entry_count;
+        uint32 data_size;
+        uint32 write_pos;
+        uint64 next_serial;
+        char* data; /* entries[entry_count] 바로 뒤 */
+        FgaListCacheEntry entries[FLEXIBLE_ARRAY_MEMBER];
+    } FgaListCache;
+
+    /* 인코딩된 id 집합을 차례로 읽는다 */
+    typedef struct FgaListCursor
+    {
+        const char* pos;
+        const char* end;
+        uint32 len;
+        char id[FGA_LIST_ID_MAX_LEN + 1];
+    } FgaListCursor;
+
+    Size fga_list_cache_shmem_size(void);
+    void fga_list_cache_shmem_init(FgaListCache* cache, LWLock* lock);
+
+    void fga_list_cache_key(FgaListCacheKey* key,
+                            const char* store_id,
+                            const char* model_id,
+                            const char* object_type,
+                            const char* relation,
+                            const char* subject_type,
+                            const char* subject_id);
+
+    /* 요청 전에 key 와 현재 generation 을 hint 에 담는다 (저장 시 요청 도중의 무효화 반영) */
+    void fga_list_cache_hint(const FgaListCacheKey* key, bool shared, FgaListCacheHint* hint);
+
+    /* 유효한 공유 엔트리를 찾으면 인코딩된 데이터를 palloc 해서 복사 */
+    bool fga_list_cache_lookup(const FgaListCacheKey* key, char** data_out, uint32* len_out);
+
+    /* BGW 가 응답한 (entry, serial) 의 데이터. 그 사이 다른 결과로 바뀌었으면 false */
+    bool fga_list_cache_fetch(uint32 entry, uint64 serial, char** data_out, uint32* len_out);
+
+    /* 한 결과의 인코딩 크기 상한 (데이터 영역의 절반, 꺼져 있으면 0) */
+    uint32 fga_list_cache_max_bytes(void);
+
+    /*
+     * BGW 에서 호출: 정렬되고 중복 없는 ids 를 인코딩해 저장 (palloc 하지 않음).
+     * 너무 크거나 긴 id 가 있으면 저장하지 않고 그 이유를 반환
+     */
+    FgaListStoreResult fga_list_cache_store(const FgaListCacheHint* hint,
+                                            const char* const* ids,
+                                            const uint32* lens,
+                                            uint32 count,
+                                            uint32* entry_out,
+                                            uint64* serial_out);
+
+    /* tuple 쓰기/삭제 (cache.c 의 무효화와 같은 시점): 모든 목록을 무효로 */
+    void fga_list_cache_bump(void);
+
+    static inline void fga_list_cursor_init(FgaListCursor* cursor, const char* data, uint32 len)
+    {
+        cursor->pos = data;
+        cursor->end = data + len;
+        cursor->len = 0;
+        cursor->id[0] = '\0';
+    }
+
+    /* 다음 id 를 cursor->id (NUL 종료) 에 채운다. 끝이거나 데이터가 깨졌으면 false */
+    bool fga_list_cursor_next(FgaListCursor* cursor);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FGA_LIST_CACHE_H */
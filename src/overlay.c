@@ -0,0 +1,130 @@
+/*-------------------------------------------------------------------------
+ *
+ * overlay.c
+ *    Per-transaction read-your-writes overlay for PostFGA extension.
+ *
+ * 트랜잭션 하나에서 쓰는 tuple 은 많지 않으므로 TopTransactionContext 의 List 를
+ * 뒤에서부터 훑는다. 같은 tuple 을 다시 쓰면 마지막 변경만 남긴다.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <postgres.h>
+
+#include <access/xact.h>
+#include <nodes/pg_list.h>
+#include <utils/memutils.h>
+
+#include "overlay.h"
+
+typedef struct OverlayTuple
+{
+    char store_id[OPENFGA_STORE_ID_LEN];
+    FgaTuple tuple;
+    bool deleted;
+} OverlayTuple;
+
+/* per-backend (TopTransactionContext 에 할당, 트랜잭션이 끝나면 NULL) */
+static List* overlay = NIL;
+static bool callback_registered = false;
+
+static void overlay_xact_callback(XactEvent event, void* arg)
+{
+    switch (event)
+    {
+    case XACT_EVENT_COMMIT:
+    case XACT_EVENT_PARALLEL_COMMIT:
+    case XACT_EVENT_ABORT:
+    case XACT_EVENT_PARALLEL_ABORT:
+    case XACT_EVENT_PREPARE:
+        /* 메모리는 TopTransactionContext 와 함께 해제된다 */
+        overlay = NIL;
+        break;
+    default:
+        break;
+    }
+}
+
+static bool same_tuple(const OverlayTuple* entry, const char* store_id, const FgaTuple* tuple)
+{
+    return strcmp(entry->store_id, store_id) == 0 && strcmp(entry->tuple.object_id, tuple->object_id) == 0 &&
+           strcmp(entry->tuple.object_type, tuple->object_type) == 0 &&
+           strcmp(entry->tuple.relation, tuple->relation) == 0 &&
+           strcmp(entry->tuple.subject_id, tuple->subject_id) == 0 &&
+           strcmp(entry->tuple.subject_type, tuple->subject_type) == 0;
+}
+
+static OverlayTuple* find(const char* store_id, const FgaTuple* tuple)
+{
+    ListCell* lc;
+
+    foreach (lc, overlay)
+    {
+        OverlayTuple* entry = (OverlayTuple*)lfirst(lc);
+
+        if (same_tuple(entry, store_id, tuple))
+            return entry;
+    }
+    return NULL;
+}
+
+void fga_overlay_record(const char* store_id, const FgaTuple* tuple, bool deleted)
+{
+    MemoryContext oldcontext;
+    OverlayTuple* entry;
+
+    if (!IsTransactionState())
+        return;
+
+    if (!callback_registered)
+    {
+        RegisterXactCallback(overlay_xact_callback, NULL);
+        callback_registered = true;
+    }
+
+    entry = find(store_id, tuple);
+    if (entry != NULL)
+    {
+        /* 최근 변경이 앞에 오도록 옮긴다 (contextual tuple 은 최근 것부터) */
+        overlay = list_delete_ptr(overlay, entry);
+    }
+    else
+    {
+        entry = (OverlayTuple*)MemoryContextAllocZero(TopTransactionContext, sizeof(OverlayTuple));
+        strlcpy(entry->store_id, store_id, sizeof(entry->store_id));
+        entry->tuple = *tuple;
+    }
+    entry->deleted = deleted;
+
+    oldcontext = MemoryContextSwitchTo(TopTransactionContext);
+    overlay = lcons(entry, overlay);
+    MemoryContextSwitchTo(oldcontext);
+}
+
+bool fga_overlay_active(const char* store_id)
+{
+    ListCell* lc;
+
+    foreach (lc, overlay)
+    {
+        if (strcmp(((OverlayTuple*)lfirst(lc))->store_id, store_id) == 0)
+            return true;
+    }
+    return false;
+}
+
+void fga_overlay_contextual(const char* store_id, FgaContextualTuples* out)
+{
+    ListCell* lc;
+
+    out->count = 0;
+    foreach (lc, overlay)
+    {
+        OverlayTuple* entry = (OverlayTuple*)lfirst(lc);
+
+        if (out->count >= FGA_CONTEXTUAL_TUPLES_MAX)
+            break;
+
+        if (!entry->deleted && strcmp(entry->store_id, store_id) == 0)
+            out->tuples[out->count++] = entry->tuple;
+    }
+}
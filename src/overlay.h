@@ -0,0 +1,35 @@
+/*-------------------------------------------------------------------------
+ *
+ * overlay.h
+ *    Per-transaction read-your-writes overlay for PostFGA extension.
+ *
+ * fga_write_tuple / fga_delete_tuple 이 성공하면 이 백엔드의 트랜잭션 안에서
+ * 기록한 tuple 을 남겨 둔다. 같은 트랜잭션의 fga_check 는 캐시를 읽지 않고,
+ * 쓴 tuple 을 contextual tuple 로 붙이고 HIGHER_CONSISTENCY 로 묻는다 (OpenFGA 복제 지연/서버 캐시를 피함).
+ * 방금 쓴 직접 관계와 같은 check 도 마찬가지다: exclusion (`but not`) 이나 intersection (`and`) 이 있는
+ * relation 은 직접 관계가 있어도 deny 일 수 있다.
+ * 트랜잭션이 끝나면 (commit/abort 모두) 비운다. OpenFGA 쓰기는 트랜잭션과 무관하게
+ * 이미 반영되어 있으므로, 이후 check 는 generation 으로 무효화된 캐시를 그대로 쓴다.
+ *
+ * 백엔드 로컬이므로 parallel worker 의 check 에는 보이지 않는다.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef FGA_OVERLAY_H
+#define FGA_OVERLAY_H
+
+#include <postgres.h>
+
+#include "payload.h"
+
+/* write/delete 성공 후 호출 */
+void fga_overlay_record(const char* store_id, const FgaTuple* tuple, bool deleted);
+
+/* 이 트랜잭션에서 store 에 write/delete 한 tuple 이 있는지 */
+bool fga_overlay_active(const char* store_id);
+
+/* 마지막 변경이 write 인 tuple 을 최근 것부터 out 에 채운다 (최대 FGA_CONTEXTUAL_TUPLES_MAX) */
+void fga_overlay_contextual(const char* store_id, FgaContextualTuples* out);
+
+#endif /* FGA_OVERLAY_H */
@@ -47,11 +47,47 @@ typedef enum FgaRequestType
     FGA_REQUEST_GET_STORE,
     FGA_REQUEST_CREATE_STORE,
     FGA_REQUEST_DELETE_STORE,
+    FGA_REQUEST_CHECK_RELATIONS,
 } FgaRequestType;
 
+/* FGA_REQUEST_CHECK_RELATIONS 한 번에 보내는 relation 수 (OpenFGA max_checks_per_batch_check 기본값) */
+#define FGA_CHECK_RELATIONS_MAX 50
+
+/* FgaRequest.flags */
+#define FGA_REQUEST_FLAG_DETACHED 0x0001           /* 기다리는 백엔드 없음: BGW 가 결과를 처리하고 슬롯을 반환 */
+#define FGA_REQUEST_FLAG_HIGHER_CONSISTENCY 0x0002 /* OpenFGA 서버 캐시도 건너뜀 (HIGHER_CONSISTENCY) */
+
+/*
+ * 백엔드 대신 BGW 가 check 결과를 L2 에 저장할 때 필요한 정보.
+ * FgaAclCacheKey 와 조회 시점 FgaGenerationSnapshot 의 사본 (cache.h 에 의존하지 않도록 풀어서 둔다)
+ */
+typedef struct FgaCacheStoreHint
+{
+    uint64_t key_low;
+    uint64_t key_high;
+    uint64_t object_key;
+    uint32_t subject_key;
+    uint32_t relation_id;
+    uint32_t grouped;
+    uint32_t gen_global;
+    uint32_t gen_object;
+    uint32_t gen_subject;
+} FgaCacheStoreHint;
+
+/* check 에 함께 보내는 contextual tuple (트랜잭션 안에서 방금 쓴 tuple, overlay.h) */
+#define FGA_CONTEXTUAL_TUPLES_MAX 8
+
+typedef struct FgaContextualTuples
+{
+    uint32_t count;
+    FgaTuple tuples[FGA_CONTEXTUAL_TUPLES_MAX];
+} FgaContextualTuples;
+
 typedef struct FgaCheckTupleRequest
 {
     FgaTuple tuple;
+    FgaCacheStoreHint cache; /* FGA_REQUEST_FLAG_DETACHED 일 때만 사용 */
+    FgaContextualTuples contextual;
 } FgaCheckTupleRequest;
 
 typedef struct FgaCheckTupleResponse
@@ -59,6 +95,62 @@ typedef struct FgaCheckTupleResponse
     bool allow;
 } FgaCheckTupleResponse;
 
+/*
+ * 같은 (object, subject) 의 여러 relation 을 BatchCheck 하나로 확인.
+ * relations 는 relation 레지스트리의 비트 번호 (BGW 가 이름으로 바꾼다).
+ * tuple.relation / relation_bit 는 호출자가 실제로 물은 relation.
+ */
+typedef struct FgaCheckRelationsRequest
+{
+    FgaTuple tuple;
+    uint64_t relations;
+    uint8_t relation_bit;
+    FgaCacheStoreHint cache; /* FGA_REQUEST_FLAG_DETACHED 일 때만 사용 */
+    FgaContextualTuples contextual;
+} FgaCheckRelationsRequest;
+
+typedef struct FgaCheckRelationsResponse
+{
+    uint64_t allowed;
+    uint64_t known; /* 결과를 받은 비트 (항목별 오류는 빠진다) */
+} FgaCheckRelationsResponse;
+
+/* "type:id" 에서 type 을 뺀 id 의 최대 길이 (이보다 긴 id 가 오면 fga_list_objects 가 실패) */
+#define FGA_LIST_ID_MAX_LEN 1024
+
+/*
+ * list cache 에 저장할 때 쓰는 key 와 조회 시점 generation (list_cache.h 에 의존하지 않도록 풀어서 둔다).
+ * shared 가 0 이면 이 요청만 읽는 결과 (overlay 의 contextual tuple 반영): 다른 조회에는 쓰지 않는다.
+ */
+typedef struct FgaListCacheHint
+{
+    uint64_t key_low;
+    uint64_t key_high;
+    uint32_t gen_global;
+    uint32_t gen_subject;
+    uint32_t gen_list;
+    uint32_t shared;
+} FgaListCacheHint;
+
+/*
+ * StreamedListObjects: subject 가 relation 을 갖는 object_type 의 object 전체 (tuple.object_id 는 비움).
+ * 결과는 크기 제한이 없어 슬롯에 담지 않는다. BGW 가 list cache 에 저장하고 그 엔트리 위치만 응답한다.
+ */
+typedef struct FgaListObjectsRequest
+{
+    FgaTuple tuple;
+    FgaListCacheHint cache;
+    FgaContextualTuples contextual;
+    uint32_t max_bytes; /* 인코딩 크기 상한 (list cache 한 엔트리 한도, BGW 가 채움): 넘으면 스트림을 끊는다 */
+} FgaListObjectsRequest;
+
+typedef struct FgaListObjectsResponse
+{
+    uint32_t entry;  /* list cache 엔트리 번호 */
+    uint32_t count;  /* object 수 */
+    uint64_t serial; /* 백엔드가 읽기 전에 다른 결과로 바뀌지 않았는지 확인 */
+} FgaListObjectsResponse;
+
 typedef struct FgaWriteTupleRequest
 {
     FgaTuple tuple;
@@ -115,17 +207,22 @@ typedef struct FgaRequest
 {
     uint64_t request_id; /* request identifier */
     uint16_t type;       /* FgaRequestType */
-    // uint16_t reserved;   /* alignment / flags 용 */
+    uint16_t flags;      /* FGA_REQUEST_FLAG_* */
+    uint32_t timeout_ms; /* RPC deadline, 0 = fga 기본값 */
+    uint32_t arena_block; /* 채널 arena 블록 번호 (arena_len > 0 일 때만) */
+    uint32_t arena_len;   /* arena 의 check context JSON 길이, 0 = 없음 */
     char store_id[OPENFGA_STORE_ID_LEN];
     char model_id[OPENFGA_MODEL_ID_LEN];
     union
     {
         FgaCheckTupleRequest checkTuple;
+        FgaCheckRelationsRequest checkRelations;
         FgaWriteTupleRequest writeTuple;
         FgaDeleteTupleRequest deleteTuple;
         FgaGetStoreRequest getStore;
         FgaCreateStoreRequest createStore;
         FgaDeleteStoreRequest deleteStore;
+        FgaListObjectsRequest listObjects;
         /* 나중에 추가 예정인 op 들도 여기에 계속 추가 */
     } body;
 } FgaRequest;
@@ -138,11 +235,13 @@ typedef struct FgaResponse
     union
     {
         FgaCheckTupleResponse checkTuple;
+        FgaCheckRelationsResponse checkRelations;
         FgaWriteTupleResponse writeTuple;
         FgaDeleteTupleResponse deleteTuple;
         FgaGetStoreResponse getStore;
         FgaCreateStoreResponse createStore;
         FgaDeleteStoreResponse deleteStore;
+        FgaListObjectsResponse listObjects;
     } body;
 } FgaResponse;
 
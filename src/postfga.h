@@ -14,6 +14,9 @@
 
 #define NAME_MAX_LEN 64
 
+/* Upper bound for fga.grpc_channels */
+#define FGA_GRPC_CHANNELS_MAX 16
+
 #define OPENFGA_STORE_ID_LEN 64
 #define OPENFGA_STORE_NAME_LEN 64
 #define OPENFGA_MODEL_ID_LEN 64
@@ -21,6 +24,6 @@
 /* Default hash table sizes */
 #define DEFAULT_RELATION_COUNT 16
 #define DEFAULT_CACHE_ENTRIES 10000
-#define DEFAULT_GEN_MAP_SIZE 1024
+#define DEFAULT_GEN_MAP_SIZE 65536 /* per-object generation slots (power of two) */
 
 #endif /* FGA_H */
\ No newline at end of file
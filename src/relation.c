@@ -4,183 +4,460 @@
  *    Relation bitmap operations for PostFGA extension.
  *
  * This module implements:
- *   - Relation name to bit index mapping
- *   - Relation registration
- *   - Relation bitmap initialization from GUC string
+ *   - Relation name to bit index mapping (per object type)
+ *   - Relation registration in shared memory
+ *   - Backend-local lookup cache
+ *   - Per-relation cache hit/miss and allow/deny counters
+ *
+ * 공유 레지스트리는 append-only 배열이다. 읽기는 락 없이 count 까지만 보고,
+ * 등록만 state lock 을 잡는다. 백엔드는 본 적 있는 항목을 로컬 해시에 두므로
+ * 조회마다 공유 메모리를 훑지 않는다.
  *
  *-------------------------------------------------------------------------
  */
 
 #include <postgres.h>
 
+#include <storage/ipc.h>
 #include <storage/lwlock.h>
 #include <string.h>
 #include <utils/hsearch.h>
+#include <utils/memutils.h>
 
+#include "config.h"
 #include "relation.h"
 #include "state.h"
 
+typedef struct RelationLocalKey
+{
+    char object_type[OBJECT_TYPE_MAX_LEN];
+    char relation_name[RELATION_MAX_LEN];
+} RelationLocalKey;
+
+typedef struct RelationLocalEntry
+{
+    RelationLocalKey key;
+    uint8 bit_index;
+    uint16 slot; /* registry->entries[] 위치 */
+} RelationLocalEntry;
+
+typedef struct RelationTypeEntry
+{
+    char object_type[OBJECT_TYPE_MAX_LEN];
+    uint64 mask;
+} RelationTypeEntry;
+
+/* per-backend */
+static HTAB* local_relations = NULL;
+static HTAB* local_types = NULL;
+static uint32 local_synced = 0;
+
+/* relation 별 hit/miss, allow/deny (registry->entries[] 위치로 인덱싱), 공유 카운터에 아직 더하지 않은 값 */
+static uint32* local_hits = NULL;
+static uint32* local_misses = NULL;
+static uint32* local_allowed = NULL;
+static uint32* local_denied = NULL;
+static uint32 local_pending = 0;
+
+static inline FgaRelationRegistry* relation_registry(void)
+{
+    return fga_get_state()->relations;
+}
+
 /* -------------------------------------------------------------------------
- * Relation Bitmap Operations
+ * Shared memory
  * -------------------------------------------------------------------------
  */
+Size fga_relation_shmem_size(void)
+{
+    FgaConfig* config = fga_get_config();
 
-/*
- * get_relation_bit_index
- *
- * Get bit index for a relation name.
- *
- * Args:
- *   relation_name - Name of the relation
- *
- * Returns: Bit index (0-63), or 0 if not found
- *
- * Thread safety: Acquires shared lock on shared state lock
- *
- * Note: Returning 0 for "not found" means the first relation (bit 0)
- *       is indistinguishable from an error. Consider returning -1 or
- *       using an out parameter for the index in production code.
+    return add_size(offsetof(FgaRelationRegistry, entries), mul_size(sizeof(RelationBitMapEntry), config->max_relations));
+}
+
+void fga_relation_shmem_init(FgaRelationRegistry* registry)
+{
+    FgaConfig* config = fga_get_config();
+
+    registry->capacity = config->max_relations;
+    pg_atomic_init_u32(&registry->count, 0);
+}
+
+/* -------------------------------------------------------------------------
+ * Backend-local cache
+ * -------------------------------------------------------------------------
+ */
+static void local_init(void)
+{
+    HASHCTL ctl;
+
+    if (local_relations != NULL)
+        return;
+
+    MemSet(&ctl, 0, sizeof(ctl));
+    ctl.keysize = sizeof(RelationLocalKey);
+    ctl.entrysize = sizeof(RelationLocalEntry);
+    ctl.hcxt = TopMemoryContext;
+    local_relations = hash_create("PostFGA relations", 64, &ctl, HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+    MemSet(&ctl, 0, sizeof(ctl));
+    ctl.keysize = OBJECT_TYPE_MAX_LEN;
+    ctl.entrysize = sizeof(RelationTypeEntry);
+    ctl.hcxt = TopMemoryContext;
+    local_types = hash_create("PostFGA relation types", 16, &ctl, HASH_ELEM | HASH_STRINGS | HASH_CONTEXT);
+}
+
+static void local_add(const RelationBitMapEntry* shared, uint16 slot)
+{
+    RelationLocalKey key;
+    RelationLocalEntry* entry;
+    RelationTypeEntry* type;
+    bool found;
+
+    MemSet(&key, 0, sizeof(key));
+    strlcpy(key.object_type, shared->object_type, sizeof(key.object_type));
+    strlcpy(key.relation_name, shared->relation_name, sizeof(key.relation_name));
+
+    entry = (RelationLocalEntry*)hash_search(local_relations, &key, HASH_ENTER, &found);
+    entry->bit_index = shared->bit_index;
+    entry->slot = slot;
+
+    type = (RelationTypeEntry*)hash_search(local_types, key.object_type, HASH_ENTER, &found);
+    if (!found)
+        type->mask = 0;
+    type->mask |= UINT64CONST(1) << shared->bit_index;
+}
+
+/* 다른 프로세스가 등록한 항목을 로컬 해시에 반영 */
+static void local_sync(void)
+{
+    FgaRelationRegistry* registry = relation_registry();
+    uint32 count = pg_atomic_read_u32(&registry->count);
+
+    if (local_synced == count)
+        return;
+
+    pg_read_barrier();
+    for (; local_synced < count; local_synced++)
+        local_add(&registry->entries[local_synced], (uint16)local_synced);
+}
+
+static bool make_local_key(RelationLocalKey* key, const char* object_type, size_t type_len, const char* relation, size_t relation_len)
+{
+    if (type_len == 0 || type_len >= OBJECT_TYPE_MAX_LEN || relation_len == 0 || relation_len >= RELATION_MAX_LEN)
+        return false;
+
+    MemSet(key, 0, sizeof(*key));
+    memcpy(key->object_type, object_type, type_len);
+    memcpy(key->relation_name, relation, relation_len);
+    return true;
+}
+
+/* -------------------------------------------------------------------------
+ * Registration
+ * -------------------------------------------------------------------------
  */
-uint8 get_relation_bit_index(const char* relation_name)
+
+/* state lock 을 잡고 등록. 그 사이 다른 프로세스가 등록했으면 그 번호를 쓴다 */
+static uint8 register_relation(const RelationLocalKey* key)
 {
-    RelationBitMapEntry* entry;
-    uint8 bit_index = 0;
+    FgaRelationRegistry* registry = relation_registry();
+    LWLock* lock = fga_get_state()->lock;
+    uint8 bit_index = RELATION_BIT_NOT_FOUND;
+    uint32 count;
+    int type_count = 0;
 
-    FgaL2AclCache* state = fga_get_state()->cache;
+    LWLockAcquire(lock, LW_EXCLUSIVE);
 
-    if (!relation_name || relation_name[0] == '\0')
+    count = pg_atomic_read_u32(&registry->count);
+    for (uint32 i = 0; i < count; i++)
     {
-        elog(WARNING, "PostFGA: Invalid relation_name for get bit index");
-        return 0;
-    }
+        RelationBitMapEntry* entry = &registry->entries[i];
+
+        if (strcmp(entry->object_type, key->object_type) != 0)
+            continue;
 
-    // LWLockAcquire(state->lock, LW_SHARED);
+        if (strcmp(entry->relation_name, key->relation_name) == 0)
+        {
+            bit_index = entry->bit_index;
+            break;
+        }
+        type_count++;
+    }
 
-    // entry = (RelationBitMapEntry *)hash_search(state->relation_bitmap_map,
-    //                                            relation_name,
-    //                                            HASH_FIND,
-    //                                            NULL);
+    if (bit_index == RELATION_BIT_NOT_FOUND && count < registry->capacity && type_count < RELATION_BITS_PER_TYPE)
+    {
+        RelationBitMapEntry* entry = &registry->entries[count];
 
-    if (entry)
+        strlcpy(entry->object_type, key->object_type, sizeof(entry->object_type));
+        strlcpy(entry->relation_name, key->relation_name, sizeof(entry->relation_name));
+        entry->bit_index = (uint8)type_count;
+        pg_atomic_init_u32(&entry->checked, 0);
+        pg_atomic_init_u64(&entry->hits, 0);
+        pg_atomic_init_u64(&entry->misses, 0);
+        pg_atomic_init_u64(&entry->allowed, 0);
+        pg_atomic_init_u64(&entry->denied, 0);
         bit_index = entry->bit_index;
-    else
-        elog(DEBUG1, "PostFGA: Relation '%s' not found in bitmap", relation_name);
 
-    // LWLockRelease(state->lock);
+        /* 항목을 다 채운 뒤에 count 를 올린다 (reader 는 락 없이 count 까지만 읽음) */
+        pg_write_barrier();
+        pg_atomic_write_u32(&registry->count, count + 1);
+
+        elog(DEBUG1,
+             "PostFGA: Registered relation '%s#%s' with bit index %u",
+             key->object_type,
+             key->relation_name,
+             bit_index);
+    }
+
+    LWLockRelease(lock);
+
+    if (bit_index == RELATION_BIT_NOT_FOUND)
+        elog(DEBUG1, "PostFGA: Relation registry full, '%s#%s' is cached per relation", key->object_type, key->relation_name);
 
     return bit_index;
 }
 
-/*
- * register_relation
- *
- * Register a relation with a bit index.
- *
- * Args:
- *   relation_name - Name of the relation
- *   bit_index     - Bit index to assign (0-63)
- *
- * Thread safety: Acquires exclusive lock on shared state lock
- *
- * Note: If relation already exists, it will be overwritten.
+/* -------------------------------------------------------------------------
+ * Public API
+ * -------------------------------------------------------------------------
  */
-void register_relation(const char* relation_name, uint8 bit_index)
+static uint8 found_entry(const RelationLocalEntry* entry, uint16* slot_out)
 {
-    FgaL2AclCache* cache;
-    RelationBitMapEntry* entry;
-    bool found;
+    if (entry == NULL)
+        return RELATION_BIT_NOT_FOUND;
+
+    *slot_out = entry->slot;
+    return entry->bit_index;
+}
+
+uint8 fga_relation_bit(
+    const char* object_type, size_t type_len, const char* relation, size_t relation_len, uint16* slot_out)
+{
+    FgaRelationRegistry* registry = relation_registry();
+    RelationLocalKey key;
+    RelationLocalEntry* entry;
+
+    *slot_out = RELATION_SLOT_NONE;
+
+    if (registry == NULL || registry->capacity == 0 ||
+        !make_local_key(&key, object_type, type_len, relation, relation_len))
+        return RELATION_BIT_NOT_FOUND;
+
+    local_init();
+
+    entry = (RelationLocalEntry*)hash_search(local_relations, &key, HASH_FIND, NULL);
+    if (entry != NULL)
+        return found_entry(entry, slot_out);
+
+    local_sync();
+    entry = (RelationLocalEntry*)hash_search(local_relations, &key, HASH_FIND, NULL);
+    if (entry != NULL)
+        return found_entry(entry, slot_out);
+
+    /* 가득 찬 레지스트리에 매번 락을 잡지 않도록 */
+    if (pg_atomic_read_u32(&registry->count) >= registry->capacity)
+        return RELATION_BIT_NOT_FOUND;
+
+    if (register_relation(&key) == RELATION_BIT_NOT_FOUND)
+        return RELATION_BIT_NOT_FOUND;
+
+    local_sync();
+    entry = (RelationLocalEntry*)hash_search(local_relations, &key, HASH_FIND, NULL);
+    return found_entry(entry, slot_out);
+}
 
-    if (!relation_name || relation_name[0] == '\0')
+static void flush_counts(void)
+{
+    FgaRelationRegistry* registry = relation_registry();
+
+    for (uint32 i = 0; i < local_synced; i++)
     {
-        elog(WARNING, "PostFGA: Invalid relation_name for registration");
-        return;
+        if (local_hits[i] != 0)
+            pg_atomic_fetch_add_u64(&registry->entries[i].hits, local_hits[i]);
+        if (local_misses[i] != 0)
+            pg_atomic_fetch_add_u64(&registry->entries[i].misses, local_misses[i]);
+        if (local_allowed[i] != 0)
+            pg_atomic_fetch_add_u64(&registry->entries[i].allowed, local_allowed[i]);
+        if (local_denied[i] != 0)
+            pg_atomic_fetch_add_u64(&registry->entries[i].denied, local_denied[i]);
+        local_hits[i] = local_misses[i] = local_allowed[i] = local_denied[i] = 0;
     }
+    local_pending = 0;
+}
 
-    if (bit_index >= 64)
-    {
-        elog(WARNING, "PostFGA: Bit index %u out of range (max 63)", bit_index);
+static void flush_counts_at_exit(int code, Datum arg)
+{
+    if (local_pending > 0)
+        flush_counts();
+}
+
+static void local_counts_init(void)
+{
+    uint32 capacity;
+
+    if (local_hits != NULL)
         return;
-    }
 
-    cache = fga_get_state()->cache;
+    capacity = relation_registry()->capacity;
+    local_hits = (uint32*)MemoryContextAllocZero(TopMemoryContext, sizeof(uint32) * capacity);
+    local_misses = (uint32*)MemoryContextAllocZero(TopMemoryContext, sizeof(uint32) * capacity);
+    local_allowed = (uint32*)MemoryContextAllocZero(TopMemoryContext, sizeof(uint32) * capacity);
+    local_denied = (uint32*)MemoryContextAllocZero(TopMemoryContext, sizeof(uint32) * capacity);
+    on_shmem_exit(flush_counts_at_exit, (Datum)0);
+}
+
+void fga_relation_count(uint16 slot, bool hit)
+{
+    /* slot 은 fga_relation_bit 이 local_sync 이후에 준 값이므로 slot < local_synced */
+    if (slot == RELATION_SLOT_NONE)
+        return;
 
-    // LWLockAcquire(cache->lock, LW_EXCLUSIVE);
+    /* 한 번 켜지면 읽기만 하므로 cache line 을 계속 더럽히지 않는다 */
+    if (pg_atomic_read_u32(&relation_registry()->entries[slot].checked) == 0)
+        pg_atomic_write_u32(&relation_registry()->entries[slot].checked, 1);
 
-    // entry = (RelationBitMapEntry *)hash_search(cache->relation_bitmap_map,
-    //                                            relation_name,
-    //                                            HASH_ENTER,
-    //                                            &found);
+    local_counts_init();
+    if (hit)
+        local_hits[slot]++;
+    else
+        local_misses[slot]++;
 
-    if (entry)
-    {
-        strncpy(entry->relation_name, relation_name, sizeof(entry->relation_name) - 1);
-        entry->relation_name[sizeof(entry->relation_name) - 1] = '\0';
-        entry->bit_index = bit_index;
+    if (++local_pending >= RELATION_STATS_FLUSH_EVERY)
+        flush_counts();
+}
 
-        elog(DEBUG1, "PostFGA: Registered relation '%s' with bit index %u", relation_name, bit_index);
-    }
+void fga_relation_count_result(uint16 slot, bool allowed)
+{
+    if (slot == RELATION_SLOT_NONE)
+        return;
+
+    local_counts_init();
+    if (allowed)
+        local_allowed[slot]++;
     else
+        local_denied[slot]++;
+
+    if (++local_pending >= RELATION_STATS_FLUSH_EVERY)
+        flush_counts();
+}
+
+bool fga_relation_allow_ratio(const char* object_type, const char* relation, uint64 min_samples, double* ratio_out)
+{
+    FgaRelationRegistry* registry = relation_registry();
+    uint64 allowed = 0;
+    uint64 total = 0;
+    uint32 count;
+
+    if (registry == NULL)
+        return false;
+
+    count = pg_atomic_read_u32(&registry->count);
+    pg_read_barrier();
+
+    for (uint32 i = 0; i < count; i++)
     {
-        elog(WARNING, "PostFGA: Failed to register relation '%s'", relation_name);
+        RelationBitMapEntry* entry = &registry->entries[i];
+        uint64 yes;
+
+        if (object_type != NULL && strcmp(entry->object_type, object_type) != 0)
+            continue;
+        if (relation != NULL && strcmp(entry->relation_name, relation) != 0)
+            continue;
+
+        yes = pg_atomic_read_u64(&entry->allowed);
+        allowed += yes;
+        total += yes + pg_atomic_read_u64(&entry->denied);
     }
 
-    // LWLockRelease(cache->lock);
+    if (total == 0 || total < min_samples)
+        return false;
+
+    *ratio_out = (double)allowed / (double)total;
+    return true;
 }
 
-/*
- * init_relation_bitmap
- *
- * Initialize relation bitmap from GUC string.
- *
- * Args:
- *   relations_str - Comma-separated list of relation names
- *                   (e.g., "read,write,edit,delete")
- *
- * This function parses the GUC string and registers each relation
- * with a sequential bit index (0, 1, 2, ...).
- *
- * Maximum 64 relations are supported (limited by 64-bit bitmask).
- */
-void init_relation_bitmap(const char* relations_str)
+uint64 fga_relation_type_mask(const char* object_type, size_t type_len)
 {
-    char* str_copy;
-    char* token;
-    char* saveptr = NULL;
-    uint8 bit_index = 0;
+    char type_key[OBJECT_TYPE_MAX_LEN];
+    RelationTypeEntry* type;
+
+    if (relation_registry() == NULL || type_len == 0 || type_len >= OBJECT_TYPE_MAX_LEN)
+        return 0;
+
+    local_init();
+    local_sync();
+
+    MemSet(type_key, 0, sizeof(type_key));
+    memcpy(type_key, object_type, type_len);
+
+    type = (RelationTypeEntry*)hash_search(local_types, type_key, HASH_FIND, NULL);
+    return type != NULL ? type->mask : 0;
+}
+
+uint64 fga_relation_checked_mask(const char* object_type, size_t type_len)
+{
+    FgaRelationRegistry* registry = relation_registry();
+    uint64 mask = 0;
+    uint32 count;
+
+    if (registry == NULL || type_len == 0 || type_len >= OBJECT_TYPE_MAX_LEN)
+        return 0;
 
-    if (!relations_str || relations_str[0] == '\0')
+    count = pg_atomic_read_u32(&registry->count);
+    pg_read_barrier();
+
+    for (uint32 i = 0; i < count; i++)
     {
-        elog(WARNING, "PostFGA: Empty relations string for initialization");
-        return;
+        RelationBitMapEntry* entry = &registry->entries[i];
+
+        if (pg_atomic_read_u32(&entry->checked) != 0 && strncmp(entry->object_type, object_type, type_len) == 0 &&
+            entry->object_type[type_len] == '\0')
+            mask |= UINT64CONST(1) << entry->bit_index;
     }
 
-    /* Make a copy since strtok_r modifies the string */
-    str_copy = pstrdup(relations_str);
+    return mask;
+}
+
+uint32 fga_relation_registered(void)
+{
+    FgaRelationRegistry* registry = relation_registry();
+    uint32 count;
+
+    if (registry == NULL)
+        return 0;
+
+    count = pg_atomic_read_u32(&registry->count);
+    pg_read_barrier();
+    return count;
+}
 
-    /* Parse comma-separated tokens */
-    token = strtok_r(str_copy, ",", &saveptr);
-    while (token != NULL)
+const RelationBitMapEntry* fga_relation_entry(uint32 i)
+{
+    return &relation_registry()->entries[i];
+}
+
+int fga_relation_names(const char* object_type, uint64 mask, const char* names_out[RELATION_BITS_PER_TYPE])
+{
+    FgaRelationRegistry* registry = relation_registry();
+    uint32 count = pg_atomic_read_u32(&registry->count);
+    int found = 0;
+
+    MemSet(names_out, 0, sizeof(const char*) * RELATION_BITS_PER_TYPE);
+
+    pg_read_barrier();
+    for (uint32 i = 0; i < count && mask != 0; i++)
     {
-        /* Trim whitespace (simple version) */
-        while (*token == ' ' || *token == '\t')
-            token++;
+        RelationBitMapEntry* entry = &registry->entries[i];
+        uint64 bit = UINT64CONST(1) << entry->bit_index;
 
-        if (*token != '\0')
-        {
-            if (bit_index >= 64)
-            {
-                elog(WARNING, "PostFGA: Too many relations (max 64), ignoring '%s' and subsequent", token);
-                break;
-            }
-
-            register_relation(token, bit_index);
-            bit_index++;
-        }
+        if ((mask & bit) == 0 || strcmp(entry->object_type, object_type) != 0)
+            continue;
 
-        token = strtok_r(NULL, ",", &saveptr);
+        names_out[entry->bit_index] = entry->relation_name;
+        mask &= ~bit;
+        found++;
     }
 
-    pfree(str_copy);
-
-    elog(LOG, "PostFGA: Initialized %u relations in bitmap", bit_index);
+    return found;
 }
@@ -3,6 +3,15 @@
  * relation.h
  *    Relation bitmap operations for PostFGA extension.
  *
+ * (object_type, relation) 마다 type 안에서 0~63 비트 번호를 붙인다.
+ * 캐시는 (store, model, object, subject) 하나당 엔트리 하나에 relation 별
+ * allowed/known 비트를 모아 두므로, 같은 문서의 viewer/editor/owner 가 한 엔트리에 들어간다.
+ *
+ * 모델을 읽지 않고 조회/쓰기에서 처음 본 relation 을 순서대로 등록한다.
+ * 등록은 append-only (서버 재시작 전까지 비트 번호가 바뀌지 않음).
+ * 재시작하면 비트 번호가 달라질 수 있으므로 캐시 덤프는 등록 표를 함께 저장하고,
+ * 적재할 때 같은 순서로 다시 등록해 번호가 모두 같을 때만 엔트리를 읽는다.
+ *
  *-------------------------------------------------------------------------
  */
 
@@ -11,31 +20,84 @@
 
 #include <postgres.h>
 
+#include <port/atomics.h>
+
 #include "postfga.h"
 
 #define RELATION_BIT_NOT_FOUND ((uint8)0xFF)
+#define RELATION_BITS_PER_TYPE 64
+#define RELATION_SLOT_NONE PG_UINT16_MAX
+
+/* 백엔드가 relation 별 hit/miss 를 이만큼 모은 뒤 공유 카운터에 더한다 */
+#define RELATION_STATS_FLUSH_EVERY 1024
 
 /*
  * Relation bit index mapping
  */
 typedef struct RelationBitMapEntry
 {
+    char object_type[OBJECT_TYPE_MAX_LEN];
     char relation_name[RELATION_MAX_LEN];
     uint8 bit_index;
+    pg_atomic_uint32 checked; /* 캐시 조회에 쓰인 적 있음 (miss 때 함께 물을 대상) */
+    pg_atomic_uint64 hits;    /* 캐시 hit (L1 또는 L2) */
+    pg_atomic_uint64 misses;  /* 캐시 miss */
+    pg_atomic_uint64 allowed; /* check 결과 허용 (캐시 hit 포함, planner selectivity 용) */
+    pg_atomic_uint64 denied;  /* check 결과 거부 */
 } RelationBitMapEntry;
 
+typedef struct FgaRelationRegistry
+{
+    uint32 capacity;        /* fga.max_relations */
+    pg_atomic_uint32 count; /* entries[0..count) 가 유효 (채운 뒤에 올린다) */
+    RelationBitMapEntry entries[FLEXIBLE_ARRAY_MEMBER];
+} FgaRelationRegistry;
+
+/* -------------------------------------------------------------------------
+ * Shared memory
+ * -------------------------------------------------------------------------
+ */
+Size fga_relation_shmem_size(void);
+void fga_relation_shmem_init(FgaRelationRegistry* registry);
+
 /* -------------------------------------------------------------------------
  * Relation bitmap operations
  * -------------------------------------------------------------------------
  */
 
-/* Get bit index for a relation name */
-uint8 get_relation_bit_index(const char* relation_name);
+/*
+ * (object_type, relation) 의 비트 번호. 처음 보면 등록한다 (가득 차면 RELATION_BIT_NOT_FOUND).
+ * slot_out 에는 레지스트리 위치 (fga_relation_count 용, 없으면 RELATION_SLOT_NONE)
+ */
+uint8 fga_relation_bit(
+    const char* object_type, size_t type_len, const char* relation, size_t relation_len, uint16* slot_out);
+
+/* 캐시 조회 결과를 relation 별로 센다 (백엔드에 모았다가 RELATION_STATS_FLUSH_EVERY 마다 반영) */
+void fga_relation_count(uint16 slot, bool hit);
+
+/* check 결과 (허용/거부) 를 relation 별로 센다. 반영 시점은 fga_relation_count 와 같다 */
+void fga_relation_count_result(uint16 slot, bool allowed);
+
+/*
+ * 관측된 허용 비율. object_type/relation 이 NULL 이면 그 조건 없이 합친다.
+ * 표본이 min_samples 보다 적으면 false
+ */
+bool fga_relation_allow_ratio(const char* object_type, const char* relation, uint64 min_samples, double* ratio_out);
+
+/* object_type 에 등록된 relation 비트 전체 */
+uint64 fga_relation_type_mask(const char* object_type, size_t type_len);
+
+/* object_type 에 등록된 relation 중 캐시 조회에 쓰인 적 있는 비트 (쓰기에서만 본 relation 제외) */
+uint64 fga_relation_checked_mask(const char* object_type, size_t type_len);
 
-/* Register a relation with a bit index */
-void register_relation(const char* relation_name, uint8 bit_index);
+/* 등록된 항목 수와 i 번째 항목 (캐시 덤프용, 등록 순서) */
+uint32 fga_relation_registered(void);
+const RelationBitMapEntry* fga_relation_entry(uint32 i);
 
-/* Initialize relation bitmap from GUC string */
-void init_relation_bitmap(const char* relations_str);
+/*
+ * mask 의 비트 번호 → relation 이름 (shared memory 안의 문자열). BGW 에서 사용.
+ * names_out[bit] 를 채우고 (없는 비트는 NULL), 찾은 개수를 반환
+ */
+int fga_relation_names(const char* object_type, uint64 mask, const char* names_out[RELATION_BITS_PER_TYPE]);
 
 #endif /* FGA_RELATION_H */
@@ -23,11 +23,15 @@
 #include <utils/hsearch.h>
 
 #include "cache.h"
+#include "change_feed.h"
 #include "channel_shmem.h"
+#include "generation.h"
+#include "list_cache.h"
+#include "relation.h"
 #include "state.h"
 #include "stats.h"
 
-/* Named LWLock tranche 이름과 필요한 락 개수 */
+/* Named LWLock tranche 이름과 필요한 락 개수: state, pool, queue, list cache (L2 는 lock-free) */
 #define FGA_LWLOCK_TRANCHE_NAME "postfga"
 #define FGA_LWLOCK_TRANCHE_NUM 4
 
@@ -50,9 +54,21 @@ static Size struct_size(void)
     // 3. L2 cache - struct
     size = add_size(size, MAXALIGN(fga_cache_shmem_base_size()));
 
-    // 4. statistics
+    // 4. cache generations
+    size = add_size(size, MAXALIGN(fga_generation_shmem_size()));
+
+    // 5. change feed
+    size = add_size(size, MAXALIGN(fga_change_feed_shmem_size()));
+
+    // 6. statistics
     size = add_size(size, MAXALIGN(fga_stats_shmem_size()));
 
+    // 7. relation registry
+    size = add_size(size, MAXALIGN(fga_relation_shmem_size()));
+
+    // 8. list cache
+    size = add_size(size, MAXALIGN(fga_list_cache_shmem_size()));
+
     return size;
 }
 
@@ -95,13 +111,33 @@ static void _initialize_state(void)
 
     /* 3. L2 cache */
     fga_state_instance_->cache = (FgaL2AclCache*)ptr;
-    fga_cache_shmem_init(fga_state_instance_->cache, &locks[3].lock);
+    fga_cache_shmem_init(fga_state_instance_->cache);
     ptr += MAXALIGN(fga_cache_shmem_base_size());
 
-    /* 4. statistics */
+    /* 4. cache generations */
+    fga_state_instance_->generations = (FgaGenerationTable*)ptr;
+    fga_generation_shmem_init(fga_state_instance_->generations);
+    ptr += MAXALIGN(fga_generation_shmem_size());
+
+    /* 5. change feed */
+    fga_state_instance_->change_feed = (FgaChangeFeedState*)ptr;
+    fga_change_feed_shmem_init(fga_state_instance_->change_feed);
+    ptr += MAXALIGN(fga_change_feed_shmem_size());
+
+    /* 6. statistics */
     fga_state_instance_->stats = (FgaStats*)ptr;
     fga_stats_shmem_init(fga_state_instance_->stats);
     ptr += MAXALIGN(fga_stats_shmem_size());
+
+    /* 7. relation registry */
+    fga_state_instance_->relations = (FgaRelationRegistry*)ptr;
+    fga_relation_shmem_init(fga_state_instance_->relations);
+    ptr += MAXALIGN(fga_relation_shmem_size());
+
+    /* 8. list cache */
+    fga_state_instance_->list_cache = (FgaListCache*)ptr;
+    fga_list_cache_shmem_init(fga_state_instance_->list_cache, &locks[3].lock);
+    ptr += MAXALIGN(fga_list_cache_shmem_size());
 }
 
 /*-------------------------------------------------------------------------
@@ -120,9 +156,6 @@ void fga_shmem_request(void)
 {
     Size size = struct_size();
 
-    // L2 cache - hash table
-    size = add_size(size, MAXALIGN(fga_cache_shmem_hash_size()));
-
     RequestAddinShmemSpace(size);
     RequestNamedLWLockTranche(FGA_LWLOCK_TRANCHE_NAME, FGA_LWLOCK_TRANCHE_NUM);
 }
@@ -150,6 +183,4 @@ void fga_shmem_startup(void)
         _initialize_state();
     }
     LWLockRelease(AddinShmemInitLock);
-
-    fga_cache_shmem_each_startup();
 }
@@ -33,6 +33,18 @@ extern "C"
     struct FgaStats;
     typedef struct FgaStats FgaStats;
 
+    struct FgaGenerationTable;
+    typedef struct FgaGenerationTable FgaGenerationTable;
+
+    struct FgaChangeFeedState;
+    typedef struct FgaChangeFeedState FgaChangeFeedState;
+
+    struct FgaRelationRegistry;
+    typedef struct FgaRelationRegistry FgaRelationRegistry;
+
+    struct FgaListCache;
+    typedef struct FgaListCache FgaListCache;
+
     /*-------------------------------------------------------------------------
      * FgaState
      */
@@ -42,8 +54,12 @@ extern "C"
         Latch* bgw_latch;     /* Background worker latch */
         uint64_t hash_seed;   /* Hash seed for consistent hashing */
         FgaChannel* channel;  /* Request channel */
-        FgaL2AclCache* cache; /* L2 cache */
-        FgaStats* stats;      /* Statistics */
+        FgaL2AclCache* cache;             /* L2 cache */
+        FgaGenerationTable* generations; /* Cache invalidation generations */
+        FgaChangeFeedState* change_feed;  /* ReadChanges continuation token */
+        FgaStats* stats;                  /* Statistics */
+        FgaRelationRegistry* relations;   /* Relation name → bit index */
+        FgaListCache* list_cache;         /* fga_list_objects results */
     } FgaState;
 
     /* 전역 shmem state 포인터 (실제 정의는 shmem.c 에서) */
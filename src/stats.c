@@ -7,7 +7,10 @@
  */
 #include <postgres.h>
 
+#include <math.h>
+
 #include <miscadmin.h>
+#include <storage/ipc.h>
 #include <storage/proc.h>
 #include <storage/shmem.h>
 
@@ -40,6 +43,40 @@ void fga_stats_shmem_init(FgaStats* stats)
     pg_atomic_init_u64(&stats->bgw_wakeups, 0);
     pg_atomic_init_u64(&stats->requests_enqueued, 0);
     pg_atomic_init_u64(&stats->requests_processed, 0);
+    pg_atomic_init_u32(&stats->grpc_channel_count, 0);
+
+    for (i = 0; i < FGA_GRPC_CHANNELS_MAX; i++)
+    {
+        FgaGrpcChannelStats* ch = &stats->grpc_channels[i];
+
+        pg_atomic_init_u64(&ch->calls, 0);
+        pg_atomic_init_u64(&ch->errors, 0);
+        pg_atomic_init_u32(&ch->inflight, 0);
+        pg_atomic_init_u32(&ch->state, 0);
+    }
+
+    pg_atomic_init_u64(&stats->change_feed.polls, 0);
+    pg_atomic_init_u64(&stats->change_feed.changes, 0);
+    pg_atomic_init_u64(&stats->change_feed.errors, 0);
+    pg_atomic_init_u64(&stats->change_feed.resets, 0);
+
+    for (i = 0; i < FGA_LATENCY_REQUEST_TYPES; i++)
+    {
+        for (int stage = 0; stage < FGA_LATENCY_STAGES; stage++)
+        {
+            FgaLatencyHistogram* hist = &stats->latency[i][stage];
+
+            pg_atomic_init_u64(&hist->count, 0);
+            pg_atomic_init_u64(&hist->sum_us, 0);
+            pg_atomic_init_u64(&hist->max_us, 0);
+            for (int b = 0; b < FGA_LATENCY_BUCKETS; b++)
+                pg_atomic_init_u64(&hist->buckets[b], 0);
+        }
+    }
+
+    pg_atomic_init_u64(&stats->trace_next, 0);
+    for (i = 0; i < FGA_TRACE_RING_SIZE; i++)
+        pg_atomic_init_u64(&stats->trace[i].seq, 0);
 
     /* 2) per-backend 슬롯 초기화 */
     for (i = 0; i < MaxBackends; i++)
@@ -58,21 +95,55 @@ void fga_stats_l1_hit(void)
 {
     FgaBackendStats* stats = backend_stats();
     if (stats)
+    {
         stats->cache_l1_hits++;
+        stats->l1_hits++;
+    }
 }
 
 void fga_stats_l1_miss(void)
 {
     FgaBackendStats* stats = backend_stats();
     if (stats)
+    {
         stats->cache_l1_misses++;
+        stats->l1_misses++;
+    }
 }
 
 void fga_stats_l1_eviction(void)
 {
     FgaBackendStats* stats = backend_stats();
     if (stats)
+    {
         stats->cache_l1_evictions++;
+        stats->l1_evictions++;
+    }
+}
+
+static void l1_detach(int code, Datum arg)
+{
+    FgaBackendStats* stats = backend_stats();
+    if (stats)
+        stats->l1_pid = 0;
+}
+
+void fga_stats_l1_allocated(uint64 entries, uint32 ways, uint64 bytes)
+{
+    FgaBackendStats* stats = backend_stats();
+    if (stats == NULL)
+        return;
+
+    stats->l1_entries = entries;
+    stats->l1_ways = ways;
+    stats->l1_bytes = bytes;
+    stats->l1_hits = 0;
+    stats->l1_misses = 0;
+    stats->l1_evictions = 0;
+    pg_write_barrier();
+    stats->l1_pid = MyProcPid;
+
+    on_shmem_exit(l1_detach, (Datum)0);
 }
 
 void fga_stats_l2_hit(void)
@@ -94,4 +165,181 @@ void fga_stats_l2_eviction(void)
     FgaBackendStats* stats = backend_stats();
     if (stats)
         stats->cache_l2_evictions++;
-}
\ No newline at end of file
+}
+
+void fga_stats_l2_refresh(void)
+{
+    FgaBackendStats* stats = backend_stats();
+    if (stats)
+        stats->cache_l2_refreshes++;
+}
+
+void fga_stats_l2_admission_reject(void)
+{
+    FgaBackendStats* stats = backend_stats();
+    if (stats)
+        stats->cache_l2_admission_rejects++;
+}
+
+void fga_stats_record_latency(uint16 type, FgaLatencyStage stage, uint64 latency_us)
+{
+    FgaLatencyHistogram* hist;
+    uint64 max;
+
+    if (type >= FGA_LATENCY_REQUEST_TYPES || stage >= FGA_LATENCY_STAGES)
+        return;
+
+    hist = &fga_get_stats()->latency[type][stage];
+
+    pg_atomic_fetch_add_u64(&hist->buckets[fga_latency_bucket(latency_us)], 1);
+    pg_atomic_fetch_add_u64(&hist->sum_us, latency_us);
+    pg_atomic_fetch_add_u64(&hist->count, 1);
+
+    max = pg_atomic_read_u64(&hist->max_us);
+    while (latency_us > max)
+    {
+        if (pg_atomic_compare_exchange_u64(&hist->max_us, &max, latency_us))
+            break;
+    }
+}
+
+/*
+ * percentile (0..1) 에 해당하는 버킷의 상한값을 반환.
+ * 버킷들을 읽는 동안에도 증가할 수 있으므로 count 대신 버킷 합을 기준으로 한다.
+ */
+uint64 fga_stats_latency_percentile(const FgaLatencyHistogram* hist, double percentile)
+{
+    uint64 counts[FGA_LATENCY_BUCKETS];
+    uint64 total = 0;
+    uint64 rank;
+    uint64 seen = 0;
+
+    for (int b = 0; b < FGA_LATENCY_BUCKETS; b++)
+    {
+        counts[b] = pg_atomic_read_u64(unconstify(pg_atomic_uint64*, &hist->buckets[b]));
+        total += counts[b];
+    }
+
+    if (total == 0)
+        return 0;
+
+    rank = (uint64)ceil(percentile * (double)total);
+    if (rank == 0)
+        rank = 1;
+
+    for (int b = 0; b < FGA_LATENCY_BUCKETS; b++)
+    {
+        seen += counts[b];
+        if (seen >= rank)
+            return fga_latency_bucket_upper(b);
+    }
+
+    return fga_latency_bucket_upper(FGA_LATENCY_BUCKETS - 1);
+}
+
+/*
+ * 타임라인 하나를 ring 에 기록. 여러 백엔드가 동시에 호출할 수 있으며
+ * 위치는 fetch_add 로 나눠 갖고, 덮어쓰기 중인 레코드는 seq=0 으로 표시한다.
+ */
+void fga_stats_trace(const FgaTraceRecord* record)
+{
+    FgaStats* stats = fga_get_stats();
+    uint64 pos = pg_atomic_fetch_add_u64(&stats->trace_next, 1);
+    FgaTraceRecord* dst = &stats->trace[pos & (FGA_TRACE_RING_SIZE - 1)];
+
+    pg_atomic_write_u64(&dst->seq, 0);
+    pg_write_barrier();
+
+    dst->request_id = record->request_id;
+    dst->backend_pid = record->backend_pid;
+    dst->request_type = record->request_type;
+    dst->status = record->status;
+    dst->acquire_us = record->acquire_us;
+    dst->enqueue_us = record->enqueue_us;
+    dst->drain_us = record->drain_us;
+    dst->rpc_start_us = record->rpc_start_us;
+    dst->rpc_end_us = record->rpc_end_us;
+    dst->complete_us = record->complete_us;
+    dst->wake_us = record->wake_us;
+
+    pg_write_barrier();
+    pg_atomic_write_u64(&dst->seq, pos + 1);
+}
+
+/* ring 위치 position 의 레코드를 복사. 아직 기록 중이거나 이미 덮어써졌으면 false */
+bool fga_stats_trace_read(uint64 position, FgaTraceRecord* out)
+{
+    FgaTraceRecord* src = &fga_get_stats()->trace[position & (FGA_TRACE_RING_SIZE - 1)];
+
+    if (pg_atomic_read_u64(&src->seq) != position + 1)
+        return false;
+    pg_read_barrier();
+
+    out->request_id = src->request_id;
+    out->backend_pid = src->backend_pid;
+    out->request_type = src->request_type;
+    out->status = src->status;
+    out->acquire_us = src->acquire_us;
+    out->enqueue_us = src->enqueue_us;
+    out->drain_us = src->drain_us;
+    out->rpc_start_us = src->rpc_start_us;
+    out->rpc_end_us = src->rpc_end_us;
+    out->complete_us = src->complete_us;
+    out->wake_us = src->wake_us;
+
+    pg_read_barrier();
+    return pg_atomic_read_u64(&src->seq) == position + 1;
+}
+
+void fga_stats_rpc_check(uint64 latency_us, bool error)
+{
+    FgaBackendStats* stats = backend_stats();
+    if (stats)
+    {
+        stats->rpc_check_calls++;
+        stats->rpc_check_latency_sum_us += latency_us;
+        if (error)
+            stats->rpc_check_error++;
+    }
+}
+
+void fga_stats_set_grpc_channel_count(uint32 count)
+{
+    if (count > FGA_GRPC_CHANNELS_MAX)
+        count = FGA_GRPC_CHANNELS_MAX;
+
+    pg_atomic_write_u32(&fga_get_stats()->grpc_channel_count, count);
+}
+
+void fga_stats_set_grpc_channel(uint32 index, uint32 inflight, uint64 calls, uint64 errors, uint32 state)
+{
+    FgaGrpcChannelStats* ch;
+
+    if (index >= FGA_GRPC_CHANNELS_MAX)
+        return;
+
+    ch = &fga_get_stats()->grpc_channels[index];
+    pg_atomic_write_u64(&ch->calls, calls);
+    pg_atomic_write_u64(&ch->errors, errors);
+    pg_atomic_write_u32(&ch->inflight, inflight);
+    pg_atomic_write_u32(&ch->state, state);
+}
+
+void fga_stats_change_feed_poll(uint64 changes, bool error)
+{
+    FgaChangeFeedStats* feed = &fga_get_stats()->change_feed;
+
+    if (error)
+    {
+        pg_atomic_fetch_add_u64(&feed->errors, 1);
+        return;
+    }
+
+    pg_atomic_fetch_add_u64(&feed->polls, 1);
+    pg_atomic_fetch_add_u64(&feed->changes, changes);
+}
+
+void fga_stats_change_feed_reset(void)
+{
+    pg_atomic_fetch_add_u64(&fga_get_stats()->change_feed.resets, 1);
+}
@@ -16,6 +16,29 @@ extern "C"
 
 #include <postgres.h>
 
+#include <port/atomics.h>
+#include <port/pg_bitutils.h>
+#include <time.h>
+
+#include "postfga.h"
+
+/*
+ * Latency histogram (log-linear, HDR 방식)
+ *
+ * 2의 거듭제곱 구간마다 FGA_LATENCY_SUB_BUCKETS 개로 나눈다 (상대 오차 ~12.5%).
+ * 0..7us 는 1us 단위, 그 이후는 [2^k, 2^(k+1)) 을 8등분. 약 67초 이상은 마지막 버킷.
+ */
+#define FGA_LATENCY_SUB_BITS 3
+#define FGA_LATENCY_SUB_BUCKETS (1 << FGA_LATENCY_SUB_BITS)
+#define FGA_LATENCY_MAX_EXP 26
+#define FGA_LATENCY_BUCKETS ((FGA_LATENCY_MAX_EXP - FGA_LATENCY_SUB_BITS + 2) * FGA_LATENCY_SUB_BUCKETS)
+
+/* fga_trace_recent() 에 보관하는 최근 타임라인 개수 (2의 거듭제곱) */
+#define FGA_TRACE_RING_SIZE 1024
+
+/* FgaRequestType 값으로 직접 인덱싱 (0 은 미사용) */
+#define FGA_LATENCY_REQUEST_TYPES 10
+
     typedef struct FgaBackendStats
     {
         uint64 check_calls;
@@ -29,12 +52,83 @@ extern "C"
         uint64 cache_l2_hits;
         uint64 cache_l2_misses;
         uint64 cache_l2_evictions;
+        uint64 cache_l2_refreshes;
+        uint64 cache_l2_admission_rejects;
 
         uint64 rpc_check_calls;
         uint64 rpc_check_error;
         uint64 rpc_check_latency_sum_us;
+
+        /*
+         * 현재 이 슬롯을 쓰는 백엔드의 L1 (fga_backend_stats)
+         * 위 누적값과 달리 L1 을 할당할 때 0 으로 시작하고, 백엔드가 끝나면 l1_pid 를 지운다.
+         */
+        int32 l1_pid;
+        uint32 l1_ways;
+        uint64 l1_entries;
+        uint64 l1_bytes;
+        uint64 l1_hits;
+        uint64 l1_misses;
+        uint64 l1_evictions;
     } FgaBackendStats;
 
+    /* 요청 처리 단계 */
+    typedef enum FgaLatencyStage
+    {
+        FGA_LATENCY_QUEUE = 0, /* enqueue -> BGW drain */
+        FGA_LATENCY_DISPATCH,  /* BGW drain -> client 전달 */
+        FGA_LATENCY_RPC,       /* client 전달 -> gRPC 완료 */
+        FGA_LATENCY_WAKEUP,    /* gRPC 완료 -> 백엔드 재개 */
+        FGA_LATENCY_TOTAL,     /* enqueue -> 백엔드 재개 */
+        FGA_LATENCY_STAGES
+    } FgaLatencyStage;
+
+    typedef struct FgaLatencyHistogram
+    {
+        pg_atomic_uint64 count;
+        pg_atomic_uint64 sum_us;
+        pg_atomic_uint64 max_us;
+        pg_atomic_uint64 buckets[FGA_LATENCY_BUCKETS];
+    } FgaLatencyHistogram;
+
+    /*
+     * 샘플링된 요청 하나의 타임라인.
+     * seq 는 기록 중 0, 완료 시 (ring 위치 + 1). 읽는 쪽은 seq 가 전후로 같을 때만 사용한다.
+     */
+    typedef struct FgaTraceRecord
+    {
+        pg_atomic_uint64 seq;
+        uint64 request_id;
+        int32 backend_pid;
+        uint16 request_type;
+        uint16 status;
+        uint64 acquire_us;
+        uint64 enqueue_us;
+        uint64 drain_us;
+        uint64 rpc_start_us;
+        uint64 rpc_end_us;
+        uint64 complete_us;
+        uint64 wake_us;
+    } FgaTraceRecord;
+
+    /* gRPC 채널(연결)별 통계: BGW 만 갱신 */
+    typedef struct FgaGrpcChannelStats
+    {
+        pg_atomic_uint64 calls;    /* RPCs started on this channel */
+        pg_atomic_uint64 errors;   /* RPCs finished with non-OK status */
+        pg_atomic_uint32 inflight; /* RPCs currently in flight */
+        pg_atomic_uint32 state;    /* grpc_connectivity_state */
+    } FgaGrpcChannelStats;
+
+    /* ReadChanges 기반 무효화: BGW 만 갱신 */
+    typedef struct FgaChangeFeedStats
+    {
+        pg_atomic_uint64 polls;   /* ReadChanges RPCs completed */
+        pg_atomic_uint64 changes; /* Tuple changes applied to the cache */
+        pg_atomic_uint64 errors;  /* ReadChanges RPCs failed */
+        pg_atomic_uint64 resets;  /* Token discarded, whole store invalidated */
+    } FgaChangeFeedStats;
+
     typedef struct FgaStats
     {
         pg_atomic_uint64 cache_entries;      /* Current cache entry count */
@@ -44,6 +138,12 @@ extern "C"
         pg_atomic_uint64 bgw_wakeups;        /* BGW wakeup count */
         pg_atomic_uint64 requests_enqueued;  /* Requests enqueued count */
         pg_atomic_uint64 requests_processed; /* Requests processed count */
+        pg_atomic_uint32 grpc_channel_count; /* Number of active gRPC channels */
+        FgaGrpcChannelStats grpc_channels[FGA_GRPC_CHANNELS_MAX];
+        FgaChangeFeedStats change_feed;
+        FgaLatencyHistogram latency[FGA_LATENCY_REQUEST_TYPES][FGA_LATENCY_STAGES];
+        pg_atomic_uint64 trace_next; /* 다음에 기록할 ring 위치 (단조 증가) */
+        FgaTraceRecord trace[FGA_TRACE_RING_SIZE];
         FgaBackendStats backends[FLEXIBLE_ARRAY_MEMBER];
     } FgaStats;
 
@@ -54,10 +154,73 @@ extern "C"
     void fga_stats_l1_hit(void);
     void fga_stats_l1_miss(void);
     void fga_stats_l1_eviction(void);
+    void fga_stats_l1_allocated(uint64 entries, uint32 ways, uint64 bytes);
 
     void fga_stats_l2_hit(void);
     void fga_stats_l2_miss(void);
     void fga_stats_l2_eviction(void);
+    void fga_stats_l2_refresh(void);
+    void fga_stats_l2_admission_reject(void);
+
+    void fga_stats_record_latency(uint16 type, FgaLatencyStage stage, uint64 latency_us);
+    void fga_stats_rpc_check(uint64 latency_us, bool error);
+    uint64 fga_stats_latency_percentile(const FgaLatencyHistogram* hist, double percentile);
+
+    void fga_stats_trace(const FgaTraceRecord* record);
+    bool fga_stats_trace_read(uint64 position, FgaTraceRecord* out);
+
+    void fga_stats_set_grpc_channel_count(uint32 count);
+    void fga_stats_set_grpc_channel(uint32 index, uint32 inflight, uint64 calls, uint64 errors, uint32 state);
+
+    void fga_stats_change_feed_poll(uint64 changes, bool error);
+    void fga_stats_change_feed_reset(void);
+
+    /* 단조 시계 (us). PostgreSQL 함수를 쓰지 않으므로 gRPC 스레드에서도 호출 가능 */
+    static inline uint64 fga_clock_us(void)
+    {
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64)ts.tv_sec * 1000000 + (uint64)ts.tv_nsec / 1000;
+    }
+
+    /* 두 시각의 차이 (역전/미기록이면 0) */
+    static inline uint64 fga_elapsed_us(uint64 from, uint64 to)
+    {
+        return (from != 0 && to > from) ? to - from : 0;
+    }
+
+    static inline uint32 fga_latency_bucket(uint64 us)
+    {
+        int exp;
+        uint32 index;
+
+        if (us < FGA_LATENCY_SUB_BUCKETS)
+            return (uint32)us;
+
+        exp = pg_leftmost_one_pos64(us);
+        if (exp > FGA_LATENCY_MAX_EXP)
+            return FGA_LATENCY_BUCKETS - 1;
+
+        index = (uint32)(exp - FGA_LATENCY_SUB_BITS + 1) * FGA_LATENCY_SUB_BUCKETS +
+                (uint32)((us >> (exp - FGA_LATENCY_SUB_BITS)) & (FGA_LATENCY_SUB_BUCKETS - 1));
+        return index;
+    }
+
+    /* 버킷의 상한값 (us) */
+    static inline uint64 fga_latency_bucket_upper(uint32 index)
+    {
+        uint32 exp;
+        uint64 sub;
+
+        if (index < FGA_LATENCY_SUB_BUCKETS)
+            return index;
+
+        exp = index / FGA_LATENCY_SUB_BUCKETS + FGA_LATENCY_SUB_BITS - 1;
+        sub = index % FGA_LATENCY_SUB_BUCKETS;
+        return ((FGA_LATENCY_SUB_BUCKETS + sub + 1) << (exp - FGA_LATENCY_SUB_BITS)) - 1;
+    }
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,45 @@
+#!/bin/bash
+#
+# regress_setup.sh - OpenFGA store/model for the regression suite (make installcheck)
+#
+# 실행할 때마다 새 store 에 fixtures/model.json 을 올리고,
+# pg_regress 임시 인스턴스 설정 (tests/regress.conf) 을 쓴다.
+# store 가 매번 새것이므로 이전 실행에서 쓴 tuple 이 결과에 섞이지 않는다.
+#
+#   FGA_HTTP      OpenFGA HTTP API   (기본 http://localhost:8080)
+#   FGA_ENDPOINT  OpenFGA gRPC 주소  (기본 localhost:8081)
+#
+
+set -euo pipefail
+
+FGA_HTTP="${FGA_HTTP:-http://localhost:8080}"
+FGA_ENDPOINT="${FGA_ENDPOINT:-localhost:8081}"
+TESTS_DIR="$(cd "$(dirname "$0")" && pwd)"
+
+json_field() {
+    sed -n "s/.*\"$1\" *: *\"\([^\"]*\)\".*/\1/p"
+}
+
+store_id=$(curl -sf -X POST "$FGA_HTTP/stores" \
+    -H 'Content-Type: application/json' \
+    -d '{"name": "postfga-regress"}' | json_field id)
+
+model_id=$(curl -sf -X POST "$FGA_HTTP/stores/$store_id/authorization-models" \
+    -H 'Content-Type: application/json' \
+    -d @"$TESTS_DIR/fixtures/model.json" | json_field authorization_model_id)
+
+if [ -z "$store_id" ] || [ -z "$model_id" ]; then
+    echo "regress_setup.sh: could not create an OpenFGA store at $FGA_HTTP" >&2
+    exit 1
+fi
+
+cat > "$TESTS_DIR/regress.conf" <<CONF
+shared_preload_libraries = 'postfga'
+fga.endpoint = '$FGA_ENDPOINT'
+fga.store_id = '$store_id'
+fga.model_id = '$model_id'
+# 결과가 change feed 폴링 시점에 따라 달라지지 않도록
+fga.changes_poll_interval_ms = 0
+CONF
+
+echo "regress_setup.sh: store $store_id, model $model_id"
@@ -0,0 +1,80 @@
+--
+-- fga_check qual 을 블록 단위로 묶어 확인하는 scan (FgaBatchCheck)
+--
+
+CREATE TABLE batch_docs (pos int, id text);
+INSERT INTO batch_docs VALUES (1, 'b1'), (2, 'b2'), (3, 'b3'), (4, 'b4'), (5, 'b5'), (6, 'b6');
+ANALYZE batch_docs;
+
+SELECT fga_write_tuple('doc', 'b2', 'user', 'ivy', 'viewer') AS written;
+SELECT fga_write_tuple('doc', 'b4', 'user', 'ivy', 'owner') AS written;
+SELECT fga_write_tuple('doc', 'b5', 'user', 'ivy', 'viewer') AS written;
+SELECT fga_write_tuple('doc', 'b1', 'user', 'jack', 'viewer') AS written;
+
+-- 계획에 FgaBatchCheck 가 들어가는지
+CREATE FUNCTION uses_batch_check(query text) RETURNS boolean
+LANGUAGE plpgsql AS $$
+DECLARE
+    line text;
+BEGIN
+    FOR line IN EXECUTE 'EXPLAIN (COSTS OFF) ' || query LOOP
+        IF line LIKE '%FgaBatchCheck%' THEN
+            RETURN true;
+        END IF;
+    END LOOP;
+    RETURN false;
+END
+$$;
+
+-- 블록 여러 개에 걸치도록
+SET fga.check_batch_size = 2;
+
+SELECT uses_batch_check($$SELECT id FROM batch_docs WHERE fga_check('doc', id, 'user', 'ivy', 'viewer')$$) AS batched;
+
+-- 하위 scan 순서를 그대로 유지
+SELECT pos, id FROM batch_docs WHERE fga_check('doc', id, 'user', 'ivy', 'viewer');
+
+-- 다른 qual 과 함께
+SELECT pos, id FROM batch_docs WHERE pos > 2 AND fga_check('doc', id, 'user', 'ivy', 'viewer');
+
+-- LIMIT: 필요한 블록까지만 읽는다
+SELECT pos, id FROM batch_docs WHERE fga_check('doc', id, 'user', 'ivy', 'viewer') LIMIT 2;
+
+-- rescan: outer 행마다 parameter 가 바뀌는 inner scan
+SELECT u.name, d.id
+FROM (VALUES ('ivy'), ('jack'), ('nobody')) AS u (name)
+CROSS JOIN LATERAL (SELECT id FROM batch_docs WHERE fga_check('doc', id, 'user', u.name, 'viewer')) AS d
+ORDER BY u.name, d.id;
+
+-- 끄면 행마다 확인
+SET fga.check_batch_size = 0;
+SELECT uses_batch_check($$SELECT id FROM batch_docs WHERE fga_check('doc', id, 'user', 'ivy', 'viewer')$$) AS batched;
+SELECT pos, id FROM batch_docs WHERE fga_check('doc', id, 'user', 'ivy', 'viewer');
+RESET fga.check_batch_size;
+
+-- RLS 정책의 check 는 leakproof 가 아닌 사용자 qual 보다 먼저 평가되어야 한다
+CREATE TABLE batch_rls (id text);
+INSERT INTO batch_rls SELECT id FROM batch_docs;
+ALTER TABLE batch_rls ENABLE ROW LEVEL SECURITY;
+CREATE POLICY ivy_sees ON batch_rls USING (fga_check('doc', id, 'user', 'ivy', 'viewer'));
+CREATE ROLE regress_fga_reader;
+GRANT SELECT ON batch_rls TO regress_fga_reader;
+
+CREATE FUNCTION leak(text) RETURNS boolean
+LANGUAGE plpgsql COST 0.0000001 AS $$
+BEGIN
+    RAISE NOTICE 'saw %', $1;
+    RETURN true;
+END
+$$;
+
+SET ROLE regress_fga_reader;
+SELECT uses_batch_check($$SELECT id FROM batch_rls WHERE leak(id)$$) AS batched;
+SELECT id FROM batch_rls WHERE leak(id);
+RESET ROLE;
+
+DROP TABLE batch_rls;
+DROP FUNCTION leak(text);
+DROP ROLE regress_fga_reader;
+DROP FUNCTION uses_batch_check(text);
+DROP TABLE batch_docs;
@@ -0,0 +1,48 @@
+--
+-- 쓰기/삭제 후 캐시 무효화
+--
+
+-- deny 가 캐시된 뒤 쓰기
+SELECT fga_check('doc', 'inv1', 'user', 'carol', 'viewer') AS allowed;
+SELECT fga_check('doc', 'inv1', 'user', 'carol', 'viewer') AS allowed;
+SELECT fga_write_tuple('doc', 'inv1', 'user', 'carol', 'viewer') AS written;
+SELECT fga_check('doc', 'inv1', 'user', 'carol', 'viewer') AS allowed;
+
+-- allow 가 캐시된 뒤 삭제
+SELECT fga_delete_tuple('doc', 'inv1', 'user', 'carol', 'viewer') AS deleted;
+SELECT fga_check('doc', 'inv1', 'user', 'carol', 'viewer') AS allowed;
+
+-- 같은 object 의 다른 relation 쓰기도 계산된 relation (viewer ⊇ editor ⊇ owner) 결과를 무효화
+SELECT fga_check('doc', 'inv2', 'user', 'carol', 'viewer') AS allowed;
+SELECT fga_write_tuple('doc', 'inv2', 'user', 'carol', 'owner') AS written;
+SELECT fga_check('doc', 'inv2', 'user', 'carol', 'viewer') AS allowed;
+SELECT fga_check('doc', 'inv2', 'user', 'carol', 'editor') AS allowed;
+SELECT fga_delete_tuple('doc', 'inv2', 'user', 'carol', 'owner') AS deleted;
+SELECT fga_check('doc', 'inv2', 'user', 'carol', 'editor') AS allowed;
+SELECT fga_check('doc', 'inv2', 'user', 'carol', 'viewer') AS allowed;
+
+-- 수동 무효화
+SELECT fga_cache_invalidate(NULL, 'doc', 'inv2') AS scope;
+SELECT fga_cache_invalidate(NULL, NULL, NULL, 'user', 'carol') AS scope;
+SELECT fga_cache_invalidate() AS scope;
+SELECT fga_cache_invalidate(NULL, 'doc', NULL) AS scope;
+-- key 를 만드는 인자는 길이 제한을 넘으면 ERROR
+SELECT fga_check('doc', 'inv2', 'user', repeat('x', 600), 'viewer') AS allowed;
+SELECT fga_cache_invalidate(NULL, 'doc', repeat('x', 600)) AS scope;
+SELECT fga_cache_invalidate(repeat('s', 600)) AS scope;
+SELECT fga_check('doc', 'inv2', 'user', 'carol', 'viewer') AS allowed;
+
+-- group 멤버십 변경은 그 group 을 거쳐 얻은 권한에도 반영 (fga.cache_transitive_types 기본값 '*')
+SELECT fga_write_tuple('group', 'eng', 'user', 'dave', 'member') AS written;
+SELECT fga_write_tuple('doc', 'inv3', 'group', 'eng#member', 'viewer') AS written;
+SELECT fga_check('doc', 'inv3', 'user', 'dave', 'viewer') AS allowed;
+SELECT fga_delete_tuple('group', 'eng', 'user', 'dave', 'member') AS deleted;
+SELECT fga_check('doc', 'inv3', 'user', 'dave', 'viewer') AS allowed;
+
+-- 방금 쓴 직접 관계라도 exclusion 으로 deny 일 수 있다 (쓰기 결과를 캐시에 미리 넣지 않음)
+SELECT fga_write_tuple('doc', 'inv4', 'user', 'erin', 'blocked') AS written;
+SELECT fga_write_tuple('doc', 'inv4', 'user', 'erin', 'reader') AS written;
+SELECT fga_check('doc', 'inv4', 'user', 'erin', 'reader') AS allowed;
+
+-- 무효화 범위는 모든 프로세스가 같아야 하므로 세션에서 바꿀 수 없다
+SET fga.cache_transitive_types = '';
@@ -0,0 +1,27 @@
+--
+-- fga_list_objects: type 을 뗀 id 를 정렬해 돌려주고 list cache 에 저장한다
+--
+
+SELECT fga_write_tuple('doc', 'lo2', 'user', 'ivan', 'viewer') AS written;
+SELECT fga_write_tuple('doc', 'lo10', 'user', 'ivan', 'viewer') AS written;
+SELECT fga_write_tuple('doc', 'lo1', 'user', 'ivan', 'viewer') AS written;
+SELECT fga_write_tuple('group', 'lo', 'user', 'ivan', 'member') AS written;
+SELECT fga_write_tuple('doc', 'lo3', 'group', 'lo#member', 'viewer') AS written;
+
+-- 스트림 순서와 상관없이 정렬되어 나온다 (group 을 거친 lo3 포함)
+SELECT * FROM fga_list_objects('doc', 'viewer', 'user', 'ivan') AS id WHERE id LIKE 'lo%';
+
+-- 같은 결과를 다시 물으면 list cache 에서 읽는다
+SELECT count(*) AS objects FROM fga_list_objects('doc', 'viewer', 'user', 'ivan') AS id WHERE id LIKE 'lo%';
+
+-- 권한이 없으면 빈 결과
+SELECT count(*) AS objects FROM fga_list_objects('doc', 'viewer', 'user', 'nobody_lo');
+
+-- 쓰기 후에는 저장된 결과를 쓰지 않는다
+SELECT fga_write_tuple('doc', 'lo4', 'user', 'ivan', 'viewer') AS written;
+SELECT * FROM fga_list_objects('doc', 'viewer', 'user', 'ivan') AS id WHERE id LIKE 'lo%';
+
+-- 집합으로 join 한다
+SELECT d.id FROM (VALUES ('lo1'), ('lo5'), ('lo10')) AS d(id)
+WHERE d.id IN (SELECT fga_list_objects('doc', 'viewer', 'user', 'ivan'))
+ORDER BY d.id;
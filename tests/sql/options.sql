@@ -0,0 +1,37 @@
+--
+-- fga_check options
+--
+SELECT fga_write_tuple('doc', 'opt1', 'user', 'alice', 'owner') AS written;
+
+-- 기본값과 같은 option
+SELECT fga_check('doc', 'opt1', 'user', 'alice', 'owner', NULL) AS allowed;
+SELECT fga_check('doc', 'opt1', 'user', 'alice', 'owner', '{}') AS allowed;
+SELECT fga_check('doc', 'opt1', 'user', 'alice', 'owner', '{"consistency": "minimize_latency", "cache": "on"}') AS allowed;
+
+-- 캐시를 읽지 않는 경로도 같은 결과
+SELECT fga_check('doc', 'opt1', 'user', 'alice', 'owner', '{"consistency": "higher"}') AS allowed;
+SELECT fga_check('doc', 'opt1', 'user', 'alice', 'owner', '{"cache": "refresh"}') AS allowed;
+SELECT fga_check('doc', 'opt1', 'user', 'alice', 'owner', '{"cache": "off", "timeout_ms": 5000}') AS allowed;
+SELECT fga_check('doc', 'opt1', 'user', 'bob', 'owner', '{"cache": "off"}') AS allowed;
+
+-- contextual tuple 은 이 호출에만 적용되고, 캐시 key 가 달라 다른 호출과 결과를 섞지 않는다
+SELECT fga_check('doc', 'opt2', 'user', 'bob', 'owner',
+                 '{"contextual_tuples": [{"object": "doc:opt2", "relation": "owner", "user": "user:bob"}]}') AS allowed;
+SELECT fga_check('doc', 'opt2', 'user', 'bob', 'owner') AS allowed;
+SELECT fga_check('doc', 'opt2', 'user', 'bob', 'owner',
+                 '{"contextual_tuples": [{"object": "doc:opt2", "relation": "owner", "user": "user:bob"}]}') AS allowed;
+
+-- 잘못된 option 은 ERROR (오타로 캐시를 읽는 일이 없도록)
+SELECT fga_check('doc', 'opt1', 'user', 'alice', 'owner', '{"consistancy": "higher"}') AS allowed;
+SELECT fga_check('doc', 'opt1', 'user', 'alice', 'owner', '{"consistency": "eventual"}') AS allowed;
+SELECT fga_check('doc', 'opt1', 'user', 'alice', 'owner', '{"cache": false}') AS allowed;
+SELECT fga_check('doc', 'opt1', 'user', 'alice', 'owner', '{"cache": "maybe"}') AS allowed;
+SELECT fga_check('doc', 'opt1', 'user', 'alice', 'owner', '{"timeout_ms": "5s"}') AS allowed;
+SELECT fga_check('doc', 'opt1', 'user', 'alice', 'owner', '{"timeout_ms": 0}') AS allowed;
+SELECT fga_check('doc', 'opt1', 'user', 'alice', 'owner', '{"context": [1]}') AS allowed;
+SELECT fga_check('doc', 'opt1', 'user', 'alice', 'owner', '{"contextual_tuples": {}}') AS allowed;
+SELECT fga_check('doc', 'opt1', 'user', 'alice', 'owner', '{"contextual_tuples": ["doc:opt1#owner@user:bob"]}') AS allowed;
+SELECT fga_check('doc', 'opt1', 'user', 'alice', 'owner', '[]') AS allowed;
+
+-- 빈 인자
+SELECT fga_check('doc', '', 'user', 'alice', 'owner') AS allowed;
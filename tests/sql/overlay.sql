@@ -0,0 +1,37 @@
+--
+-- read-your-writes: 같은 트랜잭션의 check 는 쓴 tuple 을 contextual tuple 로 붙여 묻는다
+--
+
+-- 방금 쓴 직접 관계라도 exclusion 으로 deny 일 수 있다
+BEGIN;
+SELECT fga_write_tuple('doc', 'ov1', 'user', 'frank', 'blocked') AS written;
+SELECT fga_write_tuple('doc', 'ov1', 'user', 'frank', 'reader') AS written;
+SELECT fga_check('doc', 'ov1', 'user', 'frank', 'reader') AS allowed;
+COMMIT;
+
+-- 쓴 직접 관계와 그로부터 계산되는 relation
+BEGIN;
+SELECT fga_check('doc', 'ov2', 'user', 'gina', 'viewer') AS allowed;
+SELECT fga_write_tuple('doc', 'ov2', 'user', 'gina', 'editor') AS written;
+SELECT fga_check('doc', 'ov2', 'user', 'gina', 'editor') AS allowed;
+SELECT fga_check('doc', 'ov2', 'user', 'gina', 'viewer') AS allowed;
+SELECT fga_check('doc', 'ov2', 'user', 'gina', 'owner') AS allowed;
+COMMIT;
+
+-- 다른 object 를 거쳐 얻는 권한 (group 멤버십)
+BEGIN;
+SELECT fga_write_tuple('group', 'ov', 'user', 'hank', 'member') AS written;
+SELECT fga_write_tuple('doc', 'ov3', 'group', 'ov#member', 'viewer') AS written;
+SELECT fga_check('doc', 'ov3', 'user', 'hank', 'viewer') AS allowed;
+SELECT fga_check('doc', 'ov3', 'user', 'hank', 'editor') AS allowed;
+COMMIT;
+
+-- 같은 트랜잭션에서 삭제
+BEGIN;
+SELECT fga_delete_tuple('doc', 'ov2', 'user', 'gina', 'editor') AS deleted;
+SELECT fga_check('doc', 'ov2', 'user', 'gina', 'viewer') AS allowed;
+COMMIT;
+
+-- 트랜잭션이 끝난 뒤 (OpenFGA 에는 이미 반영됨)
+SELECT fga_check('doc', 'ov1', 'user', 'frank', 'reader') AS allowed;
+SELECT fga_check('doc', 'ov3', 'user', 'hank', 'viewer') AS allowed;
@@ -0,0 +1,52 @@
+#
+# 001_prewarm.pl - L2 덤프/적재 (fga.cache_prewarm) 재시작 왕복
+#
+# 종료 시 덤프한 엔트리가 다시 시작할 때 적재되는지,
+# relation 등록 표가 달라지면 (여기서는 fga.max_relations 축소) 덤프를 버리는지 확인한다.
+# OpenFGA 설정은 tests/regress_setup.sh 가 만든 tests/regress.conf 를 쓴다.
+#
+use strict;
+use warnings FATAL => 'all';
+
+use PostgreSQL::Test::Cluster;
+use PostgreSQL::Test::Utils;
+use Test::More;
+
+my $node = PostgreSQL::Test::Cluster->new('prewarm');
+$node->init;
+$node->append_conf('postgresql.conf', slurp_file('tests/regress.conf'));
+$node->append_conf('postgresql.conf', qq(
+fga.cache_prewarm = on
+fga.cache_dump_interval = 0
+fga.cache_ttl_ms = 600000
+));
+$node->start;
+
+$node->safe_psql('postgres', 'CREATE EXTENSION postfga');
+$node->safe_psql('postgres', "SELECT fga_write_tuple('doc', 'pw1', 'user', 'alice', 'viewer')");
+
+# doc#viewer 가 비트 0, doc#editor 가 비트 1 로 등록되고 한 엔트리에 모인다
+is($node->safe_psql('postgres', "SELECT fga_check('doc', 'pw1', 'user', 'alice', 'viewer')"), 't', 'viewer allowed');
+is($node->safe_psql('postgres', "SELECT fga_check('doc', 'pw1', 'user', 'alice', 'editor')"), 'f', 'editor denied');
+
+my $live = "SELECT count(*) FROM fga_cache_entries(-1) WHERE status = 'live'";
+ok($node->safe_psql('postgres', $live) > 0, 'entries cached before restart');
+
+# 같은 설정으로 재시작: 종료 시 덤프를 적재
+my $offset = -s $node->logfile;
+$node->restart;
+ok($node->wait_for_log(qr/prewarmed \d+ cache entries/, $offset), 'dump loaded at startup');
+ok($node->safe_psql('postgres', $live) > 0, 'entries live after prewarm');
+is($node->safe_psql('postgres', "SELECT fga_check('doc', 'pw1', 'user', 'alice', 'viewer')"), 't', 'prewarmed viewer');
+is($node->safe_psql('postgres', "SELECT fga_check('doc', 'pw1', 'user', 'alice', 'editor')"), 'f', 'prewarmed editor');
+
+# relation 등록 표가 달라지면 (doc#editor 를 등록할 수 없음) 덤프를 버린다
+$node->append_conf('postgresql.conf', 'fga.max_relations = 1');
+$offset = -s $node->logfile;
+$node->restart;
+ok($node->wait_for_log(qr/not loading cache dump/, $offset), 'dump refused after registry change');
+is($node->safe_psql('postgres', $live), '0', 'nothing loaded');
+is($node->safe_psql('postgres', "SELECT fga_check('doc', 'pw1', 'user', 'alice', 'editor')"), 'f', 'editor still denied');
+
+$node->stop;
+done_testing();